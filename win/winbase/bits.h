@@ -164,6 +164,31 @@ ALWAYS_INLINE size_t CountTrailingZeroBitsSizeT(size_t x) {
   return CountTrailingZeroBits(x);
 }
 
+// PopCount(value) returns the number of 1 bits in |value|.
+// Example: 00100010 -> 2
+//
+// MSVC only has an intrinsic for the POPCNT instruction, which older CPUs
+// lack, so unless the build targets AVX the bits are counted in parallel in
+// 64-bit arithmetic, as in "Hacker's Delight" section 5.1.
+template <typename T>
+ALWAYS_INLINE
+    typename std::enable_if<std::is_unsigned<T>::value && sizeof(T) <= 8,
+                            int>::type
+    PopCount(T value) {
+#if defined(COMPILER_GCC)
+  return sizeof(T) == 8 ? __builtin_popcountll(static_cast<uint64_t>(value))
+                        : __builtin_popcount(static_cast<uint32_t>(value));
+#elif defined(__AVX__) && defined(ARCH_CPU_64_BITS)
+  return static_cast<int>(__popcnt64(static_cast<uint64_t>(value)));
+#else
+  uint64_t x = static_cast<uint64_t>(value);
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
 // Returns the integer i such as 2^i <= n < 2^(i+1)
 inline int Log2Floor(uint32_t n) {
   return 31 - CountLeadingZeroBits(n);
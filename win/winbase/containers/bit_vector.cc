@@ -0,0 +1,481 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\containers\bit_vector.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "winbase\bits.h"
+#include "winbase\pickle.h"
+
+namespace winbase {
+
+namespace {
+
+// The rank index counts the bits by blocks of eight words.
+constexpr size_t kBlockWords = 8;
+constexpr size_t kBlockBits = 512;
+
+// The select index holds the block of every kSampleRate-th bit. If the
+// kSampleRate bits from there span more than kMaxSpanBlocks blocks, it holds
+// their positions instead: the entry is kLongSpan | n for the n-th such span.
+constexpr size_t kSampleRate = 512;
+constexpr size_t kMaxSpanBlocks = 256;
+constexpr uint32_t kLongSpan = 0x80000000U;
+
+// The number of bits of each count of the rank index, and its mask.
+constexpr int kCountBits = 9;
+constexpr uint64_t kCountMask = (1 << kCountBits) - 1;
+
+// Changes whenever the layout of the bits or of the index changes.
+constexpr uint32_t kPickleVersion = 2;
+
+size_t NumBlocks(size_t size) {
+  return (size + kBlockBits - 1) / kBlockBits;
+}
+
+// The number of entries of the select index for |count| bits.
+size_t NumSamples(size_t count) {
+  return (count + kSampleRate - 1) / kSampleRate;
+}
+
+uint64_t Load64(const char* data, size_t index) {
+  uint64_t value;
+  memcpy(&value, data + index * sizeof(value), sizeof(value));
+  return value;
+}
+
+uint32_t Load32(const char* data, size_t index) {
+  uint32_t value;
+  memcpy(&value, data + index * sizeof(value), sizeof(value));
+  return value;
+}
+
+// Returns the position of the 1 bit of rank |rank| in |word|, which has more
+// than |rank| 1 bits. The bytes of |word| are counted in parallel, then the
+// byte that holds the bit is searched.
+unsigned SelectInWord(uint64_t word, size_t rank) {
+  uint64_t counts = word - ((word >> 1) & 0x5555555555555555ULL);
+  counts = (counts & 0x3333333333333333ULL) +
+           ((counts >> 2) & 0x3333333333333333ULL);
+  counts = (counts + (counts >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  // Each byte now holds the number of 1 bits up to and including its own.
+  counts *= 0x0101010101010101ULL;
+  unsigned shift = 0;
+  while (shift < 56 && ((counts >> shift) & 0xFF) <= rank)
+    shift += 8;
+  if (shift)
+    rank -= (counts >> (shift - 8)) & 0xFF;
+  uint32_t byte = (word >> shift) & 0xFF;
+  for (; rank && byte; --rank)
+    byte &= byte - 1;
+  return shift + bits::CountTrailingZeroBits(byte);
+}
+
+}  // namespace
+
+// The arrays of a pickle, once validated.
+struct BitVector::Arrays {
+  size_t size;
+  size_t ones;
+  size_t num_blocks;
+  const char* words;
+  const char* rank;
+  const char* select1;
+  const char* select0;
+  const char* positions;
+  size_t num_long_spans;
+};
+
+BitVector::BitVector() = default;
+
+BitVector::BitVector(size_t size) : size_(size) {
+  owned_words_.resize(NumBlocks(size) * kBlockWords);
+  UpdateViews();
+}
+
+BitVector::BitVector(BitVector&& other) noexcept {
+  *this = std::move(other);
+}
+
+BitVector& BitVector::operator=(BitVector&& other) noexcept {
+  size_ = other.size_;
+  ones_ = other.ones_;
+  has_index_ = other.has_index_;
+  mapped_ = other.mapped_;
+  owned_words_ = std::move(other.owned_words_);
+  owned_rank_ = std::move(other.owned_rank_);
+  owned_select1_ = std::move(other.owned_select1_);
+  owned_select0_ = std::move(other.owned_select0_);
+  owned_positions_ = std::move(other.owned_positions_);
+  words_ = other.words_;
+  rank_ = other.rank_;
+  select1_ = other.select1_;
+  select0_ = other.select0_;
+  positions_ = other.positions_;
+  num_blocks_ = other.num_blocks_;
+  num_long_spans_ = other.num_long_spans_;
+  if (!mapped_)
+    UpdateViews();
+  other.Reset();
+  return *this;
+}
+
+BitVector::~BitVector() = default;
+
+void BitVector::Set(size_t index, bool value) {
+  WINBASE_DCHECK(!mapped_);
+  WINBASE_DCHECK(index < size_);
+  uint64_t& word = owned_words_[index / kWordBits];
+  uint64_t mask = uint64_t(1) << (index % kWordBits);
+  word = value ? word | mask : word & ~mask;
+  has_index_ = false;
+}
+
+void BitVector::PushBack(bool value) {
+  WINBASE_DCHECK(!mapped_);
+  if (size_ == owned_words_.size() * kWordBits) {
+    owned_words_.resize(owned_words_.size() + kBlockWords);
+    UpdateViews();
+  }
+  ++size_;
+  Set(size_ - 1, value);
+}
+
+void BitVector::BuildIndex() {
+  WINBASE_DCHECK(!mapped_);
+  num_blocks_ = owned_words_.size() / kBlockWords;
+  WINBASE_CHECK(num_blocks_ < kLongSpan);
+
+  owned_rank_.resize(2 * (num_blocks_ + 1));
+  size_t ones = 0;
+  for (size_t block = 0; block < num_blocks_; ++block) {
+    owned_rank_[2 * block] = ones;
+    uint64_t counts = 0;
+    size_t block_ones = 0;
+    for (size_t i = 0; i < kBlockWords; ++i) {
+      if (i)
+        counts |= static_cast<uint64_t>(block_ones) << (kCountBits * (i - 1));
+      block_ones += bits::PopCount(owned_words_[block * kBlockWords + i]);
+    }
+    owned_rank_[2 * block + 1] = counts;
+    ones += block_ones;
+  }
+  owned_rank_[2 * num_blocks_] = ones;
+  owned_rank_[2 * num_blocks_ + 1] = 0;
+  ones_ = ones;
+
+  owned_positions_.clear();
+  BuildSelectIndex<true>(&owned_select1_);
+  BuildSelectIndex<false>(&owned_select0_);
+  num_long_spans_ = owned_positions_.size() / kSampleRate;
+
+  has_index_ = true;
+  UpdateViews();
+}
+
+template <bool bit>
+void BitVector::BuildSelectIndex(std::vector<uint32_t>* samples) {
+  // Padding bits count as 0 bits here, but they come after all the others.
+  size_t count = bit ? ones_ : size_ - ones_;
+  auto count_before = [this](size_t block) {
+    size_t ones = static_cast<size_t>(owned_rank_[2 * block]);
+    return bit ? ones : block * kBlockBits - ones;
+  };
+
+  samples->clear();
+  if (!count)
+    return;
+
+  // The block of every kSampleRate-th bit, then that of the last bit.
+  std::vector<size_t> blocks;
+  size_t next = 0;
+  for (size_t block = 0;; ++block) {
+    size_t after = count_before(block + 1);
+    for (; next < count && next < after; next += kSampleRate)
+      blocks.push_back(block);
+    if (after >= count) {
+      blocks.push_back(block);
+      break;
+    }
+  }
+
+  for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+    if (blocks[i + 1] - blocks[i] <= kMaxSpanBlocks) {
+      samples->push_back(static_cast<uint32_t>(blocks[i]));
+      continue;
+    }
+    samples->push_back(static_cast<uint32_t>(
+        kLongSpan | (owned_positions_.size() / kSampleRate)));
+    size_t rank = count_before(blocks[i]);
+    size_t first = i * kSampleRate;
+    size_t end = std::min(first + kSampleRate, count);
+    for (size_t word = blocks[i] * kBlockWords; rank < end; ++word) {
+      uint64_t value = bit ? owned_words_[word] : ~owned_words_[word];
+      for (; value && rank < end; value &= value - 1, ++rank) {
+        if (rank >= first) {
+          owned_positions_.push_back(word * kWordBits +
+                                     SelectInWord(value, 0));
+        }
+      }
+    }
+    // The last span may have fewer bits; pad it to keep the spans aligned.
+    owned_positions_.resize(owned_positions_.size() + first + kSampleRate -
+                            end);
+  }
+}
+
+size_t BitVector::Rank1(size_t index) const {
+  WINBASE_DCHECK(has_index_);
+  WINBASE_DCHECK(index <= size_);
+  size_t block = index / kBlockBits;
+  size_t word = index / kWordBits;
+  // The count before the first word of a block is 0, and the shift for it
+  // lands on the unused top bit of the counts.
+  uint64_t counts = Load64(rank_, 2 * block + 1);
+  size_t rank = static_cast<size_t>(
+      Load64(rank_, 2 * block) +
+      ((counts >> (((word - 1) % kBlockWords) * kCountBits)) & kCountMask));
+  size_t bit = index % kWordBits;
+  if (bit)
+    rank += bits::PopCount(Word(word) & ((uint64_t(1) << bit) - 1));
+  return rank;
+}
+
+size_t BitVector::Select1(size_t rank) const {
+  WINBASE_DCHECK(has_index_);
+  WINBASE_DCHECK(rank < ones_);
+  return Select<true>(rank);
+}
+
+size_t BitVector::Select0(size_t rank) const {
+  WINBASE_DCHECK(has_index_);
+  WINBASE_DCHECK(rank < size_ - ones_);
+  return Select<false>(rank);
+}
+
+template <bool bit>
+size_t BitVector::Select(size_t rank) const {
+  // The number of |bit| bits before |block|.
+  auto count_before = [this](size_t block) {
+    size_t ones = static_cast<size_t>(Load64(rank_, 2 * block));
+    return bit ? ones : block * kBlockBits - ones;
+  };
+
+  uint32_t sample = Load32(bit ? select1_ : select0_, rank / kSampleRate);
+  if (sample & kLongSpan) {
+    size_t span = sample & ~kLongSpan;
+    return static_cast<size_t>(
+        Load64(positions_, span * kSampleRate + rank % kSampleRate));
+  }
+
+  // The bit is at most kMaxSpanBlocks blocks after that of the sample.
+  size_t low = sample;
+  size_t high = std::min(low + kMaxSpanBlocks + 1, num_blocks_);
+  while (high - low > 1) {
+    size_t middle = low + (high - low) / 2;
+    if (count_before(middle) <= rank)
+      low = middle;
+    else
+      high = middle;
+  }
+  rank -= count_before(low);
+
+  uint64_t counts = Load64(rank_, 2 * low + 1);
+  size_t word = 0;
+  size_t word_rank = 0;
+  for (size_t i = 1; i < kBlockWords; ++i) {
+    size_t ones = (counts >> (kCountBits * (i - 1))) & kCountMask;
+    size_t count = bit ? ones : i * kWordBits - ones;
+    if (count > rank)
+      break;
+    word = i;
+    word_rank = count;
+  }
+  word += low * kBlockWords;
+  uint64_t value = bit ? Word(word) : ~Word(word);
+  return word * kWordBits + SelectInWord(value, rank - word_rank);
+}
+
+size_t BitVector::size_in_bytes() const {
+  size_t bytes = num_blocks_ * kBlockWords * sizeof(uint64_t);
+  if (has_index_) {
+    bytes += 2 * (num_blocks_ + 1) * sizeof(uint64_t) +
+             (NumSamples(ones_) + NumSamples(size_ - ones_)) *
+                 sizeof(uint32_t) +
+             num_long_spans_ * kSampleRate * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+void BitVector::WriteToPickle(Pickle* pickle) const {
+  WINBASE_DCHECK(has_index_);
+  WINBASE_CHECK(size_in_bytes() <=
+                static_cast<size_t>(std::numeric_limits<int>::max()));
+  pickle->WriteUInt32(kPickleVersion);
+  pickle->WriteUInt64(size_);
+  pickle->WriteUInt64(ones_);
+  pickle->WriteData(
+      words_, static_cast<int>(num_blocks_ * kBlockWords * sizeof(uint64_t)));
+  pickle->WriteData(
+      rank_, static_cast<int>(2 * (num_blocks_ + 1) * sizeof(uint64_t)));
+  pickle->WriteData(select1_,
+                    static_cast<int>(NumSamples(ones_) * sizeof(uint32_t)));
+  pickle->WriteData(
+      select0_,
+      static_cast<int>(NumSamples(size_ - ones_) * sizeof(uint32_t)));
+  pickle->WriteData(positions_,
+                    static_cast<int>(num_long_spans_ * kSampleRate *
+                                     sizeof(uint64_t)));
+}
+
+bool BitVector::ReadFromPickle(PickleIterator* iter) {
+  Arrays arrays;
+  if (!ReadPickle(iter, &arrays))
+    return false;
+  size_t num_words = arrays.num_blocks * kBlockWords;
+  size_t num_samples1 = NumSamples(arrays.ones);
+  size_t num_samples0 = NumSamples(arrays.size - arrays.ones);
+  Reset();
+  owned_words_.resize(num_words);
+  owned_rank_.resize(2 * (arrays.num_blocks + 1));
+  owned_select1_.resize(num_samples1);
+  owned_select0_.resize(num_samples0);
+  owned_positions_.resize(arrays.num_long_spans * kSampleRate);
+  if (num_words)
+    memcpy(owned_words_.data(), arrays.words, num_words * sizeof(uint64_t));
+  memcpy(owned_rank_.data(), arrays.rank,
+         owned_rank_.size() * sizeof(uint64_t));
+  if (num_samples1) {
+    memcpy(owned_select1_.data(), arrays.select1,
+           num_samples1 * sizeof(uint32_t));
+  }
+  if (num_samples0) {
+    memcpy(owned_select0_.data(), arrays.select0,
+           num_samples0 * sizeof(uint32_t));
+  }
+  if (!owned_positions_.empty()) {
+    memcpy(owned_positions_.data(), arrays.positions,
+           owned_positions_.size() * sizeof(uint64_t));
+  }
+  size_ = arrays.size;
+  ones_ = arrays.ones;
+  num_long_spans_ = arrays.num_long_spans;
+  has_index_ = true;
+  UpdateViews();
+  return true;
+}
+
+bool BitVector::MapFromPickle(PickleIterator* iter) {
+  Arrays arrays;
+  if (!ReadPickle(iter, &arrays))
+    return false;
+  Reset();
+  size_ = arrays.size;
+  ones_ = arrays.ones;
+  has_index_ = true;
+  mapped_ = true;
+  words_ = arrays.words;
+  rank_ = arrays.rank;
+  select1_ = arrays.select1;
+  select0_ = arrays.select0;
+  positions_ = arrays.positions;
+  num_blocks_ = arrays.num_blocks;
+  num_long_spans_ = arrays.num_long_spans;
+  return true;
+}
+
+bool BitVector::ReadPickle(PickleIterator* iter, Arrays* arrays) const {
+  uint32_t version;
+  uint64_t size;
+  uint64_t ones;
+  if (!iter->ReadUInt32(&version) || version != kPickleVersion ||
+      !iter->ReadUInt64(&size) || !iter->ReadUInt64(&ones) || ones > size ||
+      size > static_cast<uint64_t>(std::numeric_limits<int>::max()) * 8) {
+    return false;
+  }
+  arrays->size = static_cast<size_t>(size);
+  arrays->ones = static_cast<size_t>(ones);
+  arrays->num_blocks = NumBlocks(arrays->size);
+
+  // The lengths follow from the sizes, which WriteData() keeps below 2 GiB.
+  const uint64_t lengths[] = {
+      arrays->num_blocks * kBlockWords * sizeof(uint64_t),
+      2 * (arrays->num_blocks + 1) * sizeof(uint64_t),
+      NumSamples(arrays->ones) * sizeof(uint32_t),
+      NumSamples(arrays->size - arrays->ones) * sizeof(uint32_t)};
+  const char** data[] = {&arrays->words, &arrays->rank, &arrays->select1,
+                         &arrays->select0};
+  for (size_t i = 0; i < 4; ++i) {
+    int length;
+    if (!iter->ReadData(data[i], &length) ||
+        static_cast<uint64_t>(length) != lengths[i]) {
+      return false;
+    }
+  }
+
+  // Check what the queries rely on to stay within the arrays. The long spans
+  // of the 1 bits are numbered first, then those of the 0 bits.
+  if (Load64(arrays->rank, 2 * arrays->num_blocks) != ones)
+    return false;
+  size_t num_long_spans = 0;
+  for (const char* samples : {arrays->select1, arrays->select0}) {
+    size_t count = samples == arrays->select1
+                       ? NumSamples(arrays->ones)
+                       : NumSamples(arrays->size - arrays->ones);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t sample = Load32(samples, i);
+      if (sample & kLongSpan) {
+        if ((sample & ~kLongSpan) != num_long_spans++)
+          return false;
+        continue;
+      }
+      if (sample < previous || sample >= arrays->num_blocks)
+        return false;
+      previous = sample;
+    }
+  }
+
+  int length;
+  if (!iter->ReadData(&arrays->positions, &length) ||
+      static_cast<uint64_t>(length) !=
+          static_cast<uint64_t>(num_long_spans) * kSampleRate *
+              sizeof(uint64_t)) {
+    return false;
+  }
+  for (size_t i = 0; i < num_long_spans * kSampleRate; ++i) {
+    if (Load64(arrays->positions, i) >= size)
+      return false;
+  }
+  arrays->num_long_spans = num_long_spans;
+  return true;
+}
+
+void BitVector::UpdateViews() {
+  words_ = reinterpret_cast<const char*>(owned_words_.data());
+  rank_ = reinterpret_cast<const char*>(owned_rank_.data());
+  select1_ = reinterpret_cast<const char*>(owned_select1_.data());
+  select0_ = reinterpret_cast<const char*>(owned_select0_.data());
+  positions_ = reinterpret_cast<const char*>(owned_positions_.data());
+  num_blocks_ = owned_words_.size() / kBlockWords;
+}
+
+void BitVector::Reset() {
+  size_ = 0;
+  ones_ = 0;
+  has_index_ = false;
+  mapped_ = false;
+  owned_words_.clear();
+  owned_rank_.clear();
+  owned_select1_.clear();
+  owned_select0_.clear();
+  owned_positions_.clear();
+  num_long_spans_ = 0;
+  UpdateViews();
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,169 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_BIT_VECTOR_H_
+#define WINLIB_WINBASE_CONTAINERS_BIT_VECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+class Pickle;
+class PickleIterator;
+
+// BitVector is a sequence of bits with a small index that answers rank and
+// select queries, the building block of succinct indexes:
+//   Rank1(i)   is the number of 1 bits before position i,
+//   Select1(k) is the position of the 1 bit of rank k (counting from 0),
+// and likewise Rank0() and Select0() for the 0 bits.
+//
+// The bits are set with Set() or PushBack(), then BuildIndex() computes the
+// index; any further change drops it until the next BuildIndex(). The index
+// takes about a third of the size of the bits. For each block of 512 bits, it
+// holds the number of 1 bits before the block and the number before each of
+// its words, packed in 9-bit fields, so that Rank1() is two loads and a
+// PopCount(), in constant time. Select1() is constant time too: the index
+// holds the block of every 512th 1 bit. When the 512 bits from there span at
+// most 256 blocks, Select1() binary-searches these blocks, then scans the
+// words of the one that holds the bit. Sparser bits are rare enough for the
+// index to hold the position of each of them instead, which takes at most a
+// quarter of the size of the bits they span. Likewise for Select0().
+//
+// WriteToPickle() stores the bits with their index, so that a BitVector read
+// back with MapFromPickle() answers queries from the pickle buffer without
+// copying or parsing anything. With a PickleView, the buffer can be a
+// MemoryMappedFile:
+//   winbase::PickleView view(file.data(), file.length());
+//   winbase::PickleIterator iter(view);
+//   winbase::BitVector bits;
+//   if (!view.IsValid() || !bits.MapFromPickle(&iter))
+//     return false;
+class WINBASE_EXPORT BitVector {
+ public:
+  // Creates an empty vector.
+  BitVector();
+
+  // Creates a vector of |size| 0 bits.
+  explicit BitVector(size_t size);
+
+  BitVector(const BitVector&) = delete;
+  BitVector& operator=(const BitVector&) = delete;
+
+  // A moved-from vector is empty.
+  BitVector(BitVector&& other) noexcept;
+  BitVector& operator=(BitVector&& other) noexcept;
+
+  ~BitVector();
+
+  size_t size() const { return size_; }
+  bool empty() const { return !size_; }
+
+  bool Get(size_t index) const {
+    WINBASE_DCHECK(index < size_);
+    return (Word(index / kWordBits) >> (index % kWordBits)) & 1;
+  }
+  bool operator[](size_t index) const { return Get(index); }
+
+  // These change the bits, and so drop the index. A mapped vector cannot be
+  // changed.
+  void Set(size_t index, bool value = true);
+  void PushBack(bool value);
+
+  // Computes the index of the bits, which Rank and Select need.
+  void BuildIndex();
+  bool has_index() const { return has_index_; }
+
+  // The number of 1 bits. Needs the index.
+  size_t CountOnes() const {
+    WINBASE_DCHECK(has_index_);
+    return ones_;
+  }
+
+  // The number of 1 (or 0) bits before |index|, which is at most size().
+  // Needs the index.
+  size_t Rank1(size_t index) const;
+  size_t Rank0(size_t index) const { return index - Rank1(index); }
+
+  // The position of the 1 (or 0) bit of rank |rank|, which must be less than
+  // the number of such bits. Needs the index.
+  size_t Select1(size_t rank) const;
+  size_t Select0(size_t rank) const;
+
+  // The size of the bits and of their index.
+  size_t size_in_bytes() const;
+
+  // Writes the bits and their index, which must have been built, to |pickle|.
+  void WriteToPickle(Pickle* pickle) const;
+
+  // Reads a vector written by WriteToPickle(), copying it. Returns false and
+  // leaves the vector unchanged if the data is not valid.
+  bool ReadFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT;
+
+  // Like ReadFromPickle(), but the vector reads the bits and their index from
+  // the buffer of the pickle, which must outlive it or be replaced first.
+  bool MapFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT;
+
+ private:
+  struct Arrays;
+
+  static constexpr size_t kWordBits = 64;
+
+  // Loads the |index|th word of the bits. Mapped data is only 4-byte aligned.
+  uint64_t Word(size_t index) const {
+    uint64_t word;
+    memcpy(&word, words_ + index * sizeof(word), sizeof(word));
+    return word;
+  }
+
+  template <bool bit>
+  size_t Select(size_t rank) const;
+
+  // Fills the select index of the |bit| bits and appends the positions of
+  // their long spans to |owned_positions_|. Needs the rank index.
+  template <bool bit>
+  void BuildSelectIndex(std::vector<uint32_t>* samples);
+
+  bool ReadPickle(PickleIterator* iter, Arrays* arrays) const;
+
+  // Points the views below at the owned arrays.
+  void UpdateViews();
+
+  void Reset();
+
+  size_t size_ = 0;
+  size_t ones_ = 0;
+  bool has_index_ = false;
+  bool mapped_ = false;
+
+  // The bits, padded with 0 to a whole number of 512-bit blocks; two words
+  // per block, plus one at the end, for the rank index; and for the select
+  // index, an entry for every 512th 1 and 0 bit, with the positions of the
+  // 512 bits from each entry that spans too many blocks.
+  std::vector<uint64_t> owned_words_;
+  std::vector<uint64_t> owned_rank_;
+  std::vector<uint32_t> owned_select1_;
+  std::vector<uint32_t> owned_select0_;
+  std::vector<uint64_t> owned_positions_;
+
+  // The arrays above, or the pickle buffer of a mapped vector.
+  const char* words_ = nullptr;
+  const char* rank_ = nullptr;
+  const char* select1_ = nullptr;
+  const char* select0_ = nullptr;
+  const char* positions_ = nullptr;
+  size_t num_blocks_ = 0;
+  size_t num_long_spans_ = 0;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_BIT_VECTOR_H_
\ No newline at end of file
@@ -0,0 +1,264 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_BLOOM_FILTER_H_
+#define WINLIB_WINBASE_CONTAINERS_BLOOM_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\compiler_specific.h"
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+#include "winbase\pickle.h"
+#include "winlib\build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
+
+namespace winbase {
+
+namespace internal {
+
+// A block of a BloomFilter: one cache line, read as eight 64-bit words.
+struct ALIGNAS(64) BloomFilterBlock {
+  uint64_t words[8];
+};
+
+// Returns the bit that |hash| sets in each word of a block. The multipliers
+// are those of the split block Bloom filter of Apache Parquet; each takes the
+// top 6 bits of a different product as the index of the bit.
+inline void BloomFilterMasks(uint32_t hash, uint64_t masks[8]) {
+  static constexpr uint32_t kSalts[8] = {0x47b6137bU, 0x44974d91U,
+                                         0x8824ad5bU, 0xa2b7289dU,
+                                         0x705495c7U, 0x2df1424bU,
+                                         0x9efc4947U, 0x5c6bfb31U};
+  for (int i = 0; i < 8; ++i)
+    masks[i] = uint64_t(1) << ((hash * kSalts[i]) >> 26);
+}
+
+// Returns true if all the bits of |masks| are set in the block at |block|,
+// which need not be aligned.
+inline bool BloomFilterBlockHas(const char* block, const uint64_t masks[8]) {
+#if defined(ARCH_CPU_X86_FAMILY)
+  __m128i missing = _mm_setzero_si128();
+  for (int i = 0; i < 4; ++i) {
+    __m128i words = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(block + i * sizeof(__m128i)));
+    __m128i mask =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i * 2));
+    missing = _mm_or_si128(missing, _mm_andnot_si128(words, mask));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) ==
+         0xffff;
+#else
+  for (int i = 0; i < 8; ++i) {
+    uint64_t word;
+    memcpy(&word, block + i * sizeof(word), sizeof(word));
+    if ((word & masks[i]) != masks[i])
+      return false;
+  }
+  return true;
+#endif
+}
+
+}  // namespace internal
+
+// BloomFilter answers whether a value may have been added to it, using about
+// |bits_per_value| bits per value and without storing the values. A "no" is
+// always right; a "yes" is wrong for a small fraction of the values that were
+// never added, about 1% at 10 bits per value and 0.1% at 16. Use it to skip
+// lookups in a slower store, such as an index on disk, for most of the keys
+// that are not in it. Values cannot be removed; see CuckooFilter for that.
+//
+// The filter is blocked: the bits of a value all fall in one 64-byte block
+// picked by its hash, one bit in each 64-bit word of the block, so Add() and
+// MayContain() touch a single cache line and MayContain() checks the eight
+// bits at once with SSE2. The false positive rate is a little higher than
+// that of a classic Bloom filter of the same size.
+//
+// The values are hashed to a uint64_t with |Hash|, then mixed with
+// HashInt64(). A filter written with WriteToPickle() must be read by a
+// process that hashes the values the same way, which may be a 32-bit build
+// reading the filter of a 64-bit one. StableHash, the default, hashes
+// integers and strings the same on every build; a custom |Hash| must too,
+// so it must not narrow its result to size_t.
+//
+// Example:
+//   winbase::BloomFilter<uint64_t> filter(ids.size());
+//   for (uint64_t id : ids)
+//     filter.Add(id);
+//   ...
+//   if (!filter.MayContain(id))
+//     return nullptr;  // Not in the index; skip the disk.
+//
+// A filter read with MapFromPickle() uses the bits in place, so a filter
+// written to a file can be used from a MemoryMappedFile through a PickleView
+// without copying it.
+template <typename T, typename Hash = StableHash<T>>
+class BloomFilter {
+  // A size_t hash would differ between 32-bit and 64-bit builds.
+  static_assert(std::is_same<decltype(Hash()(std::declval<const T&>())),
+                             uint64_t>::value,
+                "Hash must return a uint64_t; see StableHash");
+
+ public:
+  // Creates an empty filter that contains nothing and cannot be added to.
+  // Assign it or read it from a pickle before use.
+  BloomFilter() = default;
+
+  // Creates a filter sized for |expected_count| values at |bits_per_value|
+  // bits each.
+  explicit BloomFilter(size_t expected_count, size_t bits_per_value = 10) {
+    size_t bits = std::max<size_t>(expected_count, 1) * bits_per_value;
+    size_t num_blocks = (bits + kBitsPerBlock - 1) / kBitsPerBlock;
+    WINBASE_CHECK(num_blocks <= kMaxBlocks);
+    owned_.resize(num_blocks);
+    num_blocks_ = num_blocks;
+  }
+
+  BloomFilter(const BloomFilter&) = default;
+  BloomFilter& operator=(const BloomFilter&) = default;
+
+  // A moved-from filter is empty.
+  BloomFilter(BloomFilter&& other) noexcept
+      : owned_(std::move(other.owned_)),
+        num_blocks_(std::exchange(other.num_blocks_, 0)),
+        mapped_(std::exchange(other.mapped_, nullptr)) {}
+
+  BloomFilter& operator=(BloomFilter&& other) noexcept {
+    owned_ = std::move(other.owned_);
+    num_blocks_ = std::exchange(other.num_blocks_, 0);
+    mapped_ = std::exchange(other.mapped_, nullptr);
+    return *this;
+  }
+
+  // Adds |value|. The filter must not be mapped.
+  void Add(const T& value) {
+    WINBASE_DCHECK(!mapped_);
+    WINBASE_DCHECK(num_blocks_);
+    uint64_t hash = HashInt64(Hash()(value));
+    uint64_t masks[8];
+    internal::BloomFilterMasks(static_cast<uint32_t>(hash), masks);
+    uint64_t* words = owned_[BlockIndex(hash)].words;
+    for (int i = 0; i < 8; ++i)
+      words[i] |= masks[i];
+  }
+
+  // Returns false if |value| was not added, and true if it was or, rarely,
+  // if it was not.
+  bool MayContain(const T& value) const {
+    if (UNLIKELY(!num_blocks_))
+      return false;
+    uint64_t hash = HashInt64(Hash()(value));
+    uint64_t masks[8];
+    internal::BloomFilterMasks(static_cast<uint32_t>(hash), masks);
+    return internal::BloomFilterBlockHas(
+        data() + BlockIndex(hash) * sizeof(Block), masks);
+  }
+
+  // Removes every value. The filter must not be mapped.
+  void Clear() {
+    WINBASE_DCHECK(!mapped_);
+    std::fill(owned_.begin(), owned_.end(), Block());
+  }
+
+  // The size of the bits of the filter.
+  size_t size_in_bytes() const { return num_blocks_ * sizeof(Block); }
+
+  // Writes the filter to |pickle|.
+  void WriteToPickle(Pickle* pickle) const {
+    pickle->WriteUInt32(kPickleVersion);
+    pickle->WriteUInt64(num_blocks_);
+    pickle->WriteData(data(), static_cast<int>(size_in_bytes()));
+  }
+
+  // Reads a filter written by WriteToPickle(), copying its bits. Returns
+  // false and leaves the filter unchanged if the data is not valid.
+  bool ReadFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT {
+    const char* data;
+    size_t num_blocks;
+    if (!ReadPickle(iter, &data, &num_blocks))
+      return false;
+    std::vector<Block> owned(num_blocks);
+    if (num_blocks)
+      memcpy(owned.data(), data, num_blocks * sizeof(Block));
+    owned_ = std::move(owned);
+    num_blocks_ = num_blocks;
+    mapped_ = nullptr;
+    return true;
+  }
+
+  // Like ReadFromPickle(), but the filter reads its bits from the buffer of
+  // the pickle, which must outlive it or be replaced first. Add() and Clear()
+  // must not be called on a mapped filter.
+  bool MapFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT {
+    const char* data;
+    size_t num_blocks;
+    if (!ReadPickle(iter, &data, &num_blocks))
+      return false;
+    owned_.clear();
+    owned_.shrink_to_fit();
+    num_blocks_ = num_blocks;
+    mapped_ = data;
+    return true;
+  }
+
+ private:
+  using Block = internal::BloomFilterBlock;
+
+  static constexpr size_t kBitsPerBlock = sizeof(Block) * 8;
+
+  // WriteData() takes an int, and BlockIndex() a 32-bit count.
+  static constexpr size_t kMaxBlocks =
+      std::numeric_limits<int>::max() / sizeof(Block);
+
+  // Changes whenever the layout of the bits or the hashing changes.
+  static constexpr uint32_t kPickleVersion = 2;
+
+  const char* data() const {
+    return mapped_ ? mapped_ : reinterpret_cast<const char*>(owned_.data());
+  }
+
+  // Picks a block with the top 32 bits of |hash|, scaled to the number of
+  // blocks so that it need not be a power of two. The bits in the block
+  // come from the bottom 32 bits.
+  size_t BlockIndex(uint64_t hash) const {
+    return static_cast<size_t>(((hash >> 32) * num_blocks_) >> 32);
+  }
+
+  static bool ReadPickle(PickleIterator* iter,
+                         const char** data,
+                         size_t* num_blocks) {
+    uint32_t version;
+    uint64_t count;
+    int length;
+    if (!iter->ReadUInt32(&version) || version != kPickleVersion ||
+        !iter->ReadUInt64(&count) || count > kMaxBlocks ||
+        !iter->ReadData(data, &length) ||
+        static_cast<uint64_t>(length) != count * sizeof(Block)) {
+      return false;
+    }
+    *num_blocks = static_cast<size_t>(count);
+    return true;
+  }
+
+  std::vector<Block> owned_;
+  size_t num_blocks_ = 0;
+
+  // The bits of a mapped filter, or null.
+  const char* mapped_ = nullptr;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_BLOOM_FILTER_H_
\ No newline at end of file
@@ -0,0 +1,588 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_CHUNKED_DEQUE_H_
+#define WINLIB_WINBASE_CONTAINERS_CHUNKED_DEQUE_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\logging.h"
+
+// winbase::chunked_deque is a double-ended queue for queues that grow large.
+// The elements are stored in chunks of a fixed number of elements (about
+// 4 KiB of them, and at least 16), and the deque keeps a ring of pointers to
+// its chunks. Pushing at either end constructs the element in place, taking
+// a new chunk when the end chunk is full; popping the last element of a
+// chunk returns it to a pool of spare chunks owned by the deque. Unlike
+// circular_deque, elements are never moved after they are constructed, so
+//
+//  - pushes and pops take constant time: the only reallocation is that of
+//    the ring of chunk pointers, one pointer per chunk, amortized;
+//  - growing does not need the old and the new buffer at the same time;
+//  - REFERENCES AND POINTERS TO ELEMENTS STAY VALID until the element is
+//    popped, across pushes at either end.
+//
+// Iterators hold a position, and are invalidated by push_front() and by any
+// pop.
+//
+// The deque does not shrink by itself: the chunks emptied by pops are kept
+// for later pushes, so that reserve() means what it says and a queue that
+// oscillates around a chunk boundary does not allocate. clear() keeps them
+// too; call shrink_to_fit() to free them.
+//
+// Unlike std::deque, there is no insertion or erasure in the middle, and no
+// container-wide comparison.
+//
+// Constructors:
+//   chunked_deque();
+//   chunked_deque(size_t count);
+//   chunked_deque(size_t count, const T& value);
+//   chunked_deque(InputIterator first, InputIterator last);
+//   chunked_deque(const chunked_deque&);
+//   chunked_deque(chunked_deque&&);
+//   chunked_deque(std::initializer_list<value_type>);
+//
+// Assignment functions:
+//   chunked_deque& operator=(const chunked_deque&);
+//   chunked_deque& operator=(chunked_deque&&);
+//
+// Random accessors:
+//   T& at(size_t);
+//   const T& at(size_t) const;
+//   T& operator[](size_t);
+//   const T& operator[](size_t) const;
+//
+// End accessors:
+//   T& front();
+//   const T& front() const;
+//   T& back();
+//   const T& back() const;
+//
+// Iterator functions:
+//   iterator               begin();
+//   const_iterator         begin() const;
+//   const_iterator         cbegin() const;
+//   iterator               end();
+//   const_iterator         end() const;
+//   const_iterator         cend() const;
+//   reverse_iterator       rbegin();
+//   const_reverse_iterator rbegin() const;
+//   const_reverse_iterator crbegin() const;
+//   reverse_iterator       rend();
+//   const_reverse_iterator rend() const;
+//   const_reverse_iterator crend() const;
+//
+// Memory management:
+//   void reserve(size_t);  // Room for push_back() without allocating.
+//   size_t capacity() const;
+//   void shrink_to_fit();  // Frees the spare chunks.
+//
+// Size management:
+//   void clear();
+//   bool empty() const;
+//   size_t size() const;
+//   void resize(size_t);
+//   void resize(size_t count, const T& value);
+//
+// End insert and erase:
+//   void push_front(const T&);
+//   void push_front(T&&);
+//   void push_back(const T&);
+//   void push_back(T&&);
+//   T& emplace_front(Args&&...);
+//   T& emplace_back(Args&&...);
+//   void pop_front();
+//   void pop_back();
+//
+// General:
+//   void swap(chunked_deque&);
+
+namespace winbase {
+
+template <class T>
+class chunked_deque;
+
+namespace internal {
+
+// The number of elements in a chunk of a chunked_deque of T: the largest
+// power of two that fits in 4 KiB, but at least 16.
+template <typename T>
+constexpr size_t ChunkedDequeChunkSize() {
+  size_t size = 16;
+  while (size * 2 * sizeof(T) <= 4096)
+    size *= 2;
+  return size;
+}
+
+template <typename T, bool is_const>
+class chunked_deque_iterator {
+ public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = T;
+  using pointer = std::conditional_t<is_const, const T*, T*>;
+  using reference = std::conditional_t<is_const, const T&, T&>;
+  using iterator_category = std::random_access_iterator_tag;
+
+  chunked_deque_iterator() = default;
+
+  // An iterator converts to a const_iterator.
+  template <bool other_is_const,
+            typename = std::enable_if_t<is_const && !other_is_const>>
+  chunked_deque_iterator(const chunked_deque_iterator<T, other_is_const>& other)
+      : parent_deque_(other.parent_deque_), index_(other.index_) {}
+
+  reference operator*() const { return *parent_deque_->Slot(index_); }
+  pointer operator->() const { return parent_deque_->Slot(index_); }
+  reference operator[](difference_type i) const { return *(*this + i); }
+
+  chunked_deque_iterator& operator++() {
+    ++index_;
+    return *this;
+  }
+  chunked_deque_iterator operator++(int) {
+    chunked_deque_iterator ret = *this;
+    ++index_;
+    return ret;
+  }
+  chunked_deque_iterator& operator--() {
+    --index_;
+    return *this;
+  }
+  chunked_deque_iterator operator--(int) {
+    chunked_deque_iterator ret = *this;
+    --index_;
+    return ret;
+  }
+
+  chunked_deque_iterator& operator+=(difference_type offset) {
+    index_ += offset;
+    return *this;
+  }
+  chunked_deque_iterator& operator-=(difference_type offset) {
+    index_ -= offset;
+    return *this;
+  }
+  friend chunked_deque_iterator operator+(const chunked_deque_iterator& iter,
+                                          difference_type offset) {
+    chunked_deque_iterator ret = iter;
+    ret += offset;
+    return ret;
+  }
+  friend chunked_deque_iterator operator+(difference_type offset,
+                                          const chunked_deque_iterator& iter) {
+    return iter + offset;
+  }
+  friend chunked_deque_iterator operator-(const chunked_deque_iterator& iter,
+                                          difference_type offset) {
+    chunked_deque_iterator ret = iter;
+    ret -= offset;
+    return ret;
+  }
+  friend difference_type operator-(const chunked_deque_iterator& lhs,
+                                   const chunked_deque_iterator& rhs) {
+    return static_cast<difference_type>(lhs.index_ - rhs.index_);
+  }
+
+  friend bool operator==(const chunked_deque_iterator& lhs,
+                         const chunked_deque_iterator& rhs) {
+    return lhs.index_ == rhs.index_;
+  }
+  friend bool operator!=(const chunked_deque_iterator& lhs,
+                         const chunked_deque_iterator& rhs) {
+    return lhs.index_ != rhs.index_;
+  }
+  friend bool operator<(const chunked_deque_iterator& lhs,
+                        const chunked_deque_iterator& rhs) {
+    return lhs.index_ < rhs.index_;
+  }
+  friend bool operator<=(const chunked_deque_iterator& lhs,
+                         const chunked_deque_iterator& rhs) {
+    return lhs.index_ <= rhs.index_;
+  }
+  friend bool operator>(const chunked_deque_iterator& lhs,
+                        const chunked_deque_iterator& rhs) {
+    return lhs.index_ > rhs.index_;
+  }
+  friend bool operator>=(const chunked_deque_iterator& lhs,
+                         const chunked_deque_iterator& rhs) {
+    return lhs.index_ >= rhs.index_;
+  }
+
+ private:
+  friend class chunked_deque<T>;
+  friend class chunked_deque_iterator<T, !is_const>;
+
+  chunked_deque_iterator(const chunked_deque<T>* parent, size_t index)
+      : parent_deque_(parent), index_(index) {}
+
+  const chunked_deque<T>* parent_deque_ = nullptr;
+  size_t index_ = 0;
+};
+
+}  // namespace internal
+
+template <typename T>
+class chunked_deque {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+
+  using iterator = internal::chunked_deque_iterator<T, false>;
+  using const_iterator = internal::chunked_deque_iterator<T, true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // The number of elements in a chunk.
+  static constexpr size_t kChunkSize = internal::ChunkedDequeChunkSize<T>();
+
+  // ---------------------------------------------------------------------------
+  // Constructor
+
+  chunked_deque() = default;
+
+  explicit chunked_deque(size_type count) { resize(count); }
+  chunked_deque(size_type count, const T& value) { resize(count, value); }
+
+  template <class InputIterator,
+            typename = std::enable_if_t<std::is_base_of<
+                std::input_iterator_tag,
+                typename std::iterator_traits<
+                    InputIterator>::iterator_category>::value>>
+  chunked_deque(InputIterator first, InputIterator last) {
+    for (; first != last; ++first)
+      emplace_back(*first);
+  }
+
+  chunked_deque(std::initializer_list<value_type> init)
+      : chunked_deque(init.begin(), init.end()) {}
+
+  chunked_deque(const chunked_deque& other) { *this = other; }
+
+  // A moved-from deque is empty and has no chunks.
+  chunked_deque(chunked_deque&& other) noexcept { swap(other); }
+
+  ~chunked_deque() {
+    clear();
+    shrink_to_fit();
+  }
+
+  // ---------------------------------------------------------------------------
+  // Assignments.
+
+  chunked_deque& operator=(const chunked_deque& other) {
+    if (&other == this)
+      return *this;
+    clear();
+    reserve(other.size());
+    for (const T& value : other)
+      emplace_back(value);
+    return *this;
+  }
+
+  chunked_deque& operator=(chunked_deque&& other) noexcept {
+    chunked_deque(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Accessors.
+
+  const value_type& at(size_type i) const {
+    WINBASE_CHECK(i < size_);
+    return *Slot(i);
+  }
+  value_type& at(size_type i) {
+    WINBASE_CHECK(i < size_);
+    return *Slot(i);
+  }
+
+  value_type& operator[](size_type i) {
+    WINBASE_DCHECK(i < size_);
+    return *Slot(i);
+  }
+  const value_type& operator[](size_type i) const {
+    WINBASE_DCHECK(i < size_);
+    return *Slot(i);
+  }
+
+  value_type& front() { return (*this)[0]; }
+  const value_type& front() const { return (*this)[0]; }
+  value_type& back() { return (*this)[size_ - 1]; }
+  const value_type& back() const { return (*this)[size_ - 1]; }
+
+  // ---------------------------------------------------------------------------
+  // Iterators.
+
+  iterator begin() { return iterator(this, 0); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator cbegin() const { return begin(); }
+
+  iterator end() { return iterator(this, size_); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  const_iterator cend() const { return end(); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crend() const { return rend(); }
+
+  // ---------------------------------------------------------------------------
+  // Memory management.
+
+  // Makes room for pushing |new_capacity| - size() elements at the back
+  // without allocating.
+  void reserve(size_type new_capacity) {
+    if (new_capacity <= capacity())
+      return;
+    size_t chunks = (begin_ + new_capacity + kChunkSize - 1) / kChunkSize;
+    ReserveMap(chunks);
+    while (num_chunks_ + spare_chunks_.size() < chunks)
+      spare_chunks_.push_back(new Chunk);
+  }
+
+  // The number of elements the deque can hold before push_back() allocates.
+  size_type capacity() const {
+    return (num_chunks_ + spare_chunks_.size()) * kChunkSize - begin_;
+  }
+
+  // Frees the spare chunks, and shrinks the ring of chunk pointers to fit.
+  void shrink_to_fit() {
+    for (Chunk* chunk : spare_chunks_)
+      delete chunk;
+    spare_chunks_.clear();
+    spare_chunks_.shrink_to_fit();
+    ResizeMap(num_chunks_ ? RoundUpToPowerOfTwo(num_chunks_) : 0);
+  }
+
+  // ---------------------------------------------------------------------------
+  // Size management.
+
+  // Destroys the elements. The chunks are kept as spares.
+  void clear() {
+    while (num_chunks_) {
+      Chunk* chunk = ChunkAt(0);
+      size_t end = std::min(begin_ + size_, kChunkSize);
+      for (size_t i = begin_; i < end; ++i)
+        chunk->at(i)->~T();
+      size_ -= end - begin_;
+      begin_ = 0;
+      ReleaseFrontChunk();
+    }
+  }
+
+  bool empty() const { return !size_; }
+  size_type size() const { return size_; }
+
+  void resize(size_type count) {
+    while (size_ > count)
+      pop_back();
+    reserve(count);
+    while (size_ < count)
+      emplace_back();
+  }
+
+  void resize(size_type count, const value_type& value) {
+    while (size_ > count)
+      pop_back();
+    reserve(count);
+    while (size_ < count)
+      emplace_back(value);
+  }
+
+  // ---------------------------------------------------------------------------
+  // End insert and erase.
+
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  template <class... Args>
+  reference emplace_front(Args&&... args) {
+    if (!begin_) {
+      AddFrontChunk();
+      begin_ = kChunkSize;
+    }
+    T* slot = ChunkAt(0)->at(begin_ - 1);
+    new (slot) T(std::forward<Args>(args)...);
+    --begin_;
+    ++size_;
+    return *slot;
+  }
+
+  template <class... Args>
+  reference emplace_back(Args&&... args) {
+    size_t position = begin_ + size_;
+    if (position / kChunkSize == num_chunks_)
+      AddBackChunk();
+    T* slot = SlotAt(position);
+    new (slot) T(std::forward<Args>(args)...);
+    ++size_;
+    return *slot;
+  }
+
+  void pop_front() {
+    WINBASE_DCHECK(size_);
+    ChunkAt(0)->at(begin_)->~T();
+    ++begin_;
+    --size_;
+    if (begin_ == kChunkSize || !size_) {
+      begin_ = 0;
+      ReleaseFrontChunk();
+    }
+  }
+
+  void pop_back() {
+    WINBASE_DCHECK(size_);
+    --size_;
+    size_t position = begin_ + size_;
+    SlotAt(position)->~T();
+    if (!size_) {
+      begin_ = 0;
+      ReleaseBackChunk();
+    } else if (position % kChunkSize == 0) {
+      ReleaseBackChunk();
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // General operations.
+
+  void swap(chunked_deque& other) noexcept {
+    map_.swap(other.map_);
+    std::swap(map_head_, other.map_head_);
+    std::swap(num_chunks_, other.num_chunks_);
+    std::swap(begin_, other.begin_);
+    std::swap(size_, other.size_);
+    spare_chunks_.swap(other.spare_chunks_);
+  }
+
+  friend void swap(chunked_deque& lhs, chunked_deque& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  template <typename, bool>
+  friend class internal::chunked_deque_iterator;
+
+  struct Chunk {
+    T* at(size_t i) { return reinterpret_cast<T*>(&slots[i]); }
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> slots[kChunkSize];
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value)
+      result <<= 1;
+    return result;
+  }
+
+  // The |i|th chunk in use, counting from the front.
+  Chunk* ChunkAt(size_t i) const {
+    return map_[(map_head_ + i) & (map_.size() - 1)];
+  }
+
+  // The slot of the element at |position|, counting from the first slot of
+  // the front chunk.
+  T* SlotAt(size_t position) const {
+    return ChunkAt(position / kChunkSize)->at(position % kChunkSize);
+  }
+
+  // The slot of the |i|th element.
+  T* Slot(size_t i) const { return SlotAt(begin_ + i); }
+
+  Chunk* TakeChunk() {
+    if (spare_chunks_.empty())
+      return new Chunk;
+    Chunk* chunk = spare_chunks_.back();
+    spare_chunks_.pop_back();
+    return chunk;
+  }
+
+  void AddFrontChunk() {
+    ReserveMap(num_chunks_ + 1);
+    map_head_ = (map_head_ - 1) & (map_.size() - 1);
+    map_[map_head_] = TakeChunk();
+    ++num_chunks_;
+  }
+
+  void AddBackChunk() {
+    ReserveMap(num_chunks_ + 1);
+    map_[(map_head_ + num_chunks_) & (map_.size() - 1)] = TakeChunk();
+    ++num_chunks_;
+  }
+
+  void ReleaseFrontChunk() {
+    spare_chunks_.push_back(ChunkAt(0));
+    map_head_ = (map_head_ + 1) & (map_.size() - 1);
+    --num_chunks_;
+  }
+
+  void ReleaseBackChunk() {
+    spare_chunks_.push_back(ChunkAt(num_chunks_ - 1));
+    --num_chunks_;
+  }
+
+  // Makes the ring of chunk pointers hold at least |chunks| chunks, doubling
+  // it so that pushes stay amortized constant time.
+  void ReserveMap(size_t chunks) {
+    if (chunks > map_.size())
+      ResizeMap(std::max(RoundUpToPowerOfTwo(chunks), map_.size() * 2));
+  }
+
+  // Copies the pointers to the chunks in use to a ring of |size| entries, a
+  // power of two, starting at its first entry.
+  void ResizeMap(size_t size) {
+    if (size == map_.size())
+      return;
+    WINBASE_DCHECK(size >= num_chunks_);
+    std::vector<Chunk*> map(size);
+    for (size_t i = 0; i < num_chunks_; ++i)
+      map[i] = ChunkAt(i);
+    map_.swap(map);
+    map_head_ = 0;
+  }
+
+  // The ring of pointers to the chunks in use, whose size is zero or a power
+  // of two. The front chunk is at |map_head_|.
+  std::vector<Chunk*> map_;
+  size_t map_head_ = 0;
+  size_t num_chunks_ = 0;
+
+  // The position of the front element in the front chunk, and the number of
+  // elements. The elements fill the chunks in use from |begin_| on, so there
+  // is no chunk in use when the deque is empty.
+  size_t begin_ = 0;
+  size_t size_ = 0;
+
+  // The chunks that are not in use, owned by the deque.
+  std::vector<Chunk*> spare_chunks_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_CHUNKED_DEQUE_H_
\ No newline at end of file
@@ -0,0 +1,357 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_CUCKOO_FILTER_H_
+#define WINLIB_WINBASE_CONTAINERS_CUCKOO_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\bits.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+#include "winbase\pickle.h"
+
+namespace winbase {
+
+// CuckooFilter answers whether a value may have been added to it, like
+// BloomFilter, but also lets values be removed. It stores a 16-bit
+// fingerprint of each value in one of two buckets of four picked by the hash
+// of the value; a "yes" is wrong for about 0.01% of the values that were
+// never added. It takes about 2.1 bytes per value when full, which it gets at
+// 95% of its slots.
+//
+// A lookup reads two 8-byte buckets and compares the fingerprint with their
+// eight slots at once, as 16-bit lanes of two 64-bit words.
+//
+// Adding a value to a full pair of buckets moves fingerprints to their other
+// bucket, cuckoo hashing style. When that fails, the last fingerprint moved
+// is kept aside and the filter is full: further calls to Add() return false
+// until a value is removed. Size the filter for the number of values it is
+// expected to hold.
+//
+// Only remove values that were added: removing another value may remove the
+// fingerprint of an added value that shares it. Adding a value several times
+// stores as many copies of its fingerprint, up to eight, which each take a
+// Remove().
+//
+// Like BloomFilter, the filter can be written to a Pickle and read back or
+// used in place with MapFromPickle(), and the values must be hashed the same
+// way by the writer and the reader; see bloom_filter.h.
+template <typename T, typename Hash = StableHash<T>>
+class CuckooFilter {
+  // A size_t hash would differ between 32-bit and 64-bit builds.
+  static_assert(std::is_same<decltype(Hash()(std::declval<const T&>())),
+                             uint64_t>::value,
+                "Hash must return a uint64_t; see StableHash");
+
+ public:
+  // Creates an empty filter that contains nothing and cannot be added to.
+  // Assign it or read it from a pickle before use.
+  CuckooFilter() = default;
+
+  // Creates a filter for up to |expected_count| values. The number of buckets
+  // is a power of two, so the filter may hold up to twice as many.
+  explicit CuckooFilter(size_t expected_count) {
+    size_t num_buckets = 1;
+    while (num_buckets * kSlotsPerBucket * kMaxLoadPercent <
+           expected_count * 100) {
+      num_buckets *= 2;
+    }
+    WINBASE_CHECK(num_buckets <= kMaxBuckets);
+    owned_.resize(num_buckets);
+    num_buckets_ = num_buckets;
+  }
+
+  CuckooFilter(const CuckooFilter&) = default;
+  CuckooFilter& operator=(const CuckooFilter&) = default;
+
+  // A moved-from filter is empty.
+  CuckooFilter(CuckooFilter&& other) noexcept
+      : owned_(std::move(other.owned_)),
+        num_buckets_(std::exchange(other.num_buckets_, 0)),
+        size_(std::exchange(other.size_, 0)),
+        victim_(std::exchange(other.victim_, Victim())),
+        mapped_(std::exchange(other.mapped_, nullptr)),
+        random_(other.random_) {}
+
+  CuckooFilter& operator=(CuckooFilter&& other) noexcept {
+    owned_ = std::move(other.owned_);
+    num_buckets_ = std::exchange(other.num_buckets_, 0);
+    size_ = std::exchange(other.size_, 0);
+    victim_ = std::exchange(other.victim_, Victim());
+    mapped_ = std::exchange(other.mapped_, nullptr);
+    random_ = other.random_;
+    return *this;
+  }
+
+  // Adds |value|. Returns false if the filter is full, in which case it is
+  // unchanged. The filter must not be mapped.
+  bool Add(const T& value) {
+    WINBASE_DCHECK(!mapped_);
+    if (victim_.used || !num_buckets_)
+      return false;
+    uint16_t fingerprint;
+    size_t index;
+    HashValue(value, &fingerprint, &index);
+    ++size_;
+    if (InsertToBucket(index, fingerprint) ||
+        InsertToBucket(AltIndex(index, fingerprint), fingerprint)) {
+      return true;
+    }
+
+    // Move a random fingerprint of a full bucket to its other bucket, until
+    // one has room.
+    for (int kicks = 0; kicks < kMaxKicks; ++kicks) {
+      random_ ^= random_ << 13;
+      random_ ^= random_ >> 17;
+      random_ ^= random_ << 5;
+      int slot = random_ % kSlotsPerBucket;
+      uint16_t evicted = GetSlot(owned_[index], slot);
+      SetSlot(&owned_[index], slot, fingerprint);
+      fingerprint = evicted;
+      index = AltIndex(index, fingerprint);
+      if (InsertToBucket(index, fingerprint))
+        return true;
+    }
+    victim_.fingerprint = fingerprint;
+    victim_.index = index;
+    victim_.used = true;
+    return true;
+  }
+
+  // Returns false if |value| was not added, and true if it was or, rarely,
+  // if it was not.
+  bool MayContain(const T& value) const {
+    if (UNLIKELY(!num_buckets_))
+      return false;
+    uint16_t fingerprint;
+    size_t index;
+    HashValue(value, &fingerprint, &index);
+    size_t alt_index = AltIndex(index, fingerprint);
+    if (BucketHas(GetBucket(index), fingerprint) |
+        BucketHas(GetBucket(alt_index), fingerprint)) {
+      return true;
+    }
+    return victim_.used && victim_.fingerprint == fingerprint &&
+           (victim_.index == index || victim_.index == alt_index);
+  }
+
+  // Removes one copy of the fingerprint of |value|, which must have been
+  // added. Returns false if it was not found. The filter must not be mapped.
+  bool Remove(const T& value) {
+    WINBASE_DCHECK(!mapped_);
+    if (!num_buckets_)
+      return false;
+    uint16_t fingerprint;
+    size_t index;
+    HashValue(value, &fingerprint, &index);
+    size_t alt_index = AltIndex(index, fingerprint);
+    if (victim_.used && victim_.fingerprint == fingerprint &&
+        (victim_.index == index || victim_.index == alt_index)) {
+      victim_.used = false;
+      --size_;
+      return true;
+    }
+    if (!RemoveFromBucket(index, fingerprint) &&
+        !RemoveFromBucket(alt_index, fingerprint)) {
+      return false;
+    }
+    --size_;
+
+    // The freed slot may give the fingerprint kept aside a place.
+    if (victim_.used &&
+        (InsertToBucket(victim_.index, victim_.fingerprint) ||
+         InsertToBucket(AltIndex(victim_.index, victim_.fingerprint),
+                        victim_.fingerprint))) {
+      victim_.used = false;
+    }
+    return true;
+  }
+
+  // Removes every value. The filter must not be mapped.
+  void Clear() {
+    WINBASE_DCHECK(!mapped_);
+    std::fill(owned_.begin(), owned_.end(), 0);
+    size_ = 0;
+    victim_ = Victim();
+  }
+
+  // The number of fingerprints in the filter.
+  size_t size() const { return size_; }
+
+  // The size of the buckets of the filter.
+  size_t size_in_bytes() const { return num_buckets_ * sizeof(uint64_t); }
+
+  // Writes the filter to |pickle|.
+  void WriteToPickle(Pickle* pickle) const {
+    pickle->WriteUInt32(kPickleVersion);
+    pickle->WriteUInt64(num_buckets_);
+    pickle->WriteUInt64(size_);
+    pickle->WriteBool(victim_.used);
+    pickle->WriteUInt16(victim_.fingerprint);
+    pickle->WriteUInt64(victim_.index);
+    pickle->WriteData(data(), static_cast<int>(size_in_bytes()));
+  }
+
+  // Reads a filter written by WriteToPickle(), copying its buckets. Returns
+  // false and leaves the filter unchanged if the data is not valid.
+  bool ReadFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT {
+    CuckooFilter filter;
+    const char* data;
+    if (!filter.ReadPickle(iter, &data))
+      return false;
+    filter.owned_.resize(filter.num_buckets_);
+    if (filter.num_buckets_)
+      memcpy(filter.owned_.data(), data, filter.size_in_bytes());
+    *this = std::move(filter);
+    return true;
+  }
+
+  // Like ReadFromPickle(), but the filter reads its buckets from the buffer
+  // of the pickle, which must outlive it or be replaced first. Add(),
+  // Remove() and Clear() must not be called on a mapped filter.
+  bool MapFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT {
+    CuckooFilter filter;
+    if (!filter.ReadPickle(iter, &filter.mapped_))
+      return false;
+    *this = std::move(filter);
+    return true;
+  }
+
+ private:
+  // A fingerprint that was moved out of its buckets and had nowhere to go.
+  struct Victim {
+    uint16_t fingerprint = 0;
+    size_t index = 0;
+    bool used = false;
+  };
+
+  static constexpr int kSlotsPerBucket = 4;
+  static constexpr size_t kMaxLoadPercent = 95;
+  static constexpr int kMaxKicks = 500;
+
+  // WriteData() takes an int.
+  static constexpr size_t kMaxBuckets =
+      std::numeric_limits<int>::max() / sizeof(uint64_t);
+
+  // Changes whenever the layout of the buckets or the hashing changes.
+  static constexpr uint32_t kPickleVersion = 2;
+
+  static constexpr uint64_t kLowBits = 0x0001000100010001ULL;
+
+  // Returns true if one of the four fingerprints of |bucket| is
+  // |fingerprint|: a lane of |bucket ^ fingerprint| is zero, which the
+  // subtraction detects with the borrow it takes from the top bit of the
+  // lane.
+  static bool BucketHas(uint64_t bucket, uint16_t fingerprint) {
+    uint64_t lanes = bucket ^ (fingerprint * kLowBits);
+    return ((lanes - kLowBits) & ~lanes & (kLowBits << 15)) != 0;
+  }
+
+  static uint16_t GetSlot(uint64_t bucket, int slot) {
+    return static_cast<uint16_t>(bucket >> (slot * 16));
+  }
+
+  static void SetSlot(uint64_t* bucket, int slot, uint16_t fingerprint) {
+    *bucket &= ~(uint64_t(0xffff) << (slot * 16));
+    *bucket |= uint64_t(fingerprint) << (slot * 16);
+  }
+
+  const char* data() const {
+    return mapped_ ? mapped_ : reinterpret_cast<const char*>(owned_.data());
+  }
+
+  uint64_t GetBucket(size_t index) const {
+    uint64_t bucket;
+    memcpy(&bucket, data() + index * sizeof(bucket), sizeof(bucket));
+    return bucket;
+  }
+
+  // The fingerprint is the top 16 bits of the hash, never 0 as that marks
+  // an empty slot, and the bucket comes from the bottom bits.
+  void HashValue(const T& value, uint16_t* fingerprint, size_t* index) const {
+    uint64_t hash = HashInt64(Hash()(value));
+    *fingerprint = std::max<uint16_t>(static_cast<uint16_t>(hash >> 48), 1);
+    *index = static_cast<size_t>(hash) & (num_buckets_ - 1);
+  }
+
+  // The other bucket of |fingerprint|. Going from either bucket gives the
+  // other one, so a fingerprint can be moved without knowing its value.
+  size_t AltIndex(size_t index, uint16_t fingerprint) const {
+    return (index ^ static_cast<size_t>(HashInt64(fingerprint))) &
+           (num_buckets_ - 1);
+  }
+
+  bool InsertToBucket(size_t index, uint16_t fingerprint) {
+    for (int slot = 0; slot < kSlotsPerBucket; ++slot) {
+      if (!GetSlot(owned_[index], slot)) {
+        SetSlot(&owned_[index], slot, fingerprint);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool RemoveFromBucket(size_t index, uint16_t fingerprint) {
+    for (int slot = 0; slot < kSlotsPerBucket; ++slot) {
+      if (GetSlot(owned_[index], slot) == fingerprint) {
+        SetSlot(&owned_[index], slot, 0);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Reads everything but the buckets into this filter, and points |data| at
+  // the buckets in the pickle.
+  bool ReadPickle(PickleIterator* iter, const char** data) {
+    uint32_t version;
+    uint64_t num_buckets;
+    uint64_t size;
+    uint16_t victim_fingerprint;
+    uint64_t victim_index;
+    int length;
+    if (!iter->ReadUInt32(&version) || version != kPickleVersion ||
+        !iter->ReadUInt64(&num_buckets) || num_buckets > kMaxBuckets ||
+        (num_buckets && !bits::IsPowerOfTwo(num_buckets)) ||
+        !iter->ReadUInt64(&size) || !iter->ReadBool(&victim_.used) ||
+        !iter->ReadUInt16(&victim_fingerprint) ||
+        !iter->ReadUInt64(&victim_index) ||
+        (victim_.used && victim_index >= num_buckets) ||
+        !iter->ReadData(data, &length) ||
+        static_cast<uint64_t>(length) != num_buckets * sizeof(uint64_t)) {
+      return false;
+    }
+    num_buckets_ = static_cast<size_t>(num_buckets);
+    size_ = static_cast<size_t>(size);
+    victim_.fingerprint = victim_fingerprint;
+    victim_.index = static_cast<size_t>(victim_index);
+    return true;
+  }
+
+  // One uint64_t per bucket, holding four 16-bit fingerprints; 0 is empty.
+  std::vector<uint64_t> owned_;
+  size_t num_buckets_ = 0;
+  size_t size_ = 0;
+  Victim victim_;
+
+  // The buckets of a mapped filter, or null.
+  const char* mapped_ = nullptr;
+
+  // State of the xorshift generator that picks fingerprints to move.
+  uint32_t random_ = 2463534242U;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_CUCKOO_FILTER_H_
\ No newline at end of file
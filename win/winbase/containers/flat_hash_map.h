@@ -0,0 +1,217 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FLAT_HASH_MAP_H_
+#define WINLIB_WINBASE_CONTAINERS_FLAT_HASH_MAP_H_
+
+#include <functional>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "winbase\containers\flat_hash_table.h"
+#include "winbase\containers\flat_map.h"
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+// flat_hash_map is a hash map with a std::unordered_map-like interface that
+// stores its values in one open addressed array instead of one node each.
+//
+// PROS
+//
+//  - Lookups take O(1) and usually touch two cache lines: one group of
+//    control bytes, matched with SSE2, and the slot of the value.
+//  - No allocation per value.
+//  - Heterogeneous lookup: with the default hasher, a map keyed by
+//    std::string or string16 can be searched with a StringPiece or
+//    StringPiece16.
+//
+// CONS
+//
+//  - Inserting may move every value, so it invalidates iterators, pointers
+//    and references. Erasing only invalidates the erased value.
+//  - Iteration is in no particular order and visits every slot, so it gets
+//    slow in a large map that had most of its values erased.
+//
+// Prefer flat_map for small maps or ordered iteration, and flat_hash_map for
+// large maps mostly used for point lookups.
+//
+// The hasher defaults to FlatHash (see hash.h), which mixes the bits of
+// integers so that both the bits picking the slot and the 7 bits stored in
+// the control byte vary. A custom hasher must do the same.
+//
+// QUICK REFERENCE
+//
+// Most of the core functionality is inherited from flat_hash_table. As a
+// quick reference, the functions available are:
+//
+// Constructors (inputs may have equal keys; the first is kept):
+//   flat_hash_map(InputIterator first, InputIterator last,
+//                 const Hash& = Hash(), const KeyEqual& = KeyEqual());
+//   flat_hash_map(std::initializer_list<value_type>,
+//                 const Hash& = Hash(), const KeyEqual& = KeyEqual());
+//   flat_hash_map(const flat_hash_map&);
+//   flat_hash_map(flat_hash_map&&);
+//
+// Memory and size management functions:
+//   void   reserve(size_t);
+//   size_t capacity() const;
+//   void   clear();
+//   size_t size() const;
+//   bool   empty() const;
+//
+// Iterator functions:
+//   iterator       begin();
+//   const_iterator begin() const;
+//   iterator       end();
+//   const_iterator end() const;
+//
+// Insert and accessor functions:
+//   mapped_type&                    operator[](const key_type&);
+//   mapped_type&                    operator[](key_type&&);
+//   template <typename K> mapped_type&       at(const K&);
+//   template <typename K> const mapped_type& at(const K&) const;
+//   pair<iterator, bool> insert(const value_type&);
+//   pair<iterator, bool> insert(value_type&&);
+//   void                 insert(InputIterator first, InputIterator last);
+//   pair<iterator, bool> insert_or_assign(K&&, M&&);
+//   pair<iterator, bool> emplace(Args&&...);
+//   pair<iterator, bool> try_emplace(K&&, Args&&...);
+//
+// Erase functions:
+//   iterator erase(iterator);
+//   iterator erase(const_iterator);
+//   template <class K> size_t erase(const K& key);
+//
+// Search functions:
+//   template <typename K> size_t         count(const K&) const;
+//   template <typename K> bool           contains(const K&) const;
+//   template <typename K> iterator       find(const K&);
+//   template <typename K> const_iterator find(const K&) const;
+//
+// General functions:
+//   void swap(flat_hash_map&);
+//
+// Non-member operators:
+//   bool operator==(const flat_hash_map&, const flat_hash_map&);
+//   bool operator!=(const flat_hash_map&, const flat_hash_map&);
+template <class Key,
+          class Mapped,
+          class Hash = FlatHash<Key>,
+          class KeyEqual = std::equal_to<>>
+class flat_hash_map
+    : public ::winbase::internal::flat_hash_table<
+          Key,
+          std::pair<Key, Mapped>,
+          ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+          Hash,
+          KeyEqual> {
+ private:
+  using table = typename ::winbase::internal::flat_hash_table<
+      Key,
+      std::pair<Key, Mapped>,
+      ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+      Hash,
+      KeyEqual>;
+
+ public:
+  using key_type = typename table::key_type;
+  using mapped_type = Mapped;
+  using value_type = typename table::value_type;
+  using iterator = typename table::iterator;
+  using const_iterator = typename table::const_iterator;
+
+  // --------------------------------------------------------------------------
+  // Lifetime and assignments.
+
+  flat_hash_map() = default;
+
+  template <class InputIterator>
+  flat_hash_map(InputIterator first,
+                InputIterator last,
+                const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : table(first, last, hash, equal) {}
+
+  flat_hash_map(std::initializer_list<value_type> ilist,
+                const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : table(ilist, hash, equal) {}
+
+  flat_hash_map(const flat_hash_map&) = default;
+  flat_hash_map(flat_hash_map&&) noexcept = default;
+  ~flat_hash_map() = default;
+
+  flat_hash_map& operator=(const flat_hash_map&) = default;
+  flat_hash_map& operator=(flat_hash_map&&) = default;
+  flat_hash_map& operator=(std::initializer_list<value_type> ilist) {
+    table::operator=(ilist);
+    return *this;
+  }
+
+  // --------------------------------------------------------------------------
+  // Map-specific insert and accessor operations.
+  //
+  // Normal insert() functions are inherited from flat_hash_table.
+
+  mapped_type& operator[](const key_type& key) {
+    return try_emplace(key).first->second;
+  }
+
+  mapped_type& operator[](key_type&& key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  // Returns the value mapped to |key|, which must be present.
+  template <typename K>
+  mapped_type& at(const K& key) {
+    iterator found = table::find(key);
+    WINBASE_CHECK(found != table::end());
+    return found->second;
+  }
+
+  template <typename K>
+  const mapped_type& at(const K& key) const {
+    const_iterator found = table::find(key);
+    WINBASE_CHECK(found != table::end());
+    return found->second;
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign(K&& key, M&& obj) {
+    auto result = table::emplace_key_args(key, std::forward<K>(key),
+                                          std::forward<M>(obj));
+    if (!result.second)
+      result.first->second = std::forward<M>(obj);
+    return result;
+  }
+
+  template <class K, class... Args>
+  std::enable_if_t<std::is_constructible<key_type, K&&>::value,
+                   std::pair<iterator, bool>>
+  try_emplace(K&& key, Args&&... args) {
+    return table::emplace_key_args(
+        key, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<K>(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  // --------------------------------------------------------------------------
+  // General operations.
+  //
+  // Assume that swap invalidates iterators and references.
+
+  void swap(flat_hash_map& other) noexcept { table::swap(other); }
+
+  friend void swap(flat_hash_map& lhs, flat_hash_map& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FLAT_HASH_MAP_H_
\ No newline at end of file
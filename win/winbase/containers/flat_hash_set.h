@@ -0,0 +1,91 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FLAT_HASH_SET_H_
+#define WINLIB_WINBASE_CONTAINERS_FLAT_HASH_SET_H_
+
+#include <functional>
+#include <initializer_list>
+
+#include "winbase\containers\flat_hash_table.h"
+#include "winbase\containers\flat_tree.h"
+#include "winbase\hash.h"
+
+namespace winbase {
+
+// flat_hash_set is a hash set with a std::unordered_set-like interface that
+// stores its keys in one open addressed array. See flat_hash_map.h for when
+// to use it and what its operations invalidate.
+//
+// Example:
+//   winbase::flat_hash_set<std::string> names = {"alpha", "beta"};
+//   if (names.contains(winbase::StringPiece(buffer, length)))
+//     ...
+//
+// QUICK REFERENCE
+//
+// Constructors (inputs may have equal keys; the first is kept):
+//   flat_hash_set(InputIterator first, InputIterator last,
+//                 const Hash& = Hash(), const KeyEqual& = KeyEqual());
+//   flat_hash_set(std::initializer_list<value_type>,
+//                 const Hash& = Hash(), const KeyEqual& = KeyEqual());
+//   flat_hash_set(const flat_hash_set&);
+//   flat_hash_set(flat_hash_set&&);
+//
+// The other functions are those of flat_hash_map, without the accessors.
+template <class Key,
+          class Hash = FlatHash<Key>,
+          class KeyEqual = std::equal_to<>>
+class flat_hash_set : public ::winbase::internal::flat_hash_table<
+                          Key,
+                          Key,
+                          ::winbase::internal::GetKeyFromValueIdentity<Key>,
+                          Hash,
+                          KeyEqual> {
+ private:
+  using table = typename ::winbase::internal::flat_hash_table<
+      Key,
+      Key,
+      ::winbase::internal::GetKeyFromValueIdentity<Key>,
+      Hash,
+      KeyEqual>;
+
+ public:
+  using value_type = typename table::value_type;
+
+  flat_hash_set() = default;
+
+  template <class InputIterator>
+  flat_hash_set(InputIterator first,
+                InputIterator last,
+                const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : table(first, last, hash, equal) {}
+
+  flat_hash_set(std::initializer_list<value_type> ilist,
+                const Hash& hash = Hash(),
+                const KeyEqual& equal = KeyEqual())
+      : table(ilist, hash, equal) {}
+
+  flat_hash_set(const flat_hash_set&) = default;
+  flat_hash_set(flat_hash_set&&) noexcept = default;
+  ~flat_hash_set() = default;
+
+  flat_hash_set& operator=(const flat_hash_set&) = default;
+  flat_hash_set& operator=(flat_hash_set&&) = default;
+  flat_hash_set& operator=(std::initializer_list<value_type> ilist) {
+    table::operator=(ilist);
+    return *this;
+  }
+
+  void swap(flat_hash_set& other) noexcept { table::swap(other); }
+
+  friend void swap(flat_hash_set& lhs, flat_hash_set& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FLAT_HASH_SET_H_
\ No newline at end of file
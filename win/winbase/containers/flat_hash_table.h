@@ -0,0 +1,973 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FLAT_HASH_TABLE_H_
+#define WINLIB_WINBASE_CONTAINERS_FLAT_HASH_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "winbase\bits.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+#include "winbase\template_util.h"
+#include "winlib\build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
+
+namespace winbase {
+
+namespace internal {
+
+// The control byte of a slot of a flat_hash_table. A full slot has the low 7
+// bits of the hash of its key, so its control byte is non-negative.
+using HashCtrl = int8_t;
+constexpr HashCtrl kHashEmpty = -128;
+constexpr HashCtrl kHashDeleted = -2;
+// Marks the end of the control bytes, for iterators.
+constexpr HashCtrl kHashSentinel = -1;
+
+// A group of consecutive control bytes, matched at once. With SSE2 a match
+// is one compare and one movemask.
+class HashGroup {
+ public:
+  static constexpr size_t kWidth = 16;
+
+  // Bit i of a mask is set if byte i of the group matches.
+  using Mask = uint32_t;
+
+  explicit HashGroup(const HashCtrl* ctrl) {
+#if defined(ARCH_CPU_X86_FAMILY)
+    ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+    memcpy(ctrl_, ctrl, kWidth);
+#endif
+  }
+
+#if defined(ARCH_CPU_X86_FAMILY)
+  Mask Match(HashCtrl h2) const { return MatchEqual(h2); }
+  Mask MatchEmpty() const { return MatchEqual(kHashEmpty); }
+  Mask MatchEmptyOrDeleted() const {
+    return static_cast<Mask>(_mm_movemask_epi8(
+        _mm_cmpgt_epi8(_mm_set1_epi8(kHashSentinel), ctrl_)));
+  }
+#else
+  Mask Match(HashCtrl h2) const {
+    Mask mask = 0;
+    for (size_t i = 0; i < kWidth; ++i)
+      mask |= static_cast<Mask>(ctrl_[i] == h2) << i;
+    return mask;
+  }
+  Mask MatchEmpty() const { return Match(kHashEmpty); }
+  Mask MatchEmptyOrDeleted() const {
+    Mask mask = 0;
+    for (size_t i = 0; i < kWidth; ++i)
+      mask |= static_cast<Mask>(ctrl_[i] < kHashSentinel) << i;
+    return mask;
+  }
+#endif
+
+  // Returns the number of empty or deleted bytes at the start of the group.
+  size_t CountLeadingEmptyOrDeleted() const {
+    return bits::CountTrailingZeroBits(MatchEmptyOrDeleted() + 1);
+  }
+
+ private:
+#if defined(ARCH_CPU_X86_FAMILY)
+  Mask MatchEqual(HashCtrl value) const {
+    return static_cast<Mask>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_set1_epi8(value), ctrl_)));
+  }
+
+  __m128i ctrl_;
+#else
+  HashCtrl ctrl_[kWidth];
+#endif
+};
+
+// The control bytes of a table without slots: a sentinel, so that it has no
+// elements, followed by empty bytes, so that lookups stop at once.
+inline HashCtrl* EmptyHashGroup() {
+  static constexpr HashCtrl kGroup[HashGroup::kWidth] = {
+      kHashSentinel, kHashEmpty, kHashEmpty, kHashEmpty,
+      kHashEmpty,    kHashEmpty, kHashEmpty, kHashEmpty,
+      kHashEmpty,    kHashEmpty, kHashEmpty, kHashEmpty,
+      kHashEmpty,    kHashEmpty, kHashEmpty, kHashEmpty};
+  return const_cast<HashCtrl*>(kGroup);
+}
+
+// Uses SFINAE to detect whether type has is_transparent member.
+template <typename T, typename = void>
+struct IsTransparentHash : std::false_type {};
+template <typename T>
+struct IsTransparentHash<T, void_t<typename T::is_transparent>>
+    : std::true_type {};
+
+// Implementation -------------------------------------------------------------
+
+// Implementation of an open addressing hash table backing flat_hash_map and
+// flat_hash_set. Do not use directly.
+//
+// The values live in one array of slots, next to an array with one control
+// byte per slot telling whether the slot is empty, deleted, or full; a full
+// slot's control byte holds 7 bits of the hash of its key (H2), and the rest
+// of the hash (H1) picks where the search for the key starts. A lookup
+// matches the H2 of the key against a group of 16 control bytes at a time
+// and compares keys only for the slots that match, so it rarely compares
+// more than one key, and stops at the first group with an empty byte. The
+// table grows before it is 7/8 full.
+//
+// The capacity is a power of two minus one, so that it is also the mask of
+// slot indices, and the first HashGroup::kWidth - 1 control bytes are cloned
+// after the sentinel that ends them, so that a group can be read at any
+// index without wrapping around.
+//
+// As in flat_tree, "value" is what the table contains and GetKeyFromValue
+// extracts the key from it:
+//   const Key& operator()(const Value&).
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+class flat_hash_table {
+ private:
+  template <bool is_const>
+  class Iterator;
+
+ public:
+  // --------------------------------------------------------------------------
+  // Types.
+  //
+  using key_type = Key;
+  using value_type = Value;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  // --------------------------------------------------------------------------
+  // Lifetime.
+  //
+  // Constructors that take ranges keep the first of equal keys.
+
+  flat_hash_table();
+  explicit flat_hash_table(const hasher& hash,
+                           const key_equal& equal = key_equal());
+
+  template <class InputIterator>
+  flat_hash_table(InputIterator first,
+                  InputIterator last,
+                  const hasher& hash = hasher(),
+                  const key_equal& equal = key_equal());
+
+  flat_hash_table(std::initializer_list<value_type> ilist,
+                  const hasher& hash = hasher(),
+                  const key_equal& equal = key_equal());
+
+  flat_hash_table(const flat_hash_table& other);
+  flat_hash_table(flat_hash_table&& other) noexcept;
+  ~flat_hash_table();
+
+  // --------------------------------------------------------------------------
+  // Assignments.
+
+  flat_hash_table& operator=(const flat_hash_table& other);
+  flat_hash_table& operator=(flat_hash_table&& other) noexcept;
+  flat_hash_table& operator=(std::initializer_list<value_type> ilist);
+
+  // --------------------------------------------------------------------------
+  // Memory management.
+  //
+  // reserve(n) makes room for n values in all, so that inserting up to n
+  // values does not rehash.
+
+  void reserve(size_type size);
+  size_type capacity() const { return capacity_; }
+
+  // --------------------------------------------------------------------------
+  // Size management.
+  //
+  // clear() keeps the memory of the table.
+
+  void clear();
+
+  size_type size() const { return size_; }
+  bool empty() const { return !size_; }
+
+  // --------------------------------------------------------------------------
+  // Iterators.
+  //
+  // Iteration is in no particular order. Inserting may invalidate every
+  // iterator; erasing only invalidates the iterators to the erased value.
+
+  iterator begin();
+  const_iterator begin() const;
+  const_iterator cbegin() const { return begin(); }
+
+  iterator end() { return iterator_at(capacity_); }
+  const_iterator end() const { return iterator_at(capacity_); }
+  const_iterator cend() const { return end(); }
+
+  // --------------------------------------------------------------------------
+  // Insert operations.
+  //
+  // Inserting a value whose key is present does nothing.
+
+  std::pair<iterator, bool> insert(const value_type& val);
+  std::pair<iterator, bool> insert(value_type&& val);
+
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last);
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args);
+
+  // --------------------------------------------------------------------------
+  // Erase operations.
+
+  iterator erase(iterator position);
+  iterator erase(const_iterator position);
+  template <typename K>
+  size_type erase(const K& key);
+
+  // --------------------------------------------------------------------------
+  // Observers.
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return equal_; }
+
+  // --------------------------------------------------------------------------
+  // Search operations.
+  //
+  // If both the hasher and key_equal are transparent, as the default ones
+  // are for strings, these take any key they accept; a table of std::string
+  // can then be searched for a StringPiece.
+
+  template <typename K>
+  iterator find(const K& key);
+
+  template <typename K>
+  const_iterator find(const K& key) const;
+
+  template <typename K>
+  bool contains(const K& key) const {
+    return find(key) != end();
+  }
+
+  template <typename K>
+  size_type count(const K& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // General operations.
+
+  void swap(flat_hash_table& other) noexcept;
+
+  friend bool operator==(const flat_hash_table& lhs,
+                         const flat_hash_table& rhs) {
+    if (lhs.size() != rhs.size())
+      return false;
+    for (const value_type& val : lhs) {
+      const_iterator found = rhs.find(GetKeyFromValue()(val));
+      if (found == rhs.end() || !(*found == val))
+        return false;
+    }
+    return true;
+  }
+
+  friend bool operator!=(const flat_hash_table& lhs,
+                         const flat_hash_table& rhs) {
+    return !(lhs == rhs);
+  }
+
+  friend void swap(flat_hash_table& lhs, flat_hash_table& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ protected:
+  // If the hasher or key_equal is not transparent we want to construct
+  // key_type once.
+  template <typename K>
+  using KeyTypeOrK = typename std::conditional<
+      IsTransparentHash<hasher>::value && IsTransparentHash<key_equal>::value,
+      K,
+      key_type>::type;
+
+  // Attempts to emplace a new element with key |key|. Only if |key| is not yet
+  // present, construct value_type from |args| and insert it. Returns an
+  // iterator to the element with key |key| and a bool indicating whether an
+  // insertion happened.
+  template <class K, class... Args>
+  std::pair<iterator, bool> emplace_key_args(const K& key, Args&&... args);
+
+ private:
+  template <bool is_const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename flat_hash_table::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer =
+        std::conditional_t<is_const, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<is_const, const value_type&, value_type&>;
+
+    Iterator() = default;
+
+    // An iterator converts to a const_iterator.
+    template <bool other_is_const,
+              typename = std::enable_if_t<is_const && !other_is_const>>
+    Iterator(const Iterator<other_is_const>& other)
+        : ctrl_(other.ctrl_), slot_(other.slot_) {}
+
+    reference operator*() const { return *slot_; }
+    pointer operator->() const { return slot_; }
+
+    Iterator& operator++() {
+      ++ctrl_;
+      ++slot_;
+      SkipEmptyOrDeleted();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.ctrl_ == rhs.ctrl_;
+    }
+
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    friend class flat_hash_table;
+    friend class Iterator<!is_const>;
+
+    Iterator(const HashCtrl* ctrl, pointer slot) : ctrl_(ctrl), slot_(slot) {}
+
+    void SkipEmptyOrDeleted() {
+      while (*ctrl_ < kHashSentinel) {
+        size_t shift = HashGroup(ctrl_).CountLeadingEmptyOrDeleted();
+        ctrl_ += shift;
+        slot_ += shift;
+      }
+    }
+
+    const HashCtrl* ctrl_ = nullptr;
+    pointer slot_ = nullptr;
+  };
+
+  static constexpr size_t kClonedBytes = HashGroup::kWidth - 1;
+
+  static size_t H1(size_t hash) { return hash >> 7; }
+  static HashCtrl H2(size_t hash) {
+    return static_cast<HashCtrl>(hash & 0x7f);
+  }
+
+  // Returns the number of values a table of |capacity| slots holds before it
+  // grows: 7/8 of it.
+  static size_t CapacityToGrowth(size_t capacity) {
+    return capacity - capacity / 8;
+  }
+
+  // Returns the smallest valid capacity that holds |size| values.
+  static size_t SizeToCapacity(size_t size) {
+    size_t capacity = size + (size ? (size - 1) / 7 : 0);
+    return capacity ? ~size_t() >> bits::CountLeadingZeroBits(capacity) : 1;
+  }
+
+  // The slots follow the control bytes in the same allocation.
+  static size_t SlotOffset(size_t capacity) {
+    return bits::Align(capacity + 1 + kClonedBytes, alignof(value_type));
+  }
+
+  iterator iterator_at(size_t index) {
+    return iterator(ctrl_ + index, slots_ + index);
+  }
+  const_iterator iterator_at(size_t index) const {
+    return const_iterator(ctrl_ + index, slots_ + index);
+  }
+
+  // Returns the index of the value with key |key| and hash |hash|, or
+  // |capacity_| if there is none.
+  template <typename K>
+  size_t FindIndex(const K& key, size_t hash) const;
+
+  // Returns the index of the first empty or deleted slot on the probe
+  // sequence of |hash|.
+  size_t FindFirstNonFull(size_t hash) const;
+
+  // Claims a slot for a new value with hash |hash|, growing the table if
+  // needed, and returns its index. The caller constructs the value.
+  size_t PrepareInsert(size_t hash);
+
+  void SetCtrl(size_t index, HashCtrl h);
+
+  // Destroys the value at |index| and frees its slot.
+  void EraseAt(size_t index);
+
+  // Moves the values into a new allocation of |capacity| slots.
+  void Resize(size_t capacity);
+
+  void DestroySlots();
+
+  HashCtrl* ctrl_ = EmptyHashGroup();
+  value_type* slots_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  // How many values may be inserted in empty slots before the table grows.
+  size_t growth_left_ = 0;
+
+  hasher hash_;
+  key_equal equal_;
+};
+
+// ----------------------------------------------------------------------------
+// Lifetime.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    flat_hash_table() = default;
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::flat_hash_table(
+    const hasher& hash,
+    const key_equal& equal)
+    : hash_(hash), equal_(equal) {}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <class InputIterator>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::flat_hash_table(
+    InputIterator first,
+    InputIterator last,
+    const hasher& hash,
+    const key_equal& equal)
+    : hash_(hash), equal_(equal) {
+  insert(first, last);
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::flat_hash_table(
+    std::initializer_list<value_type> ilist,
+    const hasher& hash,
+    const key_equal& equal)
+    : flat_hash_table(ilist.begin(), ilist.end(), hash, equal) {}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::flat_hash_table(
+    const flat_hash_table& other)
+    : hash_(other.hash_), equal_(other.equal_) {
+  reserve(other.size());
+  // The keys are known to be distinct, so each value goes straight to the
+  // first free slot of its probe sequence.
+  for (const value_type& val : other) {
+    size_t hash = hash_(GetKeyFromValue()(val));
+    size_t index = FindFirstNonFull(hash);
+    SetCtrl(index, H2(hash));
+    new (slots_ + index) value_type(val);
+  }
+  size_ = other.size_;
+  growth_left_ -= size_;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::flat_hash_table(
+    flat_hash_table&& other) noexcept
+    : ctrl_(std::exchange(other.ctrl_, EmptyHashGroup())),
+      slots_(std::exchange(other.slots_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)),
+      growth_left_(std::exchange(other.growth_left_, 0)),
+      hash_(other.hash_),
+      equal_(other.equal_) {}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    ~flat_hash_table() {
+  DestroySlots();
+}
+
+// ----------------------------------------------------------------------------
+// Assignments.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::operator=(
+    const flat_hash_table& other) -> flat_hash_table& {
+  if (this != &other) {
+    flat_hash_table copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::operator=(
+    flat_hash_table&& other) noexcept -> flat_hash_table& {
+  flat_hash_table moved(std::move(other));
+  swap(moved);
+  return *this;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::operator=(
+    std::initializer_list<value_type> ilist) -> flat_hash_table& {
+  clear();
+  insert(ilist);
+  return *this;
+}
+
+// ----------------------------------------------------------------------------
+// Memory management.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::reserve(
+    size_type size) {
+  if (size > size_ + growth_left_)
+    Resize(SizeToCapacity(size));
+}
+
+// ----------------------------------------------------------------------------
+// Size management.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::clear() {
+  if (!capacity_)
+    return;
+  for (size_t i = 0; i < capacity_; ++i) {
+    if (ctrl_[i] >= 0)
+      slots_[i].~value_type();
+  }
+  memset(ctrl_, kHashEmpty, capacity_ + 1 + kClonedBytes);
+  ctrl_[capacity_] = kHashSentinel;
+  size_ = 0;
+  growth_left_ = CapacityToGrowth(capacity_);
+}
+
+// ----------------------------------------------------------------------------
+// Iterators.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::begin()
+    -> iterator {
+  iterator it = iterator_at(0);
+  it.SkipEmptyOrDeleted();
+  return it;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::begin()
+    const -> const_iterator {
+  const_iterator it = iterator_at(0);
+  it.SkipEmptyOrDeleted();
+  return it;
+}
+
+// ----------------------------------------------------------------------------
+// Insert operations.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::insert(
+    const value_type& val) -> std::pair<iterator, bool> {
+  return emplace_key_args(GetKeyFromValue()(val), val);
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::insert(
+    value_type&& val) -> std::pair<iterator, bool> {
+  return emplace_key_args(GetKeyFromValue()(val), std::move(val));
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <class InputIterator>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::insert(
+    InputIterator first,
+    InputIterator last) {
+  if (std::is_base_of<std::forward_iterator_tag,
+                      typename std::iterator_traits<
+                          InputIterator>::iterator_category>::value)
+    reserve(size_ + std::distance(first, last));
+  for (; first != last; ++first)
+    insert(*first);
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <class... Args>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::emplace(
+    Args&&... args) -> std::pair<iterator, bool> {
+  value_type new_value(std::forward<Args>(args)...);
+  return insert(std::move(new_value));
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <class K, class... Args>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    emplace_key_args(const K& key, Args&&... args)
+        -> std::pair<iterator, bool> {
+  const KeyTypeOrK<K>& key_ref = key;
+  size_t hash = hash_(key_ref);
+  size_t index = FindIndex(key_ref, hash);
+  if (index != capacity_)
+    return {iterator_at(index), false};
+
+  index = PrepareInsert(hash);
+  new (slots_ + index) value_type(std::forward<Args>(args)...);
+  return {iterator_at(index), true};
+}
+
+// ----------------------------------------------------------------------------
+// Erase operations.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::erase(
+    iterator position) -> iterator {
+  WINBASE_DCHECK(position != end());
+  EraseAt(position.slot_ - slots_);
+  ++position;
+  return position;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::erase(
+    const_iterator position) -> iterator {
+  return erase(iterator_at(position.slot_ - slots_));
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <typename K>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::erase(
+    const K& key) -> size_type {
+  const KeyTypeOrK<K>& key_ref = key;
+  size_t index = FindIndex(key_ref, hash_(key_ref));
+  if (index == capacity_)
+    return 0;
+  EraseAt(index);
+  return 1;
+}
+
+// ----------------------------------------------------------------------------
+// Search operations.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <typename K>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::find(
+    const K& key) -> iterator {
+  const KeyTypeOrK<K>& key_ref = key;
+  return iterator_at(FindIndex(key_ref, hash_(key_ref)));
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <typename K>
+auto flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::find(
+    const K& key) const -> const_iterator {
+  const KeyTypeOrK<K>& key_ref = key;
+  return iterator_at(FindIndex(key_ref, hash_(key_ref)));
+}
+
+// ----------------------------------------------------------------------------
+// General operations.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::swap(
+    flat_hash_table& other) noexcept {
+  std::swap(ctrl_, other.ctrl_);
+  std::swap(slots_, other.slots_);
+  std::swap(size_, other.size_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(growth_left_, other.growth_left_);
+  std::swap(hash_, other.hash_);
+  std::swap(equal_, other.equal_);
+}
+
+// ----------------------------------------------------------------------------
+// Slots.
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+template <typename K>
+size_t flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::FindIndex(
+    const K& key,
+    size_t hash) const {
+  // Probes groups at triangular offsets, which visits every group once the
+  // capacity is a power of two minus one.
+  size_t offset = H1(hash) & capacity_;
+  for (size_t step = HashGroup::kWidth;; step += HashGroup::kWidth) {
+    HashGroup group(ctrl_ + offset);
+    for (HashGroup::Mask mask = group.Match(H2(hash)); mask;
+         mask &= mask - 1) {
+      size_t index = (offset + bits::CountTrailingZeroBits(mask)) & capacity_;
+      if (LIKELY(equal_(GetKeyFromValue()(slots_[index]), key)))
+        return index;
+    }
+    if (LIKELY(group.MatchEmpty()))
+      return capacity_;
+    offset = (offset + step) & capacity_;
+  }
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+size_t flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    FindFirstNonFull(size_t hash) const {
+  size_t offset = H1(hash) & capacity_;
+  for (size_t step = HashGroup::kWidth;; step += HashGroup::kWidth) {
+    HashGroup::Mask mask = HashGroup(ctrl_ + offset).MatchEmptyOrDeleted();
+    if (LIKELY(mask))
+      return (offset + bits::CountTrailingZeroBits(mask)) & capacity_;
+    offset = (offset + step) & capacity_;
+  }
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+size_t flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    PrepareInsert(size_t hash) {
+  size_t index = FindFirstNonFull(hash);
+  if (UNLIKELY(!growth_left_ && ctrl_[index] != kHashDeleted)) {
+    // Rehash at the same capacity if deleted slots take the room, grow
+    // otherwise.
+    if (capacity_ > HashGroup::kWidth && size_ * 32 <= capacity_ * 25)
+      Resize(capacity_);
+    else
+      Resize(capacity_ * 2 + 1);
+    index = FindFirstNonFull(hash);
+  }
+  ++size_;
+  growth_left_ -= ctrl_[index] == kHashEmpty ? 1 : 0;
+  SetCtrl(index, H2(hash));
+  return index;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::SetCtrl(
+    size_t index,
+    HashCtrl h) {
+  ctrl_[index] = h;
+  // Also sets the clone of the byte, or the byte itself again if it has no
+  // clone.
+  ctrl_[((index - kClonedBytes) & capacity_) + (kClonedBytes & capacity_)] = h;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::EraseAt(
+    size_t index) {
+  slots_[index].~value_type();
+  --size_;
+
+  // A lookup stops at a group with an empty byte, so the slot can only be
+  // marked empty if no group covering it was ever full: otherwise a lookup
+  // that went past it would now stop early.
+  size_t index_before = (index - HashGroup::kWidth) & capacity_;
+  HashGroup::Mask empty_after = HashGroup(ctrl_ + index).MatchEmpty();
+  HashGroup::Mask empty_before = HashGroup(ctrl_ + index_before).MatchEmpty();
+  bool was_never_full =
+      empty_before && empty_after &&
+      bits::CountTrailingZeroBits(empty_after) +
+              bits::CountLeadingZeroBits(static_cast<uint16_t>(empty_before)) <
+          HashGroup::kWidth;
+  SetCtrl(index, was_never_full ? kHashEmpty : kHashDeleted);
+  growth_left_ += was_never_full ? 1 : 0;
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::Resize(
+    size_t capacity) {
+  static_assert(alignof(value_type) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                "over-aligned values are not supported");
+  WINBASE_DCHECK(bits::IsPowerOfTwo(capacity + 1));
+
+  HashCtrl* old_ctrl = ctrl_;
+  value_type* old_slots = slots_;
+  size_t old_capacity = capacity_;
+
+  size_t slot_offset = SlotOffset(capacity);
+  char* memory = static_cast<char*>(
+      ::operator new(slot_offset + capacity * sizeof(value_type)));
+  ctrl_ = reinterpret_cast<HashCtrl*>(memory);
+  slots_ = reinterpret_cast<value_type*>(memory + slot_offset);
+  capacity_ = capacity;
+  memset(ctrl_, kHashEmpty, capacity + 1 + kClonedBytes);
+  ctrl_[capacity] = kHashSentinel;
+  growth_left_ = CapacityToGrowth(capacity) - size_;
+
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (old_ctrl[i] < 0)
+      continue;
+    size_t hash = hash_(GetKeyFromValue()(old_slots[i]));
+    size_t index = FindFirstNonFull(hash);
+    SetCtrl(index, H2(hash));
+    new (slots_ + index) value_type(std::move(old_slots[i]));
+    old_slots[i].~value_type();
+  }
+  if (old_capacity)
+    ::operator delete(old_ctrl);
+}
+
+template <class Key,
+          class Value,
+          class GetKeyFromValue,
+          class Hash,
+          class KeyEqual>
+void flat_hash_table<Key, Value, GetKeyFromValue, Hash, KeyEqual>::
+    DestroySlots() {
+  if (!capacity_)
+    return;
+  for (size_t i = 0; i < capacity_; ++i) {
+    if (ctrl_[i] >= 0)
+      slots_[i].~value_type();
+  }
+  ::operator delete(ctrl_);
+}
+
+}  // namespace internal
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FLAT_HASH_TABLE_H_
\ No newline at end of file
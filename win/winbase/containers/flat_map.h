@@ -51,6 +51,9 @@ struct GetKeyFromValuePairFirst {
 //  - Iterators are invalidated across mutations.
 //  - If possible, construct a flat_map in one operation by inserting into
 //    a std::vector and moving that vector into the flat_map constructor.
+//  - The elements live in a Container, std::vector<std::pair<Key, Mapped>> by
+//    default. Any vector-like sequence works, e.g. a std::vector with an
+//    ArenaAllocator (see memory/arena.h).
 //
 // QUICK REFERENCE
 //
@@ -64,7 +67,7 @@ struct GetKeyFromValuePairFirst {
 //            const Compare& compare = Compare());
 //   flat_map(const flat_map&);
 //   flat_map(flat_map&&);
-//   flat_map(std::vector<value_type>,
+//   flat_map(container_type,
 //            FlatContainerDupes = KEEP_FIRST_OF_DUPES,
 //            const Compare& compare = Compare()); // Re-use storage.
 //   flat_map(std::initializer_list<value_type> ilist,
@@ -116,12 +119,15 @@ struct GetKeyFromValuePairFirst {
 //   iterator             emplace_hint(const_iterator, Args&&...);
 //   pair<iterator, bool> try_emplace(K&&, Args&&...);
 //   iterator             try_emplace(const_iterator hint, K&&, Args&&...);
+//   void                 merge(flat_map&);
+//   void                 merge(flat_map&&);
 //
 // Erase functions:
 //   iterator erase(iterator);
 //   iterator erase(const_iterator);
 //   iterator erase(const_iterator first, const_iterator& last);
 //   template <class K> size_t erase(const K& key);
+//   template <class P> size_t erase_if(P pred);
 //
 // Comparators (see std::map documentation).
 //   key_compare   key_comp() const;
@@ -148,23 +154,27 @@ struct GetKeyFromValuePairFirst {
 //   bool operator>=(const flat_map&, const flat_map);
 //   bool operator<=(const flat_map&, const flat_map);
 //
-template <class Key, class Mapped, class Compare = std::less<>>
-class flat_map : public ::base::internal::flat_tree<
+template <class Key,
+          class Mapped,
+          class Compare = std::less<>,
+          class Container = std::vector<std::pair<Key, Mapped>>>
+class flat_map : public ::winbase::internal::flat_tree<
                      Key,
-                     std::pair<Key, Mapped>,
-                     ::base::internal::GetKeyFromValuePairFirst<Key, Mapped>,
-                     Compare> {
+                     ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+                     Compare,
+                     Container> {
  private:
-  using tree = typename ::base::internal::flat_tree<
+  using tree = typename ::winbase::internal::flat_tree<
       Key,
-      std::pair<Key, Mapped>,
-      ::base::internal::GetKeyFromValuePairFirst<Key, Mapped>,
-      Compare>;
+      ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+      Compare,
+      Container>;
 
  public:
   using key_type = typename tree::key_type;
   using mapped_type = Mapped;
   using value_type = typename tree::value_type;
+  using container_type = typename tree::container_type;
   using iterator = typename tree::iterator;
   using const_iterator = typename tree::const_iterator;
 
@@ -188,7 +198,7 @@ class flat_map : public ::base::internal::flat_tree<
   flat_map(const flat_map&) = default;
   flat_map(flat_map&&) noexcept = default;
 
-  flat_map(std::vector<value_type> items,
+  flat_map(container_type items,
            FlatContainerDupes dupe_handling = KEEP_FIRST_OF_DUPES,
            const Compare& comp = Compare());
 
@@ -241,25 +251,28 @@ class flat_map : public ::base::internal::flat_tree<
 // ----------------------------------------------------------------------------
 // Lifetime.
 
-template <class Key, class Mapped, class Compare>
-flat_map<Key, Mapped, Compare>::flat_map(const Compare& comp) : tree(comp) {}
+template <class Key, class Mapped, class Compare, class Container>
+flat_map<Key, Mapped, Compare, Container>::flat_map(const Compare& comp)
+    : tree(comp) {}
 
-template <class Key, class Mapped, class Compare>
+template <class Key, class Mapped, class Compare, class Container>
 template <class InputIterator>
-flat_map<Key, Mapped, Compare>::flat_map(InputIterator first,
-                                         InputIterator last,
-                                         FlatContainerDupes dupe_handling,
-                                         const Compare& comp)
+flat_map<Key, Mapped, Compare, Container>::flat_map(
+    InputIterator first,
+    InputIterator last,
+    FlatContainerDupes dupe_handling,
+    const Compare& comp)
     : tree(first, last, dupe_handling, comp) {}
 
-template <class Key, class Mapped, class Compare>
-flat_map<Key, Mapped, Compare>::flat_map(std::vector<value_type> items,
-                                         FlatContainerDupes dupe_handling,
-                                         const Compare& comp)
+template <class Key, class Mapped, class Compare, class Container>
+flat_map<Key, Mapped, Compare, Container>::flat_map(
+    container_type items,
+    FlatContainerDupes dupe_handling,
+    const Compare& comp)
     : tree(std::move(items), dupe_handling, comp) {}
 
-template <class Key, class Mapped, class Compare>
-flat_map<Key, Mapped, Compare>::flat_map(
+template <class Key, class Mapped, class Compare, class Container>
+flat_map<Key, Mapped, Compare, Container>::flat_map(
     std::initializer_list<value_type> ilist,
     FlatContainerDupes dupe_handling,
     const Compare& comp)
@@ -268,8 +281,8 @@ flat_map<Key, Mapped, Compare>::flat_map(
 // ----------------------------------------------------------------------------
 // Assignments.
 
-template <class Key, class Mapped, class Compare>
-auto flat_map<Key, Mapped, Compare>::operator=(
+template <class Key, class Mapped, class Compare, class Container>
+auto flat_map<Key, Mapped, Compare, Container>::operator=(
     std::initializer_list<value_type> ilist) -> flat_map& {
   // When https://gcc.gnu.org/bugzilla/show_bug.cgi?id=84782 gets fixed, we
   // need to remember to inherit tree::operator= to prevent
@@ -284,8 +297,8 @@ auto flat_map<Key, Mapped, Compare>::operator=(
 // ----------------------------------------------------------------------------
 // Insert operations.
 
-template <class Key, class Mapped, class Compare>
-auto flat_map<Key, Mapped, Compare>::operator[](const key_type& key)
+template <class Key, class Mapped, class Compare, class Container>
+auto flat_map<Key, Mapped, Compare, Container>::operator[](const key_type& key)
     -> mapped_type& {
   iterator found = tree::lower_bound(key);
   if (found == tree::end() || tree::key_comp()(key, found->first))
@@ -293,8 +306,8 @@ auto flat_map<Key, Mapped, Compare>::operator[](const key_type& key)
   return found->second;
 }
 
-template <class Key, class Mapped, class Compare>
-auto flat_map<Key, Mapped, Compare>::operator[](key_type&& key)
+template <class Key, class Mapped, class Compare, class Container>
+auto flat_map<Key, Mapped, Compare, Container>::operator[](key_type&& key)
     -> mapped_type& {
   iterator found = tree::lower_bound(key);
   if (found == tree::end() || tree::key_comp()(key, found->first))
@@ -302,9 +315,10 @@ auto flat_map<Key, Mapped, Compare>::operator[](key_type&& key)
   return found->second;
 }
 
-template <class Key, class Mapped, class Compare>
+template <class Key, class Mapped, class Compare, class Container>
 template <class K, class M>
-auto flat_map<Key, Mapped, Compare>::insert_or_assign(K&& key, M&& obj)
+auto flat_map<Key, Mapped, Compare, Container>::insert_or_assign(K&& key,
+                                                                 M&& obj)
     -> std::pair<iterator, bool> {
   auto result =
       tree::emplace_key_args(key, std::forward<K>(key), std::forward<M>(obj));
@@ -313,11 +327,12 @@ auto flat_map<Key, Mapped, Compare>::insert_or_assign(K&& key, M&& obj)
   return result;
 }
 
-template <class Key, class Mapped, class Compare>
+template <class Key, class Mapped, class Compare, class Container>
 template <class K, class M>
-auto flat_map<Key, Mapped, Compare>::insert_or_assign(const_iterator hint,
-                                                      K&& key,
-                                                      M&& obj) -> iterator {
+auto flat_map<Key, Mapped, Compare, Container>::insert_or_assign(
+    const_iterator hint,
+    K&& key,
+    M&& obj) -> iterator {
   auto result = tree::emplace_hint_key_args(hint, key, std::forward<K>(key),
                                             std::forward<M>(obj));
   if (!result.second)
@@ -325,9 +340,10 @@ auto flat_map<Key, Mapped, Compare>::insert_or_assign(const_iterator hint,
   return result.first;
 }
 
-template <class Key, class Mapped, class Compare>
+template <class Key, class Mapped, class Compare, class Container>
 template <class K, class... Args>
-auto flat_map<Key, Mapped, Compare>::try_emplace(K&& key, Args&&... args)
+auto flat_map<Key, Mapped, Compare, Container>::try_emplace(K&& key,
+                                                            Args&&... args)
     -> std::enable_if_t<std::is_constructible<key_type, K&&>::value,
                         std::pair<iterator, bool>> {
   return tree::emplace_key_args(
@@ -336,11 +352,12 @@ auto flat_map<Key, Mapped, Compare>::try_emplace(K&& key, Args&&... args)
       std::forward_as_tuple(std::forward<Args>(args)...));
 }
 
-template <class Key, class Mapped, class Compare>
+template <class Key, class Mapped, class Compare, class Container>
 template <class K, class... Args>
-auto flat_map<Key, Mapped, Compare>::try_emplace(const_iterator hint,
-                                                 K&& key,
-                                                 Args&&... args)
+auto flat_map<Key, Mapped, Compare, Container>::try_emplace(
+    const_iterator hint,
+    K&& key,
+    Args&&... args)
     -> std::enable_if_t<std::is_constructible<key_type, K&&>::value, iterator> {
   return tree::emplace_hint_key_args(
              hint, key, std::piecewise_construct,
@@ -352,8 +369,8 @@ auto flat_map<Key, Mapped, Compare>::try_emplace(const_iterator hint,
 // ----------------------------------------------------------------------------
 // General operations.
 
-template <class Key, class Mapped, class Compare>
-void flat_map<Key, Mapped, Compare>::swap(flat_map& other) noexcept {
+template <class Key, class Mapped, class Compare, class Container>
+void flat_map<Key, Mapped, Compare, Container>::swap(flat_map& other) noexcept {
   tree::swap(other);
 }
 
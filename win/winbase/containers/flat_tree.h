@@ -5,9 +5,12 @@
 #ifndef WINLIB_WINBASE_CONTAINERS_FLAT_TREE_H_
 #define WINLIB_WINBASE_CONTAINERS_FLAT_TREE_H_
 
+#include <stddef.h>
+
 #include <algorithm>
 #include <iterator>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "winbase\template_util.h"
@@ -70,6 +73,11 @@ struct IsTransparentCompare<T, void_t<typename T::is_transparent>>
 // Implementation of a sorted vector for backing flat_set and flat_map. Do not
 // use directly.
 //
+// The values are stored in a Container, which must be a random access
+// sequence with the std::vector interface used below (insert, emplace, erase,
+// reserve, ...); std::vector<Value> with any allocator qualifies. The value
+// type is taken from Container::value_type.
+//
 // The use of "value" in this is like std::map uses, meaning it's the thing
 // contained (in the case of map it's a <Kay, Mapped> pair). The Key is how
 // things are looked up. In the case of a set, Key == Value. In the case of
@@ -78,10 +86,10 @@ struct IsTransparentCompare<T, void_t<typename T::is_transparent>>
 // The helper class GetKeyFromValue provides the means to extract a key from a
 // value for comparison purposes. It should implement:
 //   const Key& operator()(const Value&).
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 class flat_tree {
  private:
-  using underlying_type = std::vector<Value>;
+  using underlying_type = Container;
 
  public:
   // --------------------------------------------------------------------------
@@ -89,7 +97,8 @@ class flat_tree {
   //
   using key_type = Key;
   using key_compare = KeyCompare;
-  using value_type = Value;
+  using value_type = typename Container::value_type;
+  using container_type = Container;
 
   // Wraps the templated key comparison to compare values.
   class value_compare : public key_compare {
@@ -142,7 +151,7 @@ class flat_tree {
   flat_tree(const flat_tree&);
   flat_tree(flat_tree&&) noexcept = default;
 
-  flat_tree(std::vector<value_type> items,
+  flat_tree(container_type items,
             FlatContainerDupes dupe_handling = KEEP_FIRST_OF_DUPES,
             const key_compare& comp = key_compare());
 
@@ -213,7 +222,8 @@ class flat_tree {
   // an implementation-defined manner.
   //
   // NOTE: Prefer to build a new flat_tree from a std::vector (or similar)
-  // instead of calling insert() repeatedly.
+  // instead of calling insert() repeatedly. To add many values to an existing
+  // tree, insert() them as one range.
 
   std::pair<iterator, bool> insert(const value_type& val);
   std::pair<iterator, bool> insert(value_type&& val);
@@ -224,6 +234,11 @@ class flat_tree {
   // This method inserts the values from the range [first, last) into the
   // current tree. In case of KEEP_LAST_OF_DUPES newly added elements can
   // overwrite existing values.
+  //
+  // Only the new values are sorted. They are then merged into the tree in
+  // one pass from the back with at most one reallocation, so inserting k
+  // values into a tree of size n takes O(k * log(k) + k * log(n / k) + n)
+  // rather than O(k * n).
   template <class InputIterator>
   void insert(InputIterator first,
               InputIterator last,
@@ -235,6 +250,13 @@ class flat_tree {
   template <class... Args>
   iterator emplace_hint(const_iterator position_hint, Args&&... args);
 
+  // Moves the elements of |source| whose keys are not in this tree into it,
+  // like std::map::merge(). The others stay in |source|. Both trees must be
+  // ordered the same way. Takes O(m * log(n / m) + n + m) for trees of size
+  // n and m.
+  void merge(flat_tree& source);
+  void merge(flat_tree&& source);
+
   // --------------------------------------------------------------------------
   // Erase operations.
   //
@@ -243,8 +265,7 @@ class flat_tree {
   // erase(position), erase(first, last) can take O(size).
   // erase(key) may take O(size) + O(log(size)).
   //
-  // Prefer base::EraseIf() or some other variation on erase(remove(), end())
-  // idiom when deleting multiple non-consecutive elements.
+  // Prefer erase_if() when deleting multiple non-consecutive elements.
 
   iterator erase(iterator position);
   iterator erase(const_iterator position);
@@ -252,6 +273,11 @@ class flat_tree {
   template <typename K>
   size_type erase(const K& key);
 
+  // Erases the elements for which |pred| returns true, compacting the others
+  // in a single pass. Returns the number of elements erased. O(size).
+  template <class Predicate>
+  size_type erase_if(Predicate pred);
+
   // --------------------------------------------------------------------------
   // Comparators.
 
@@ -303,6 +329,10 @@ class flat_tree {
 
   void swap(flat_tree& other) noexcept;
 
+  // Moves the sorted container out, leaving the tree empty. Lets a frozen
+  // container take over the storage without copying the elements.
+  container_type extract() &&;
+
   friend bool operator==(const flat_tree& lhs, const flat_tree& rhs) {
     return lhs.impl_.body_ == rhs.impl_.body_;
   }
@@ -399,52 +429,16 @@ class flat_tree {
     return {position, false};
   }
 
-  // This method is similar to insert_or_assign, with the following differences:
-  // - Instead of searching [begin(), end()) it only searches [first, last).
-  // - In case no equivalent element is found, val is appended to the end of the
-  //   underlying body and an iterator to the next bigger element in [first,
-  //   last) is returned.
-  template <class V>
-  std::pair<iterator, bool> append_or_assign(iterator first,
-                                             iterator last,
-                                             V&& val) {
-    auto position = std::lower_bound(first, last, val, value_comp());
-
-    if (position == last || value_comp()(val, *position)) {
-      // emplace_back might invalidate position, which is why distance needs to
-      // be cached.
-      const difference_type distance = std::distance(begin(), position);
-      impl_.body_.emplace_back(std::forward<V>(val));
-      return {std::next(begin(), distance), true};
-    }
-
-    *position = std::forward<V>(val);
-    return {position, false};
-  }
-
-  // This method is similar to insert, with the following differences:
-  // - Instead of searching [begin(), end()) it only searches [first, last).
-  // - In case no equivalent element is found, val is appended to the end of the
-  //   underlying body and an iterator to the next bigger element in [first,
-  //   last) is returned.
-  template <class V>
-  std::pair<iterator, bool> append_unique(iterator first,
-                                          iterator last,
-                                          V&& val) {
-    auto position = std::lower_bound(first, last, val, value_comp());
-
-    if (position == last || value_comp()(val, *position)) {
-      // emplace_back might invalidate position, which is why distance needs to
-      // be cached.
-      const difference_type distance = std::distance(begin(), position);
-      impl_.body_.emplace_back(std::forward<V>(val));
-      return {std::next(begin(), distance), true};
-    }
-
-    return {position, false};
+  void sort_and_unique(iterator first,
+                       iterator last,
+                       FlatContainerDupes dupes) {
+    erase(sort_unique(first, last, dupes), last);
   }
 
-  void sort_and_unique(iterator first,
+  // Sorts [first, last) and keeps the first or the last of each run of
+  // equivalent values as |dupes| says. Returns the end of the unique values;
+  // the rest of the range is left in a moved-from state.
+  iterator sort_unique(iterator first,
                        iterator last,
                        FlatContainerDupes dupes) {
     // Preserve stability for the unique code below.
@@ -465,7 +459,93 @@ class flat_tree {
         erase_after = LastUnique(first, last, comparator);
         break;
     }
-    erase(erase_after, last);
+    return erase_after;
+  }
+
+  // Returns the first element of [first, last) that is not less than |val|.
+  // The search probes at doubling distances from |first| before bisecting,
+  // so walking a sorted sequence of values over the tree costs
+  // O(log(distance)) per value.
+  iterator gallop_lower_bound(iterator first,
+                              iterator last,
+                              const value_type& val) const {
+    const value_compare& comp = impl_.get_value_comp();
+    if (first == last || !comp(*first, val))
+      return first;
+    // *first < val from here on.
+    difference_type step = 1;
+    while (step < last - first && comp(first[step], val)) {
+      first += step;
+      step *= 2;
+    }
+    return std::lower_bound(std::next(first),
+                            first + std::min(step, last - first), val, comp);
+  }
+
+  // Removes from |batch|, which is sorted and unique, the values whose keys
+  // are already in the tree. With KEEP_LAST_OF_DUPES they replace the
+  // existing elements first.
+  void drop_existing(container_type* batch, FlatContainerDupes dupes) {
+    const value_compare& comp = impl_.get_value_comp();
+    iterator position = begin();
+    iterator kept = batch->begin();
+    for (iterator it = batch->begin(); it != batch->end(); ++it) {
+      position = gallop_lower_bound(position, end(), *it);
+      if (position != end() && !comp(*it, *position)) {
+        if (dupes == KEEP_LAST_OF_DUPES)
+          *position = std::move(*it);
+        continue;
+      }
+      if (kept != it)
+        *kept = std::move(*it);
+      ++kept;
+    }
+    batch->erase(kept, batch->end());
+  }
+
+  // Merges |batch|, which is sorted, unique and has no key that is in the
+  // tree, into the tree. Elements are moved at most once.
+  void merge_unique(container_type* batch) {
+    const size_type old_size = size();
+    const size_type count = batch->size();
+    if (!count)
+      return;
+    underlying_type& body = impl_.body_;
+    if (!old_size) {
+      body.swap(*batch);
+      return;
+    }
+    if (old_size + count > capacity())
+      reserve(std::max(old_size + count, 2 * old_size));
+
+    // The last |count| merged values go to slots that do not exist yet. Find
+    // out which they are, [i, old_size) of the tree and [j, count) of the
+    // batch, and append them in order.
+    const value_compare& comp = impl_.get_value_comp();
+    size_type i = old_size;
+    size_type j = count;
+    for (size_type n = 0; n < count; ++n) {
+      if (i && (!j || comp((*batch)[j - 1], body[i - 1])))
+        --i;
+      else
+        --j;
+    }
+    for (size_type a = i, b = j; a < old_size || b < count;) {
+      if (b == count || (a < old_size && comp(body[a], (*batch)[b])))
+        body.emplace_back(std::move(body[a++]));
+      else
+        body.emplace_back(std::move((*batch)[b++]));
+    }
+
+    // Merge the rest from the back into the slots vacated above. The first
+    // i elements of the tree are in place once the batch runs out.
+    for (size_type out = i + j; j;) {
+      --out;
+      if (i && comp((*batch)[j - 1], body[i - 1]))
+        body[out] = std::move(body[--i]);
+      else
+        body[out] = std::move((*batch)[--j]);
+    }
   }
 
   // To support comparators that may not be possible to default-construct, we
@@ -496,17 +576,17 @@ class flat_tree {
 // ----------------------------------------------------------------------------
 // Lifetime.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree() = default;
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree() = default;
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree(
     const KeyCompare& comp)
     : impl_(comp) {}
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class InputIterator>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree(
     InputIterator first,
     InputIterator last,
     FlatContainerDupes dupe_handling,
@@ -515,42 +595,42 @@ flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
   sort_and_unique(begin(), end(), dupe_handling);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree(
     const flat_tree&) = default;
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
-    std::vector<value_type> items,
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree(
+    container_type items,
     FlatContainerDupes dupe_handling,
     const KeyCompare& comp)
     : impl_(comp, std::move(items)) {
   sort_and_unique(begin(), end(), dupe_handling);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::flat_tree(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::flat_tree(
     std::initializer_list<value_type> ilist,
     FlatContainerDupes dupe_handling,
     const KeyCompare& comp)
     : flat_tree(std::begin(ilist), std::end(ilist), dupe_handling, comp) {}
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::~flat_tree() = default;
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::~flat_tree() = default;
 
 // ----------------------------------------------------------------------------
 // Assignments.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::operator=(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::operator=(
     const flat_tree&) -> flat_tree& = default;
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::operator=(flat_tree &&)
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::operator=(flat_tree &&)
     -> flat_tree& = default;
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::operator=(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::operator=(
     std::initializer_list<value_type> ilist) -> flat_tree& {
   impl_.body_ = ilist;
   sort_and_unique(begin(), end(), KEEP_FIRST_OF_DUPES);
@@ -560,117 +640,117 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::operator=(
 // ----------------------------------------------------------------------------
 // Memory management.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-void flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::reserve(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::reserve(
     size_type new_capacity) {
   impl_.body_.reserve(new_capacity);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::capacity() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::capacity() const
     -> size_type {
   return impl_.body_.capacity();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-void flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::shrink_to_fit() {
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::shrink_to_fit() {
   impl_.body_.shrink_to_fit();
 }
 
 // ----------------------------------------------------------------------------
 // Size management.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-void flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::clear() {
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::clear() {
   impl_.body_.clear();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::size() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::size() const
     -> size_type {
   return impl_.body_.size();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::max_size() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::max_size() const
     -> size_type {
   return impl_.body_.max_size();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-bool flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::empty() const {
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+bool flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::empty() const {
   return impl_.body_.empty();
 }
 
 // ----------------------------------------------------------------------------
 // Iterators.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::begin() -> iterator {
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::begin() -> iterator {
   return impl_.body_.begin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::begin() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::begin() const
     -> const_iterator {
   return impl_.body_.begin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::cbegin() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::cbegin() const
     -> const_iterator {
   return impl_.body_.cbegin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::end() -> iterator {
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::end() -> iterator {
   return impl_.body_.end();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::end() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::end() const
     -> const_iterator {
   return impl_.body_.end();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::cend() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::cend() const
     -> const_iterator {
   return impl_.body_.cend();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::rbegin()
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::rbegin()
     -> reverse_iterator {
   return impl_.body_.rbegin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::rbegin() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::rbegin() const
     -> const_reverse_iterator {
   return impl_.body_.rbegin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::crbegin() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::crbegin() const
     -> const_reverse_iterator {
   return impl_.body_.crbegin();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::rend()
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::rend()
     -> reverse_iterator {
   return impl_.body_.rend();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::rend() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::rend() const
     -> const_reverse_iterator {
   return impl_.body_.rend();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::crend() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::crend() const
     -> const_reverse_iterator {
   return impl_.body_.crend();
 }
@@ -681,28 +761,28 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::crend() const
 // Currently we use position_hint the same way as eastl or boost:
 // https://github.com/electronicarts/EASTL/blob/master/include/EASTL/vector_set.h#L493
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::insert(
     const value_type& val) -> std::pair<iterator, bool> {
   return emplace_key_args(GetKeyFromValue()(val), val);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::insert(
     value_type&& val) -> std::pair<iterator, bool> {
   return emplace_key_args(GetKeyFromValue()(val), std::move(val));
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::insert(
     const_iterator position_hint,
     const value_type& val) -> iterator {
   return emplace_hint_key_args(position_hint, GetKeyFromValue()(val), val)
       .first;
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::insert(
     const_iterator position_hint,
     value_type&& val) -> iterator {
   return emplace_hint_key_args(position_hint, GetKeyFromValue()(val),
@@ -710,103 +790,97 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
       .first;
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class InputIterator>
-void flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::insert(
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::insert(
     InputIterator first,
     InputIterator last,
     FlatContainerDupes dupes) {
   if (first == last)
     return;
 
-  // Cache results whether existing elements should be overwritten and whether
-  // inserting new elements happens immediately or will be done in a batch.
-  const bool overwrite_existing = dupes == KEEP_LAST_OF_DUPES;
-  const bool insert_inplace =
-      is_multipass<InputIterator>() && std::next(first) == last;
-
-  if (insert_inplace) {
-    if (overwrite_existing) {
-      for (; first != last; ++first)
-        insert_or_assign(*first);
-    } else
-      std::copy(first, last, std::inserter(*this, end()));
+  // A single value is inserted in place.
+  if (is_multipass<InputIterator>() && std::next(first) == last) {
+    if (dupes == KEEP_LAST_OF_DUPES)
+      insert_or_assign(*first);
+    else
+      insert(*first);
     return;
   }
 
-  // Provide a convenience lambda to obtain an iterator pointing past the last
-  // old element. This needs to be dymanic due to possible re-allocations.
-  const size_type original_size = size();
-  auto middle = [this, original_size]() {
-    return std::next(begin(), original_size);
-  };
-
-  // For batch updates initialize the first insertion point.
-  difference_type pos_first_new = original_size;
-
-  // Loop over the input range while appending new values and overwriting
-  // existing ones, if applicable. Keep track of the first insertion point.
-  if (overwrite_existing) {
-    for (; first != last; ++first) {
-      std::pair<iterator, bool> result =
-          append_or_assign(begin(), middle(), *first);
-      if (result.second) {
-        pos_first_new =
-            std::min(pos_first_new, std::distance(begin(), result.first));
-      }
-    }
-  } else {
-    for (; first != last; ++first) {
-      std::pair<iterator, bool> result =
-          append_unique(begin(), middle(), *first);
-      if (result.second) {
-        pos_first_new =
-            std::min(pos_first_new, std::distance(begin(), result.first));
-      }
-    }
-  }
-
-  // The new elements might be unordered and contain duplicates, so post-process
-  // the just inserted elements and merge them with the rest, inserting them at
-  // the previously found spot.
-  sort_and_unique(middle(), end(), dupes);
-  std::inplace_merge(std::next(begin(), pos_first_new), middle(), end(),
-                     value_comp());
+  // Sort the new values apart from the tree, drop those already in it and
+  // merge the others in.
+  container_type batch(first, last);
+  batch.erase(sort_unique(batch.begin(), batch.end(), dupes), batch.end());
+  drop_existing(&batch, dupes);
+  merge_unique(&batch);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class... Args>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::emplace(Args&&... args)
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::emplace(Args&&... args)
     -> std::pair<iterator, bool> {
   return insert(value_type(std::forward<Args>(args)...));
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class... Args>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::emplace_hint(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::emplace_hint(
     const_iterator position_hint,
     Args&&... args) -> iterator {
   return insert(position_hint, value_type(std::forward<Args>(args)...));
 }
 
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::merge(
+    flat_tree& source) {
+  if (&source == this)
+    return;
+
+  // Move the values whose keys are missing here to a batch, compacting the
+  // others at the front of |source|.
+  const value_compare& comp = impl_.get_value_comp();
+  container_type batch;
+  iterator position = begin();
+  iterator kept = source.begin();
+  for (iterator it = source.begin(); it != source.end(); ++it) {
+    position = gallop_lower_bound(position, end(), *it);
+    if (position == end() || comp(*it, *position)) {
+      batch.emplace_back(std::move(*it));
+      continue;
+    }
+    if (kept != it)
+      *kept = std::move(*it);
+    ++kept;
+  }
+  source.erase(kept, source.end());
+  merge_unique(&batch);
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::merge(
+    flat_tree&& source) {
+  merge(source);
+}
+
 // ----------------------------------------------------------------------------
 // Erase operations.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::erase(
     iterator position) -> iterator {
   return impl_.body_.erase(position);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::erase(
     const_iterator position) -> iterator {
   return impl_.body_.erase(position);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(const K& val)
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::erase(const K& val)
     -> size_type {
   auto eq_range = equal_range(val);
   auto res = std::distance(eq_range.first, eq_range.second);
@@ -814,8 +888,18 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(const K& val)
   return res;
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <class Predicate>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::erase_if(
+    Predicate pred) -> size_type {
+  auto erase_after = std::remove_if(begin(), end(), pred);
+  size_type erased = std::distance(erase_after, end());
+  erase(erase_after, end());
+  return erased;
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::erase(
     const_iterator first,
     const_iterator last) -> iterator {
   return impl_.body_.erase(first, last);
@@ -824,14 +908,14 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::erase(
 // ----------------------------------------------------------------------------
 // Comparators.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::key_comp() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::key_comp() const
     -> key_compare {
   return impl_.get_key_comp();
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::value_comp() const
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::value_comp() const
     -> value_compare {
   return impl_.get_value_comp();
 }
@@ -839,40 +923,40 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::value_comp() const
 // ----------------------------------------------------------------------------
 // Search operations.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::count(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::count(
     const K& key) const -> size_type {
   auto eq_range = equal_range(key);
   return std::distance(eq_range.first, eq_range.second);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::find(const K& key)
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::find(const K& key)
     -> iterator {
   return const_cast_it(as_const().find(key));
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::find(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::find(
     const K& key) const -> const_iterator {
   auto eq_range = equal_range(key);
   return (eq_range.first == eq_range.second) ? end() : eq_range.first;
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::equal_range(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::equal_range(
     const K& key) -> std::pair<iterator, iterator> {
   auto res = as_const().equal_range(key);
   return {const_cast_it(res.first), const_cast_it(res.second)};
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::equal_range(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::equal_range(
     const K& key) const -> std::pair<const_iterator, const_iterator> {
   auto lower = lower_bound(key);
 
@@ -883,16 +967,16 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::equal_range(
   return {lower, std::next(lower)};
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::lower_bound(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::lower_bound(
     const K& key) -> iterator {
   return const_cast_it(as_const().lower_bound(key));
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::lower_bound(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::lower_bound(
     const K& key) const -> const_iterator {
   static_assert(std::is_convertible<const KeyTypeOrK<K>&, const K&>::value,
                 "Requested type cannot be bound to the container's key_type "
@@ -904,16 +988,16 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::lower_bound(
   return std::lower_bound(begin(), end(), key_ref, key_value);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::upper_bound(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::upper_bound(
     const K& key) -> iterator {
   return const_cast_it(as_const().upper_bound(key));
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <typename K>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::upper_bound(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::upper_bound(
     const K& key) const -> const_iterator {
   static_assert(std::is_convertible<const KeyTypeOrK<K>&, const K&>::value,
                 "Requested type cannot be bound to the container's key_type "
@@ -928,23 +1012,29 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::upper_bound(
 // ----------------------------------------------------------------------------
 // General operations.
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
-void flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::swap(
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::swap(
     flat_tree& other) noexcept {
   std::swap(impl_, other.impl_);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::extract() &&
+    -> container_type {
+  return std::exchange(impl_.body_, container_type());
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class... Args>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::unsafe_emplace(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::unsafe_emplace(
     const_iterator position,
     Args&&... args) -> iterator {
   return impl_.body_.emplace(position, std::forward<Args>(args)...);
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class K, class... Args>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::emplace_key_args(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::emplace_key_args(
     const K& key,
     Args&&... args) -> std::pair<iterator, bool> {
   auto lower = lower_bound(key);
@@ -953,9 +1043,9 @@ auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::emplace_key_args(
   return {lower, false};
 }
 
-template <class Key, class Value, class GetKeyFromValue, class KeyCompare>
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
 template <class K, class... Args>
-auto flat_tree<Key, Value, GetKeyFromValue, KeyCompare>::emplace_hint_key_args(
+auto flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::emplace_hint_key_args(
     const_iterator hint,
     const K& key,
     Args&&... args) -> std::pair<iterator, bool> {
@@ -987,17 +1077,17 @@ struct GetKeyFromValueIdentity {
 // Free functions.
 
 // Erases all elements that match predicate. It has O(size) complexity.
+// Returns the number of elements erased.
 template <class Key,
-          class Value,
           class GetKeyFromValue,
           class KeyCompare,
+          class Container,
           typename Predicate>
-void EraseIf(
-    winbase::internal::flat_tree<Key, Value, GetKeyFromValue, KeyCompare>&
+size_t EraseIf(
+    winbase::internal::flat_tree<Key, GetKeyFromValue, KeyCompare, Container>&
         container,
     Predicate pred) {
-  container.erase(std::remove_if(container.begin(), container.end(), pred),
-                  container.end());
+  return container.erase_if(pred);
 }
 
 }  // namespace winbase
@@ -0,0 +1,117 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_MAP_H_
+#define WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_MAP_H_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "winbase\containers\flat_map.h"
+#include "winbase\containers\frozen_flat_tree.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+// frozen_flat_map is a read-only flat_map for large tables that are built
+// once and looked up often, like routing or symbol tables. It keeps the
+// sorted values of the flat_map it is built from, and adds a search index
+// laid out in cache line sized nodes, so that lookups in a map of 100k
+// entries touch a handful of cache lines instead of a chain of about 17. See
+// frozen_flat_tree.h for the layout.
+//
+// Lookups are fastest with 32- and 64-bit integer keys and the default
+// comparator. The index takes about size() * sizeof(Key) bytes more for
+// those, and a few percent of that for other keys.
+//
+// Example:
+//   winbase::flat_map<uint32_t, Route> routes;
+//   ...  // Fill |routes|.
+//   const winbase::frozen_flat_map<uint32_t, Route> frozen(std::move(routes));
+//   auto it = frozen.find(address);
+//
+// QUICK REFERENCE
+//
+// Constructors:
+//   frozen_flat_map(const flat_map&);
+//   frozen_flat_map(flat_map&&);  // Re-use storage.
+//   frozen_flat_map(container_type,
+//                   FlatContainerDupes = KEEP_FIRST_OF_DUPES,
+//                   const Compare& compare = Compare());
+//
+// Size, iterator and comparator functions, as in flat_map:
+//   size(), empty(), begin(), end(), rbegin(), rend(), key_comp(), ...
+//
+// Search functions:
+//   template <typename K> const mapped_type& at(const K&) const;
+//   template <typename K> size_t             count(const K&) const;
+//   template <typename K> bool               contains(const K&) const;
+//   template <typename K> const_iterator     find(const K&) const;
+//   template <typename K> pair<const_iterator, const_iterator>
+//                                            equal_range(const K&) const;
+//   template <typename K> const_iterator     lower_bound(const K&) const;
+//   template <typename K> const_iterator     upper_bound(const K&) const;
+//
+// General functions:
+//   void swap(frozen_flat_map&);
+template <class Key,
+          class Mapped,
+          class Compare = std::less<>,
+          class Container = std::vector<std::pair<Key, Mapped>>>
+class frozen_flat_map
+    : public ::winbase::internal::frozen_flat_tree<
+          Key,
+          ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+          Compare,
+          Container> {
+ private:
+  using tree = typename ::winbase::internal::frozen_flat_tree<
+      Key,
+      ::winbase::internal::GetKeyFromValuePairFirst<Key, Mapped>,
+      Compare,
+      Container>;
+
+ public:
+  using key_type = typename tree::key_type;
+  using mapped_type = Mapped;
+  using value_type = typename tree::value_type;
+  using container_type = typename tree::container_type;
+  using const_iterator = typename tree::const_iterator;
+  using map_type = flat_map<Key, Mapped, Compare, Container>;
+
+  frozen_flat_map() = default;
+  explicit frozen_flat_map(const map_type& map) : tree(map) {}
+  explicit frozen_flat_map(map_type&& map) : tree(std::move(map)) {}
+  explicit frozen_flat_map(
+      container_type items,
+      FlatContainerDupes dupe_handling = KEEP_FIRST_OF_DUPES,
+      const Compare& comp = Compare())
+      : tree(std::move(items), dupe_handling, comp) {}
+
+  frozen_flat_map(const frozen_flat_map&) = default;
+  frozen_flat_map(frozen_flat_map&&) noexcept = default;
+  ~frozen_flat_map() = default;
+
+  frozen_flat_map& operator=(const frozen_flat_map&) = default;
+  frozen_flat_map& operator=(frozen_flat_map&&) = default;
+
+  // Returns the value mapped to |key|, which must be present.
+  template <typename K>
+  const mapped_type& at(const K& key) const {
+    const_iterator found = tree::find(key);
+    WINBASE_CHECK(found != tree::end());
+    return found->second;
+  }
+
+  void swap(frozen_flat_map& other) noexcept { tree::swap(other); }
+
+  friend void swap(frozen_flat_map& lhs, frozen_flat_map& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_MAP_H_
\ No newline at end of file
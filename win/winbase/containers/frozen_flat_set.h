@@ -0,0 +1,86 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_SET_H_
+#define WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_SET_H_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "winbase\containers\flat_tree.h"
+#include "winbase\containers\frozen_flat_tree.h"
+
+namespace winbase {
+
+// frozen_flat_set is the set counterpart of frozen_flat_map: a read-only
+// sorted vector of keys with a cache line friendly search index, for large
+// sets that are built once and looked up often. See frozen_flat_tree.h for
+// the layout.
+//
+// It is built from a container, which need not be sorted, or from a
+// flat_tree with identity keys.
+//
+// Example:
+//   std::vector<uint64_t> hashes = LoadSymbolHashes();
+//   const winbase::frozen_flat_set<uint64_t> known(std::move(hashes));
+//   if (known.contains(hash))
+//     ...
+//
+// QUICK REFERENCE
+//
+// Constructors:
+//   frozen_flat_set(container_type,
+//                   FlatContainerDupes = KEEP_FIRST_OF_DUPES,
+//                   const Compare& compare = Compare());
+//   frozen_flat_set(const tree_type&);
+//   frozen_flat_set(tree_type&&);  // Re-use storage.
+//
+// Size, iterator, comparator and search functions are those of
+// frozen_flat_map, without at().
+template <class Key,
+          class Compare = std::less<>,
+          class Container = std::vector<Key>>
+class frozen_flat_set : public ::winbase::internal::frozen_flat_tree<
+                            Key,
+                            ::winbase::internal::GetKeyFromValueIdentity<Key>,
+                            Compare,
+                            Container> {
+ private:
+  using tree = typename ::winbase::internal::frozen_flat_tree<
+      Key,
+      ::winbase::internal::GetKeyFromValueIdentity<Key>,
+      Compare,
+      Container>;
+
+ public:
+  using container_type = typename tree::container_type;
+  using tree_type = typename tree::tree_type;
+
+  frozen_flat_set() = default;
+  explicit frozen_flat_set(const tree_type& set) : tree(set) {}
+  explicit frozen_flat_set(tree_type&& set) : tree(std::move(set)) {}
+  explicit frozen_flat_set(
+      container_type items,
+      FlatContainerDupes dupe_handling = KEEP_FIRST_OF_DUPES,
+      const Compare& comp = Compare())
+      : tree(std::move(items), dupe_handling, comp) {}
+
+  frozen_flat_set(const frozen_flat_set&) = default;
+  frozen_flat_set(frozen_flat_set&&) noexcept = default;
+  ~frozen_flat_set() = default;
+
+  frozen_flat_set& operator=(const frozen_flat_set&) = default;
+  frozen_flat_set& operator=(frozen_flat_set&&) = default;
+
+  void swap(frozen_flat_set& other) noexcept { tree::swap(other); }
+
+  friend void swap(frozen_flat_set& lhs, frozen_flat_set& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_SET_H_
\ No newline at end of file
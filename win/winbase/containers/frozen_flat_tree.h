@@ -0,0 +1,549 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_TREE_H_
+#define WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_TREE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\bits.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\containers\flat_tree.h"
+#include "winbase\numerics\safe_conversions.h"
+#include "winlib\build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
+
+namespace winbase {
+
+namespace internal {
+
+// True if the index of a frozen_flat_tree holds |Key|s in cache line sized
+// nodes that are searched without calling the comparator.
+template <class Key, class KeyCompare>
+struct IsFrozenIntegerKey
+    : std::integral_constant<
+          bool,
+          std::is_integral<Key>::value && !std::is_same<Key, bool>::value &&
+              (sizeof(Key) == 4 || sizeof(Key) == 8) &&
+              (std::is_same<KeyCompare, std::less<>>::value ||
+               std::is_same<KeyCompare, std::less<Key>>::value)> {};
+
+// A node of the index of integer keys, filling one cache line.
+template <class Key>
+struct ALIGNAS(64) FrozenIntegerNode {
+  static constexpr size_t kSize = 64 / sizeof(Key);
+  Key keys[kSize];
+};
+
+// Returns how many of the sorted |count| elements at |first| satisfy |pred|,
+// which must hold for a prefix of them. This is a binary search whose steps
+// do not branch on |pred|, so it costs the same log2(count) + 1 calls to
+// |pred| for every input and never mispredicts.
+template <class Iterator, class Pred>
+size_t BranchlessCount(Iterator first, size_t count, Pred pred) {
+  if (!count)
+    return 0;
+  Iterator base = first;
+  while (count > 1) {
+    size_t half = count / 2;
+    base += pred(base[half - 1]) ? half : 0;
+    count -= half;
+  }
+  return static_cast<size_t>(base - first) + (pred(*base) ? 1 : 0);
+}
+
+// Returns how many keys of |node| are less than |key|, or not greater than
+// |key| if |upper|.
+template <bool upper, class Key>
+size_t CountIntegerNode(const FrozenIntegerNode<Key>& node, Key key) {
+  size_t count = 0;
+  for (size_t i = 0; i < FrozenIntegerNode<Key>::kSize; ++i)
+    count += upper ? node.keys[i] <= key : node.keys[i] < key;
+  return count;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// Compares the 16 keys of a node of 32-bit keys with |key| four at a time and
+// packs the results into one mask. Unsigned keys are compared as signed ones
+// after flipping their sign bits.
+template <bool upper, bool is_signed>
+size_t CountIntegerNode32(const FrozenIntegerNode<uint32_t>& node,
+                          uint32_t key) {
+  const __m128i bias = _mm_set1_epi32(is_signed ? 0 : INT32_MIN);
+  const __m128i needle =
+      _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(key)), bias);
+  const __m128i* keys = reinterpret_cast<const __m128i*>(node.keys);
+  __m128i results[4];
+  for (int i = 0; i < 4; ++i) {
+    __m128i values = _mm_xor_si128(_mm_load_si128(keys + i), bias);
+    results[i] = upper ? _mm_cmpgt_epi32(values, needle)
+                       : _mm_cmpgt_epi32(needle, values);
+  }
+  uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+      _mm_packs_epi16(_mm_packs_epi32(results[0], results[1]),
+                      _mm_packs_epi32(results[2], results[3]))));
+  // The lesser keys are a prefix of the node, the greater ones a suffix.
+  return upper ? bits::CountTrailingZeroBits(mask | 0x10000u)
+               : bits::CountTrailingZeroBits(~mask);
+}
+
+template <bool upper>
+size_t CountIntegerNode(const FrozenIntegerNode<int32_t>& node, int32_t key) {
+  return CountIntegerNode32<upper, true>(
+      reinterpret_cast<const FrozenIntegerNode<uint32_t>&>(node),
+      static_cast<uint32_t>(key));
+}
+
+template <bool upper>
+size_t CountIntegerNode(const FrozenIntegerNode<uint32_t>& node,
+                        uint32_t key) {
+  return CountIntegerNode32<upper, false>(node, key);
+}
+
+#endif  // defined(ARCH_CPU_X86_FAMILY)
+
+// Implementation -------------------------------------------------------------
+
+// Implementation of a read-only sorted vector with a search index, backing
+// frozen_flat_set and frozen_flat_map. Do not use directly.
+//
+// The values are kept sorted in a Container, as in flat_tree, so iteration is
+// unchanged. Lookups go through a static B+ tree built next to it: every
+// level holds the last key of each block of the level below, and a search
+// descends from the single node at the top, picking the block to descend
+// into by counting the keys of the current node that are before the key. A
+// lookup among n values touches about log(n) / log(node size) nodes instead
+// of the log2(n) scattered cache lines of a binary search.
+//
+// When Key is a 32- or 64-bit integer compared with std::less, the index
+// copies the keys into nodes of one cache line, padded with the largest
+// value, and the counting neither calls the comparator nor branches; with
+// SSE2 a node of 32-bit keys is counted with four vector compares. The leaf
+// level is then part of the index and the values are only touched once
+// found. Other keys use nodes of 16 keys searched with the comparator, the
+// leaf level being the values themselves.
+//
+// The index holds about n / (node size - 1) keys, and n more for integer
+// keys.
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+class frozen_flat_tree {
+ private:
+  using underlying_type = Container;
+
+ public:
+  // --------------------------------------------------------------------------
+  // Types.
+  //
+  using tree_type = flat_tree<Key, GetKeyFromValue, KeyCompare, Container>;
+  using key_type = Key;
+  using key_compare = KeyCompare;
+  using value_type = typename Container::value_type;
+  using container_type = Container;
+  using value_compare = typename tree_type::value_compare;
+
+  using pointer = typename underlying_type::const_pointer;
+  using const_pointer = typename underlying_type::const_pointer;
+  using reference = typename underlying_type::const_reference;
+  using const_reference = typename underlying_type::const_reference;
+  using size_type = typename underlying_type::size_type;
+  using difference_type = typename underlying_type::difference_type;
+  using iterator = typename underlying_type::const_iterator;
+  using const_iterator = typename underlying_type::const_iterator;
+  using reverse_iterator = typename underlying_type::const_reverse_iterator;
+  using const_reverse_iterator =
+      typename underlying_type::const_reverse_iterator;
+
+  // --------------------------------------------------------------------------
+  // Lifetime.
+  //
+  // Building the index is O(size). Taking a flat_tree by rvalue reuses its
+  // storage; the container constructor sorts as flat_tree does.
+
+  frozen_flat_tree();
+  explicit frozen_flat_tree(const tree_type& tree);
+  explicit frozen_flat_tree(tree_type&& tree);
+  explicit frozen_flat_tree(
+      container_type items,
+      FlatContainerDupes dupe_handling = KEEP_FIRST_OF_DUPES,
+      const key_compare& comp = key_compare());
+
+  frozen_flat_tree(const frozen_flat_tree&);
+  frozen_flat_tree(frozen_flat_tree&&) noexcept;
+  ~frozen_flat_tree();
+
+  frozen_flat_tree& operator=(const frozen_flat_tree&);
+  frozen_flat_tree& operator=(frozen_flat_tree&&) noexcept;
+
+  // --------------------------------------------------------------------------
+  // Size and iterators. The values cannot be modified.
+
+  size_type size() const { return body_.size(); }
+  bool empty() const { return body_.empty(); }
+
+  const_iterator begin() const { return body_.begin(); }
+  const_iterator cbegin() const { return body_.cbegin(); }
+  const_iterator end() const { return body_.end(); }
+  const_iterator cend() const { return body_.cend(); }
+  const_reverse_iterator rbegin() const { return body_.rbegin(); }
+  const_reverse_iterator crbegin() const { return body_.crbegin(); }
+  const_reverse_iterator rend() const { return body_.rend(); }
+  const_reverse_iterator crend() const { return body_.crend(); }
+
+  // --------------------------------------------------------------------------
+  // Comparators.
+
+  key_compare key_comp() const { return comp_; }
+  value_compare value_comp() const { return value_compare(comp_); }
+
+  // --------------------------------------------------------------------------
+  // Search operations.
+  //
+  // Search operations take O(log(size)) time and, for integer keys, no
+  // mispredicted branches before the last level.
+
+  template <typename K>
+  size_type count(const K& key) const;
+
+  template <typename K>
+  bool contains(const K& key) const;
+
+  template <typename K>
+  const_iterator find(const K& key) const;
+
+  template <typename K>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+  template <typename K>
+  const_iterator lower_bound(const K& key) const;
+
+  template <typename K>
+  const_iterator upper_bound(const K& key) const;
+
+  // --------------------------------------------------------------------------
+  // General operations.
+
+  void swap(frozen_flat_tree& other) noexcept;
+
+  friend bool operator==(const frozen_flat_tree& lhs,
+                         const frozen_flat_tree& rhs) {
+    return lhs.body_ == rhs.body_;
+  }
+
+  friend bool operator!=(const frozen_flat_tree& lhs,
+                         const frozen_flat_tree& rhs) {
+    return !(lhs == rhs);
+  }
+
+  friend void swap(frozen_flat_tree& lhs, frozen_flat_tree& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  static constexpr bool kIntegerKeys = IsFrozenIntegerKey<Key, KeyCompare>();
+  using IndexNode =
+      std::conditional_t<kIntegerKeys, FrozenIntegerNode<Key>, Key>;
+  static constexpr size_type kNodeSize =
+      kIntegerKeys ? 64 / sizeof(Key) : 16;
+
+  // A level of the index. |offset| counts nodes for integer keys and keys
+  // otherwise; |size| counts keys.
+  struct Level {
+    size_type offset;
+    size_type size;
+  };
+
+  // Fills |index_| and |levels_| from |body_|.
+  void BuildIndex();
+
+  // Returns the position of the first value whose key is not less than
+  // |key|, or greater than |key| if |upper|.
+  template <bool upper, typename K>
+  size_type Search(const K& key) const;
+
+  // Search() once |key| has the type the index is searched with.
+  template <bool upper, typename K>
+  size_type SearchIndex(const K& key) const;
+
+  // Returns how many keys of node |node| of |level| are before |key|, as
+  // Search() orders them.
+  template <bool upper, typename K>
+  size_type CountInNode(const Level& level,
+                        size_type node,
+                        const K& key) const;
+
+  // Returns how many of the |count| values starting at |offset| are before
+  // |key|, as Search() orders them.
+  template <bool upper, typename K>
+  size_type CountInLeaf(size_type offset, size_type count, const K& key) const;
+
+  key_compare comp_;
+  underlying_type body_;
+
+  // The nodes of the index, bottom level first, and its levels, top first.
+  std::vector<IndexNode> index_;
+  std::vector<Level> levels_;
+};
+
+// ----------------------------------------------------------------------------
+// Lifetime.
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree() = default;
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree(const tree_type& tree)
+    : comp_(tree.key_comp()), body_(tree.begin(), tree.end()) {
+  BuildIndex();
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree(tree_type&& tree)
+    : comp_(tree.key_comp()), body_(std::move(tree).extract()) {
+  BuildIndex();
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree(container_type items,
+                     FlatContainerDupes dupe_handling,
+                     const key_compare& comp)
+    : frozen_flat_tree(tree_type(std::move(items), dupe_handling, comp)) {}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree(const frozen_flat_tree&) = default;
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    frozen_flat_tree(frozen_flat_tree&&) noexcept = default;
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    ~frozen_flat_tree() = default;
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::operator=(
+    const frozen_flat_tree&) -> frozen_flat_tree& = default;
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::operator=(
+    frozen_flat_tree&&) noexcept -> frozen_flat_tree& = default;
+
+// ----------------------------------------------------------------------------
+// Search operations.
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::count(
+    const K& key) const -> size_type {
+  return contains(key) ? 1 : 0;
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+bool frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::contains(
+    const K& key) const {
+  return find(key) != end();
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::find(
+    const K& key) const -> const_iterator {
+  const_iterator found = lower_bound(key);
+  if (found == end() || comp_(key, GetKeyFromValue()(*found)))
+    return end();
+  return found;
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    equal_range(const K& key) const
+    -> std::pair<const_iterator, const_iterator> {
+  const_iterator lower = lower_bound(key);
+  if (lower == end() || comp_(key, GetKeyFromValue()(*lower)))
+    return {lower, lower};
+  return {lower, std::next(lower)};
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    lower_bound(const K& key) const -> const_iterator {
+  return begin() + Search<false>(key);
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    upper_bound(const K& key) const -> const_iterator {
+  return begin() + Search<true>(key);
+}
+
+// ----------------------------------------------------------------------------
+// General operations.
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::swap(
+    frozen_flat_tree& other) noexcept {
+  std::swap(comp_, other.comp_);
+  body_.swap(other.body_);
+  index_.swap(other.index_);
+  levels_.swap(other.levels_);
+}
+
+// ----------------------------------------------------------------------------
+// Index.
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+void frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    BuildIndex() {
+  GetKeyFromValue extractor;
+  size_type below = size();
+  if (!below)
+    return;
+
+  // Integer keys are copied into the leaf level of the index.
+  if constexpr (kIntegerKeys) {
+    levels_.push_back({0, below});
+    index_.resize((below + kNodeSize - 1) / kNodeSize);
+    for (size_type i = 0; i < index_.size() * kNodeSize; ++i) {
+      index_[i / kNodeSize].keys[i % kNodeSize] =
+          i < below ? extractor(body_[i]) : std::numeric_limits<Key>::max();
+    }
+  }
+
+  while (below > kNodeSize) {
+    size_type level_size = (below + kNodeSize - 1) / kNodeSize;
+    if constexpr (kIntegerKeys) {
+      const Level& level_below = levels_.back();
+      Level level = {index_.size(), level_size};
+      index_.resize(index_.size() + (level_size + kNodeSize - 1) / kNodeSize);
+      for (size_type i = 0; i < (index_.size() - level.offset) * kNodeSize;
+           ++i) {
+        Key key = std::numeric_limits<Key>::max();
+        if (i < level_size) {
+          // The last key of block i of the level below.
+          size_type last = std::min((i + 1) * kNodeSize, below) - 1;
+          key = index_[level_below.offset + last / kNodeSize]
+                    .keys[last % kNodeSize];
+        }
+        index_[level.offset + i / kNodeSize].keys[i % kNodeSize] = key;
+      }
+      levels_.push_back(level);
+    } else {
+      Level level = {index_.size(), level_size};
+      index_.reserve(index_.size() + level_size);
+      for (size_type i = 0; i < level_size; ++i) {
+        size_type last = std::min((i + 1) * kNodeSize, below) - 1;
+        if (levels_.empty())
+          index_.push_back(extractor(body_[last]));
+        else
+          index_.push_back(index_[levels_.back().offset + last]);
+      }
+      levels_.push_back(level);
+    }
+    below = level_size;
+  }
+  std::reverse(levels_.begin(), levels_.end());
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <bool upper, typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::Search(
+    const K& key) const -> size_type {
+  if constexpr (kIntegerKeys && std::is_integral<K>::value &&
+                !std::is_same<K, Key>::value) {
+    // Search for the key converted to Key, so that the nodes are counted
+    // without the comparator.
+    if (!IsValueInRangeForNumericType<Key>(key)) {
+      if constexpr (std::is_signed<K>::value) {
+        if (key < 0)
+          return 0;
+      }
+      return size();
+    }
+    return Search<upper>(static_cast<Key>(key));
+  } else {
+    return SearchIndex<upper>(key);
+  }
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <bool upper, typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    SearchIndex(const K& key) const -> size_type {
+  // |position| goes from the index of a node in its level to the index of a
+  // key in the level below.
+  size_type position = 0;
+  for (const Level& level : levels_) {
+    position = position * kNodeSize + CountInNode<upper>(level, position, key);
+    // Only the padding of the last node or a key after all others gets
+    // there.
+    if (position >= level.size)
+      return size();
+  }
+  if constexpr (kIntegerKeys) {
+    return position;
+  } else {
+    size_type offset = position * kNodeSize;
+    return offset + CountInLeaf<upper>(
+                        offset, std::min(kNodeSize, size() - offset), key);
+  }
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <bool upper, typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    CountInNode(const Level& level, size_type node, const K& key) const
+    -> size_type {
+  auto pred = [this, &key](const Key& k) {
+    return upper ? !comp_(key, k) : comp_(k, key);
+  };
+  if constexpr (kIntegerKeys) {
+    const IndexNode& index_node = index_[level.offset + node];
+    if constexpr (std::is_same<K, Key>::value)
+      return CountIntegerNode<upper>(index_node, key);
+    else
+      return BranchlessCount(index_node.keys, kNodeSize, pred);
+  } else {
+    size_type offset = node * kNodeSize;
+    return BranchlessCount(index_.begin() + level.offset + offset,
+                           std::min(kNodeSize, level.size - offset), pred);
+  }
+}
+
+template <class Key, class GetKeyFromValue, class KeyCompare, class Container>
+template <bool upper, typename K>
+auto frozen_flat_tree<Key, GetKeyFromValue, KeyCompare, Container>::
+    CountInLeaf(size_type offset, size_type count, const K& key) const
+    -> size_type {
+  return BranchlessCount(body_.begin() + offset, count,
+                         [this, &key](const value_type& value) {
+                           const Key& k = GetKeyFromValue()(value);
+                           return upper ? !comp_(key, k) : comp_(k, key);
+                         });
+}
+
+}  // namespace internal
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_FROZEN_FLAT_TREE_H_
\ No newline at end of file
@@ -0,0 +1,515 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_INLINED_VECTOR_H_
+#define WINLIB_WINBASE_CONTAINERS_INLINED_VECTOR_H_
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "winbase\compiler_specific.h"
+#include "winbase\containers\vector_buffer.h"
+#include "winbase\logging.h"
+#include "winbase\template_util.h"
+
+// winbase::InlinedVector is a std::vector that keeps up to N elements inside
+// the object itself and only allocates when it grows past them. Use it for
+// the many short vectors of hot paths, such as split results or observer
+// snapshots, where the allocation of a std::vector costs more than the work
+// done with it.
+//
+// The API is that of std::vector with the following differences:
+//
+//  - Moving an InlinedVector moves its elements one by one while they are
+//    inline, so it is O(size) and invalidates iterators. swap() is also
+//    O(size).
+//
+//  - Once on the heap, the elements stay there until shrink_to_fit() brings
+//    them back inline, which it does when size() <= N.
+//
+//  - The allocation functions of std::allocator are not used, so there is
+//    no allocator parameter.
+//
+// Elements are relocated with memcpy when they are trivially copyable and
+// with their move constructor otherwise, using the helpers of VectorBuffer.
+//
+// InlinedVector can back a flat_map, e.g.
+//   winbase::flat_map<int, int, std::less<>,
+//                     winbase::InlinedVector<std::pair<int, int>, 8>>
+// does not allocate until it has more than 8 elements.
+//
+// Pick N so that the object stays small: it holds N elements even when
+// empty, so InlinedVectors with a large N should not be kept in bulk.
+
+namespace winbase {
+
+template <typename T, size_t N>
+class InlinedVector {
+ private:
+  using VectorBuffer = internal::VectorBuffer<T>;
+
+ public:
+  static_assert(N > 0, "use std::vector when nothing is stored inline");
+
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // ---------------------------------------------------------------------------
+  // Constructor
+
+  InlinedVector() = default;
+
+  explicit InlinedVector(size_type count) { resize(count); }
+
+  InlinedVector(size_type count, const T& value) {
+    insert(end(), count, value);
+  }
+
+  template <class InputIterator,
+            typename = std::enable_if_t<
+                internal::is_iterator<InputIterator>::value>>
+  InlinedVector(InputIterator first, InputIterator last) {
+    insert(end(), first, last);
+  }
+
+  InlinedVector(std::initializer_list<T> init) {
+    insert(end(), init.begin(), init.end());
+  }
+
+  InlinedVector(const InlinedVector& other) {
+    insert(end(), other.begin(), other.end());
+  }
+
+  InlinedVector(InlinedVector&& other) noexcept { TakeElements(&other); }
+
+  ~InlinedVector() { VectorBuffer::DestructRange(begin(), end()); }
+
+  // ---------------------------------------------------------------------------
+  // Assignments.
+
+  InlinedVector& operator=(const InlinedVector& other) {
+    if (&other != this)
+      assign(other.begin(), other.end());
+    return *this;
+  }
+
+  InlinedVector& operator=(InlinedVector&& other) noexcept {
+    if (&other != this) {
+      VectorBuffer::DestructRange(begin(), end());
+      size_ = 0;
+      heap_ = VectorBuffer();
+      TakeElements(&other);
+    }
+    return *this;
+  }
+
+  InlinedVector& operator=(std::initializer_list<T> ilist) {
+    assign(ilist.begin(), ilist.end());
+    return *this;
+  }
+
+  void assign(size_type count, const T& value) {
+    if (value_is_inside(value)) {
+      T copy(value);
+      clear();
+      insert(end(), count, copy);
+    } else {
+      clear();
+      insert(end(), count, value);
+    }
+  }
+
+  template <class InputIterator,
+            typename = std::enable_if_t<
+                internal::is_iterator<InputIterator>::value>>
+  void assign(InputIterator first, InputIterator last) {
+    clear();
+    insert(end(), first, last);
+  }
+
+  void assign(std::initializer_list<T> ilist) {
+    assign(ilist.begin(), ilist.end());
+  }
+
+  // ---------------------------------------------------------------------------
+  // Accessors.
+
+  T& at(size_type i) {
+    WINBASE_CHECK(i < size_);
+    return data()[i];
+  }
+  const T& at(size_type i) const {
+    WINBASE_CHECK(i < size_);
+    return data()[i];
+  }
+
+  T& operator[](size_type i) {
+    WINBASE_DCHECK(i < size_);
+    return data()[i];
+  }
+  const T& operator[](size_type i) const {
+    WINBASE_DCHECK(i < size_);
+    return data()[i];
+  }
+
+  T& front() {
+    WINBASE_DCHECK(!empty());
+    return data()[0];
+  }
+  const T& front() const {
+    WINBASE_DCHECK(!empty());
+    return data()[0];
+  }
+
+  T& back() {
+    WINBASE_DCHECK(!empty());
+    return data()[size_ - 1];
+  }
+  const T& back() const {
+    WINBASE_DCHECK(!empty());
+    return data()[size_ - 1];
+  }
+
+  T* data() { return is_inline() ? inline_data() : heap_.begin(); }
+  const T* data() const { return is_inline() ? inline_data() : heap_.begin(); }
+
+  // ---------------------------------------------------------------------------
+  // Iterators.
+
+  iterator begin() { return data(); }
+  const_iterator begin() const { return data(); }
+  const_iterator cbegin() const { return data(); }
+
+  iterator end() { return data() + size_; }
+  const_iterator end() const { return data() + size_; }
+  const_iterator cend() const { return data() + size_; }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator crbegin() const { return rbegin(); }
+
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crend() const { return rend(); }
+
+  // ---------------------------------------------------------------------------
+  // Memory management.
+
+  size_type capacity() const { return is_inline() ? N : heap_.capacity(); }
+
+  // Growing past N moves the elements to the heap.
+  void reserve(size_type new_capacity) {
+    if (new_capacity > capacity())
+      Reallocate(new_capacity);
+  }
+
+  // Moves the elements back inline if they fit.
+  void shrink_to_fit() {
+    if (!is_inline() && size_ < heap_.capacity())
+      Reallocate(size_);
+  }
+
+  // ---------------------------------------------------------------------------
+  // Size management.
+
+  // Destroys the elements but keeps the capacity.
+  void clear() {
+    VectorBuffer::DestructRange(begin(), end());
+    size_ = 0;
+  }
+
+  bool empty() const { return !size_; }
+  size_type size() const { return size_; }
+  size_type max_size() const {
+    return std::numeric_limits<difference_type>::max() / sizeof(T);
+  }
+
+  void resize(size_type count) {
+    if (count <= size_) {
+      VectorBuffer::DestructRange(begin() + count, end());
+      size_ = count;
+      return;
+    }
+    reserve(count);
+    for (T* p = end(); p != data() + count; ++p)
+      new (p) T();
+    size_ = count;
+  }
+
+  void resize(size_type count, const T& value) {
+    if (count <= size_) {
+      VectorBuffer::DestructRange(begin() + count, end());
+      size_ = count;
+      return;
+    }
+    insert(end(), count - size_, value);
+  }
+
+  // ---------------------------------------------------------------------------
+  // Insert and erase.
+  //
+  // Insertions invalidate all iterators when the capacity grows, and the
+  // iterators after the insertion point otherwise. Erasing invalidates the
+  // iterators from the first erased element on.
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  template <class... Args>
+  T& emplace_back(Args&&... args) {
+    if (LIKELY(size_ < capacity())) {
+      T* element = new (end()) T(std::forward<Args>(args)...);
+      ++size_;
+      return *element;
+    }
+    // Construct the new element before moving the others, as |args| may
+    // refer to one of them.
+    VectorBuffer new_buffer(NewCapacity(size_ + 1));
+    T* element = new (&new_buffer[size_]) T(std::forward<Args>(args)...);
+    VectorBuffer::MoveRange(begin(), end(), new_buffer.begin());
+    heap_ = std::move(new_buffer);
+    ++size_;
+    return *element;
+  }
+
+  void pop_back() {
+    WINBASE_DCHECK(!empty());
+    --size_;
+    VectorBuffer::DestructRange(end(), end() + 1);
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  iterator insert(const_iterator pos, size_type count, const T& value) {
+    size_type index = pos - begin();
+    if (!count)
+      return begin() + index;
+    // |value| may be an element that making room moves.
+    T copy(value);
+    T* gap = MakeRoom(index, count);
+    std::uninitialized_fill(gap, gap + count, copy);
+    return gap;
+  }
+
+  template <class InputIterator,
+            typename = std::enable_if_t<
+                internal::is_iterator<InputIterator>::value>>
+  iterator insert(const_iterator pos, InputIterator first, InputIterator last) {
+    size_type index = pos - begin();
+    using Category =
+        typename std::iterator_traits<InputIterator>::iterator_category;
+    if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                  Category>::value) {
+      size_type count = std::distance(first, last);
+      if (count) {
+        T* gap = MakeRoom(index, count);
+        std::uninitialized_copy(first, last, gap);
+      }
+    } else {
+      for (size_type i = index; first != last; ++first, ++i)
+        emplace(begin() + i, *first);
+    }
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> ilist) {
+    return insert(pos, ilist.begin(), ilist.end());
+  }
+
+  template <class... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    size_type index = pos - begin();
+    if (index == size_) {
+      emplace_back(std::forward<Args>(args)...);
+      return end() - 1;
+    }
+    // |args| may refer to an element that making room moves.
+    T value(std::forward<Args>(args)...);
+    T* gap = MakeRoom(index, 1);
+    new (gap) T(std::move(value));
+    return gap;
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    WINBASE_DCHECK(begin() <= first && first <= last && last <= end());
+    T* from = const_cast<T*>(last);
+    T* to = const_cast<T*>(first);
+    if (from != to) {
+      VectorBuffer::DestructRange(to, from);
+      RelocateRange(from, end(), to);
+      size_ -= from - to;
+    }
+    return to;
+  }
+
+  void swap(InlinedVector& other) {
+    InlinedVector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend void swap(InlinedVector& lhs, InlinedVector& rhs) { lhs.swap(rhs); }
+
+ private:
+  bool is_inline() const { return !heap_.capacity(); }
+
+  T* inline_data() { return reinterpret_cast<T*>(inline_); }
+  const T* inline_data() const { return reinterpret_cast<const T*>(inline_); }
+
+  bool value_is_inside(const T& value) const {
+    return &value >= begin() && &value < end();
+  }
+
+  // Relocates [begin, end) to |to|, which may overlap it. The destination is
+  // uninitialized and the source is left uninitialized.
+  static void RelocateRange(T* begin, T* end, T* to) {
+    if (begin == to || begin == end)
+      return;
+    if constexpr (is_trivially_copyable<T>::value) {
+      memmove(to, begin, (end - begin) * sizeof(T));
+    } else if (to < begin) {
+      for (; begin != end; ++begin, ++to) {
+        new (to) T(std::move(*begin));
+        begin->~T();
+      }
+    } else {
+      to += end - begin;
+      while (end != begin) {
+        --end;
+        --to;
+        new (to) T(std::move(*end));
+        end->~T();
+      }
+    }
+  }
+
+  size_type NewCapacity(size_type min_capacity) const {
+    return std::max(min_capacity, capacity() * 2);
+  }
+
+  // Moves the elements into a buffer of |new_capacity|, inline if it is at
+  // most N.
+  void Reallocate(size_type new_capacity) {
+    WINBASE_DCHECK(new_capacity >= size_);
+    if (new_capacity <= N) {
+      if (is_inline())
+        return;
+      VectorBuffer old_buffer(std::move(heap_));
+      VectorBuffer::MoveRange(old_buffer.begin(), old_buffer.begin() + size_,
+                              inline_data());
+      return;
+    }
+    VectorBuffer new_buffer(new_capacity);
+    VectorBuffer::MoveRange(begin(), end(), new_buffer.begin());
+    heap_ = std::move(new_buffer);
+  }
+
+  // Opens an uninitialized gap of |count| elements at |index|, growing the
+  // capacity if needed, and returns it. The caller must construct the
+  // elements of the gap.
+  T* MakeRoom(size_type index, size_type count) {
+    WINBASE_DCHECK(index <= size_);
+    if (size_ + count <= capacity()) {
+      RelocateRange(begin() + index, end(), begin() + index + count);
+    } else {
+      VectorBuffer new_buffer(NewCapacity(size_ + count));
+      VectorBuffer::MoveRange(begin(), begin() + index, new_buffer.begin());
+      VectorBuffer::MoveRange(begin() + index, end(),
+                              new_buffer.begin() + index + count);
+      heap_ = std::move(new_buffer);
+    }
+    size_ += count;
+    return begin() + index;
+  }
+
+  // Takes the elements of |other|, which becomes empty. This vector must be
+  // empty and inline.
+  void TakeElements(InlinedVector* other) {
+    if (other->is_inline()) {
+      VectorBuffer::MoveRange(other->inline_data(),
+                              other->inline_data() + other->size_,
+                              inline_data());
+    } else {
+      heap_ = std::move(other->heap_);
+    }
+    size_ = other->size_;
+    other->size_ = 0;
+  }
+
+  // The heap buffer, which has no capacity while the elements are inline.
+  VectorBuffer heap_;
+  size_type size_ = 0;
+  std::aligned_storage_t<sizeof(T), alignof(T)> inline_[N];
+};
+
+template <typename T, size_t N>
+bool operator==(const InlinedVector<T, N>& lhs,
+                const InlinedVector<T, N>& rhs) {
+  return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <typename T, size_t N>
+bool operator!=(const InlinedVector<T, N>& lhs,
+                const InlinedVector<T, N>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T, size_t N>
+bool operator<(const InlinedVector<T, N>& lhs,
+               const InlinedVector<T, N>& rhs) {
+  return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(),
+                                      rhs.end());
+}
+
+template <typename T, size_t N>
+bool operator>(const InlinedVector<T, N>& lhs,
+               const InlinedVector<T, N>& rhs) {
+  return rhs < lhs;
+}
+
+template <typename T, size_t N>
+bool operator<=(const InlinedVector<T, N>& lhs,
+                const InlinedVector<T, N>& rhs) {
+  return !(lhs > rhs);
+}
+
+template <typename T, size_t N>
+bool operator>=(const InlinedVector<T, N>& lhs,
+                const InlinedVector<T, N>& rhs) {
+  return !(lhs < rhs);
+}
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_INLINED_VECTOR_H_
\ No newline at end of file
@@ -0,0 +1,323 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_INTRUSIVE_HASH_SET_H_
+#define WINLIB_WINBASE_CONTAINERS_INTRUSIVE_HASH_SET_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+template <typename T, typename KeyOf, typename Hash, typename KeyEqual>
+class IntrusiveHashSet;
+
+// The links of a value in an IntrusiveHashSet. Like LinkNode, it is meant to
+// be a base class of the value type:
+//
+//   class Session : public IntrusiveHashNode<Session> {
+//    public:
+//     const std::string& id() const { return id_; }
+//     ...
+//   };
+template <typename T>
+class IntrusiveHashNode {
+ public:
+  IntrusiveHashNode() = default;
+  IntrusiveHashNode(const IntrusiveHashNode&) = delete;
+  IntrusiveHashNode& operator=(const IntrusiveHashNode&) = delete;
+
+  // A value must be removed from its set before it is destroyed.
+  ~IntrusiveHashNode() { WINBASE_DCHECK(!IsInSet()); }
+
+  bool IsInSet() const { return pprev_ != nullptr; }
+
+  const T* value() const { return static_cast<const T*>(this); }
+  T* value() { return static_cast<T*>(this); }
+
+ private:
+  template <typename, typename, typename, typename>
+  friend class IntrusiveHashSet;
+
+  // The next node of the bucket, and the pointer to this node: the head of
+  // the bucket or the |next_| of the previous node. Keeping the latter lets
+  // a node unlink itself without walking the bucket.
+  IntrusiveHashNode* next_ = nullptr;
+  IntrusiveHashNode** pprev_ = nullptr;
+
+  // The hash of the key, kept to skip most comparisons of keys and to rehash
+  // without calling the hasher.
+  size_t hash_ = 0;
+};
+
+namespace internal {
+
+template <typename T, typename KeyOf>
+using IntrusiveHashKey =
+    std::decay_t<decltype(std::declval<KeyOf>()(std::declval<const T&>()))>;
+
+}  // namespace internal
+
+// IntrusiveHashSet indexes values that derive from IntrusiveHashNode by a key
+// that |KeyOf| reads from them. The set does not own the values, and the
+// links live in the values themselves, so inserting a value never allocates
+// (except to grow the bucket array) and a value can be removed in constant
+// time given a pointer to it, without looking up its key. It suits objects
+// such as sessions or watchers that are both found by ID and removed by
+// themselves, e.g. from their destructor.
+//
+// The buckets are chained, and their number is a power of two that at least
+// matches the number of values. A value can be in only one set at a time.
+//
+// Example:
+//   struct SessionId {
+//     const std::string& operator()(const Session& session) const {
+//       return session.id();
+//     }
+//   };
+//   winbase::IntrusiveHashSet<Session, SessionId> sessions;
+//   sessions.Insert(session);
+//   ...
+//   Session* session = sessions.Find(StringPiece(id));
+//   ...
+//   sessions.Remove(session);
+template <typename T,
+          typename KeyOf,
+          typename Hash = FlatHash<internal::IntrusiveHashKey<T, KeyOf>>,
+          typename KeyEqual = std::equal_to<>>
+class IntrusiveHashSet {
+ private:
+  using Node = IntrusiveHashNode<T>;
+
+  template <bool is_const>
+  class Iterator;
+
+ public:
+  using key_type = internal::IntrusiveHashKey<T, KeyOf>;
+  using value_type = T;
+  using size_type = size_t;
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  IntrusiveHashSet() = default;
+  IntrusiveHashSet(const IntrusiveHashSet&) = delete;
+  IntrusiveHashSet& operator=(const IntrusiveHashSet&) = delete;
+
+  // A moved-from set is empty.
+  IntrusiveHashSet(IntrusiveHashSet&& other) noexcept
+      : buckets_(std::move(other.buckets_)),
+        size_(std::exchange(other.size_, 0)) {
+    other.buckets_.clear();
+  }
+
+  IntrusiveHashSet& operator=(IntrusiveHashSet&& other) noexcept {
+    Clear();
+    buckets_ = std::move(other.buckets_);
+    other.buckets_.clear();
+    size_ = std::exchange(other.size_, 0);
+    return *this;
+  }
+
+  // Removes the values that are still in the set.
+  ~IntrusiveHashSet() { Clear(); }
+
+  // Inserts |value|, which must not be in a set. Returns false, and leaves
+  // |value| out of the set, if a value with the same key is already in.
+  bool Insert(T* value) {
+    Node* node = value;
+    WINBASE_DCHECK(!node->IsInSet());
+    const auto& key = KeyOf()(*value);
+    size_t hash = Hash()(key);
+    if (FindNode(key, hash))
+      return false;
+    if (size_ >= buckets_.size())
+      Rehash(buckets_.empty() ? kMinBuckets : buckets_.size() * 2);
+    node->hash_ = hash;
+    Link(node);
+    ++size_;
+    return true;
+  }
+
+  // Returns the value with |key|, or null.
+  template <typename K>
+  T* Find(const K& key) const {
+    if (!size_)
+      return nullptr;
+    Node* node = FindNode(key, Hash()(key));
+    return node ? node->value() : nullptr;
+  }
+
+  template <typename K>
+  bool Contains(const K& key) const {
+    return Find(key) != nullptr;
+  }
+
+  // Removes |value|, which must be in this set, in constant time.
+  void Remove(T* value) {
+    Node* node = value;
+    WINBASE_DCHECK(node->IsInSet());
+    WINBASE_DCHECK_EQ(Find(KeyOf()(*value)), value);
+    Unlink(node);
+    --size_;
+  }
+
+  // Removes the value with |key| and returns it, or returns null.
+  template <typename K>
+  T* Erase(const K& key) {
+    T* value = Find(key);
+    if (value) {
+      Unlink(value);
+      --size_;
+    }
+    return value;
+  }
+
+  // Removes every value. The bucket array is kept.
+  void Clear() {
+    for (Node*& head : buckets_) {
+      while (Node* node = head)
+        Unlink(node);
+    }
+    size_ = 0;
+  }
+
+  size_type size() const { return size_; }
+  bool empty() const { return !size_; }
+  size_t bucket_count() const { return buckets_.size(); }
+
+  // Iterators are invalidated by Insert(), and by removing the value they
+  // point to. The order is that of the buckets.
+  iterator begin() { return iterator(this, 0); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator cbegin() const { return begin(); }
+  iterator end() { return iterator(); }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cend() const { return end(); }
+
+ private:
+  template <bool is_const>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+    using pointer = std::conditional_t<is_const, const T*, T*>;
+    using reference = std::conditional_t<is_const, const T&, T&>;
+
+    Iterator() = default;
+
+    // An iterator converts to a const_iterator.
+    template <bool other_is_const,
+              typename = std::enable_if_t<is_const && !other_is_const>>
+    Iterator(const Iterator<other_is_const>& other)
+        : set_(other.set_), bucket_(other.bucket_), node_(other.node_) {}
+
+    reference operator*() const { return *node_->value(); }
+    pointer operator->() const { return node_->value(); }
+
+    Iterator& operator++() {
+      node_ = node_->next_;
+      if (!node_) {
+        ++bucket_;
+        SkipEmptyBuckets();
+      }
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator it = *this;
+      ++*this;
+      return it;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.node_ == rhs.node_;
+    }
+
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    friend class IntrusiveHashSet;
+    friend class Iterator<!is_const>;
+
+    Iterator(const IntrusiveHashSet* set, size_t bucket)
+        : set_(set), bucket_(bucket) {
+      SkipEmptyBuckets();
+    }
+
+    void SkipEmptyBuckets() {
+      const std::vector<Node*>& buckets = set_->buckets_;
+      while (bucket_ < buckets.size() && !buckets[bucket_])
+        ++bucket_;
+      node_ = bucket_ < buckets.size() ? buckets[bucket_] : nullptr;
+    }
+
+    const IntrusiveHashSet* set_ = nullptr;
+    size_t bucket_ = 0;
+    Node* node_ = nullptr;
+  };
+
+  static constexpr size_t kMinBuckets = 8;
+
+  template <typename K>
+  Node* FindNode(const K& key, size_t hash) const {
+    if (buckets_.empty())
+      return nullptr;
+    for (Node* node = buckets_[hash & (buckets_.size() - 1)]; node;
+         node = node->next_) {
+      if (node->hash_ == hash && KeyEqual()(KeyOf()(*node->value()), key))
+        return node;
+    }
+    return nullptr;
+  }
+
+  // Pushes |node| on the front of its bucket.
+  void Link(Node* node) {
+    Node** head = &buckets_[node->hash_ & (buckets_.size() - 1)];
+    node->next_ = *head;
+    if (node->next_)
+      node->next_->pprev_ = &node->next_;
+    node->pprev_ = head;
+    *head = node;
+  }
+
+  static void Unlink(Node* node) {
+    *node->pprev_ = node->next_;
+    if (node->next_)
+      node->next_->pprev_ = node->pprev_;
+    node->next_ = nullptr;
+    node->pprev_ = nullptr;
+  }
+
+  void Rehash(size_t bucket_count) {
+    std::vector<Node*> old_buckets(bucket_count, nullptr);
+    buckets_.swap(old_buckets);
+    for (Node* node : old_buckets) {
+      while (node) {
+        Node* next = node->next_;
+        Link(node);
+        node = next;
+      }
+    }
+  }
+
+  // The head of each chain. Nodes point into this array, so it is only
+  // replaced by Rehash(), which relinks every node.
+  std::vector<Node*> buckets_;
+  size_t size_ = 0;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_INTRUSIVE_HASH_SET_H_
\ No newline at end of file
@@ -0,0 +1,445 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_MRU_CACHE_H_
+#define WINLIB_WINBASE_CONTAINERS_MRU_CACHE_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+#include "winbase\containers\flat_hash_map.h"
+#include "winbase\functional\callback.h"
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+
+// This file contains a template for a Most Recently Used cache that allows
+// constant-time access to items, but easy identification of the
+// least-recently-used items for removal. Variations exist to support use as a
+// Map (MRUCache) or HashMap (HashingMRUCache).
+//
+// Each entry is one allocation that holds the key and payload together with
+// the links of the recency list, and the map only points at it; there is no
+// separate std::list node to keep in sync. For a cache shared between
+// threads, see sharded_mru_cache.h.
+//
+// The cache evicts the least recently used entries once it holds more than
+// |max_size| entries or once their costs add up to more than |max_cost|. The
+// cost of an entry is given to Put() and defaults to one, so |max_cost| can
+// be a byte budget when entries are put with their size in bytes.
+//
+// Example:
+//   winbase::HashingMRUCache<std::string, std::string> cache(
+//       winbase::HashingMRUCache<std::string, std::string>::NO_AUTO_EVICT,
+//       16 * 1024 * 1024);
+//   cache.Put(url, body, body.size());
+//   auto it = cache.Get(url);
+//   if (it != cache.end())
+//     Use(it->second);
+
+namespace winbase {
+namespace internal {
+
+// The recency list is circular, through a sentinel link owned by the cache.
+struct MRUCacheLink {
+  MRUCacheLink* prev;
+  MRUCacheLink* next;
+};
+
+template <class KeyType, class PayloadType>
+struct MRUCacheNode : MRUCacheLink {
+  template <class Payload>
+  MRUCacheNode(const KeyType& key, Payload&& payload, size_t cost)
+      : value(key, std::forward<Payload>(payload)), cost(cost) {}
+
+  std::pair<KeyType, PayloadType> value;
+  size_t cost;
+};
+
+// MRUCacheBase ---------------------------------------------------------------
+
+// This template is used to standardize map type containers that can be used
+// by MRUCacheBase. The map goes from a key to the node holding its entry.
+template <class KeyType, class PayloadType, class MapType>
+class MRUCacheBase {
+ private:
+  using Link = MRUCacheLink;
+  using Node = MRUCacheNode<KeyType, PayloadType>;
+
+  template <bool is_const>
+  class Iterator;
+
+ public:
+  using key_type = KeyType;
+  using payload_type = PayloadType;
+  using value_type = std::pair<KeyType, PayloadType>;
+  using size_type = size_t;
+
+  // Iterators go from the most to the least recently used entry.
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  // Runs for every entry evicted to keep the cache within its budget, with
+  // the payload moved out of the entry. It must not modify the cache.
+  using EvictionCallback =
+      RepeatingCallback<void(const KeyType& key, PayloadType payload)>;
+
+  // Passed as |max_size| so that the number of entries is not limited.
+  enum { NO_AUTO_EVICT = 0 };
+
+  // The default |max_cost|, which does not limit the costs.
+  static constexpr size_t kNoCostLimit = std::numeric_limits<size_t>::max();
+
+  explicit MRUCacheBase(size_type max_size, size_t max_cost = kNoCostLimit)
+      : max_size_(max_size), max_cost_(max_cost) {
+    list_.prev = list_.next = &list_;
+  }
+
+  MRUCacheBase(const MRUCacheBase&) = delete;
+  MRUCacheBase& operator=(const MRUCacheBase&) = delete;
+
+  virtual ~MRUCacheBase() { Clear(); }
+
+  size_type max_size() const { return max_size_; }
+  size_t max_cost() const { return max_cost_; }
+
+  // The sum of the costs of the entries.
+  size_t total_cost() const { return total_cost_; }
+
+  void SetEvictionCallback(EvictionCallback callback) {
+    eviction_callback_ = std::move(callback);
+  }
+
+  // Inserts a payload item with the given key, with a cost counting against
+  // |max_cost|. If an existing item has the same key, it is replaced. Other
+  // entries are evicted as needed, but the new one is kept even if its cost
+  // alone is above |max_cost|. Returns an iterator to the new entry.
+  //
+  // The payload will be forwarded.
+  template <typename Payload>
+  iterator Put(const KeyType& key, Payload&& payload, size_t cost = 1) {
+    auto result = index_.try_emplace(key, nullptr);
+    Node* node = result.first->second;
+    if (result.second) {
+      node = new Node(key, std::forward<Payload>(payload), cost);
+      result.first->second = node;
+      ++size_;
+    } else {
+      node->value.second = std::forward<Payload>(payload);
+      total_cost_ -= node->cost;
+      node->cost = cost;
+      Unlink(node);
+    }
+    total_cost_ += cost;
+    LinkAtFront(node);
+    Evict(node);
+    return iterator(node);
+  }
+
+  // Retrieves the contents of the given key, or end() if not found. This
+  // method has the side effect of moving the requested item to the front of
+  // the recency list.
+  template <typename K>
+  iterator Get(const K& key) {
+    auto found = index_.find(key);
+    if (found == index_.end())
+      return end();
+    Node* node = found->second;
+    Unlink(node);
+    LinkAtFront(node);
+    return iterator(node);
+  }
+
+  // Retrieves the contents of the given key, or end() if not found, without
+  // affecting the ordering (unlike Get).
+  template <typename K>
+  iterator Peek(const K& key) {
+    auto found = index_.find(key);
+    return found == index_.end() ? end() : iterator(found->second);
+  }
+
+  template <typename K>
+  const_iterator Peek(const K& key) const {
+    auto found = index_.find(key);
+    return found == index_.end() ? end() : const_iterator(found->second);
+  }
+
+  // Exchanges the contents of |this| by the contents of the |other|.
+  void Swap(MRUCacheBase& other) {
+    std::swap(index_, other.index_);
+    std::swap(size_, other.size_);
+    std::swap(max_size_, other.max_size_);
+    std::swap(total_cost_, other.total_cost_);
+    std::swap(max_cost_, other.max_cost_);
+    std::swap(eviction_callback_, other.eviction_callback_);
+    std::swap(list_, other.list_);
+    FixSentinel(&list_, &other.list_);
+    FixSentinel(&other.list_, &list_);
+  }
+
+  // Erases the item referenced by the given iterator. An iterator to the item
+  // following it will be returned. The iterator must be valid. The eviction
+  // callback is not run.
+  iterator Erase(const_iterator pos) {
+    WINBASE_DCHECK(pos.link_ != &list_);
+    Node* node = static_cast<Node*>(pos.link_);
+    iterator next(node->next);
+    Remove(node);
+    delete node;
+    return next;
+  }
+
+  // MRUCache entries are often processed in reverse order, so we add this
+  // convenience function (not typically defined by STL containers).
+  reverse_iterator Erase(reverse_iterator pos) {
+    // We have to actually give it the incremented iterator to delete, since
+    // the forward iterator that base() returns is actually one past the item
+    // being iterated over.
+    return reverse_iterator(Erase((++pos).base()));
+  }
+
+  // Shrinks the cache so it only holds |new_size| items, evicting the least
+  // recently used ones. The eviction callback runs for each of them.
+  void ShrinkToSize(size_type new_size) {
+    while (size_ > new_size)
+      EvictLast();
+  }
+
+  // Deletes everything from the cache without running the eviction callback.
+  void Clear() {
+    for (Link* link = list_.next; link != &list_;) {
+      Node* node = static_cast<Node*>(link);
+      link = link->next;
+      delete node;
+    }
+    list_.prev = list_.next = &list_;
+    index_.clear();
+    size_ = 0;
+    total_cost_ = 0;
+  }
+
+  // Returns the number of elements in the cache.
+  size_type size() const { return size_; }
+
+  bool empty() const { return !size_; }
+
+  // Iterators go from the most recently used entry to the least recently
+  // used one. Reverse iterators go the other way, so rbegin() is the entry
+  // that the next eviction removes.
+  iterator begin() { return iterator(list_.next); }
+  const_iterator begin() const { return const_iterator(list_.next); }
+  iterator end() { return iterator(&list_); }
+  const_iterator end() const {
+    return const_iterator(const_cast<Link*>(&list_));
+  }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+ private:
+  template <bool is_const>
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename MRUCacheBase::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer =
+        std::conditional_t<is_const, const value_type*, value_type*>;
+    using reference =
+        std::conditional_t<is_const, const value_type&, value_type&>;
+
+    Iterator() = default;
+
+    // An iterator converts to a const_iterator.
+    template <bool other_is_const,
+              typename = std::enable_if_t<is_const && !other_is_const>>
+    Iterator(const Iterator<other_is_const>& other) : link_(other.link_) {}
+
+    reference operator*() const { return static_cast<Node*>(link_)->value; }
+    pointer operator->() const { return &static_cast<Node*>(link_)->value; }
+
+    Iterator& operator++() {
+      link_ = link_->next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator result = *this;
+      ++*this;
+      return result;
+    }
+    Iterator& operator--() {
+      link_ = link_->prev;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.link_ == rhs.link_;
+    }
+    friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+      return lhs.link_ != rhs.link_;
+    }
+
+   private:
+    friend class MRUCacheBase;
+    friend class Iterator<!is_const>;
+
+    explicit Iterator(Link* link) : link_(link) {}
+
+    Link* link_ = nullptr;
+  };
+
+  void LinkAtFront(Link* link) {
+    link->prev = &list_;
+    link->next = list_.next;
+    list_.next->prev = link;
+    list_.next = link;
+  }
+
+  static void Unlink(Link* link) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+  }
+
+  // Points the neighbours of a sentinel copied from |old_sentinel| at
+  // |sentinel|.
+  static void FixSentinel(Link* sentinel, Link* old_sentinel) {
+    if (sentinel->next == old_sentinel) {
+      sentinel->prev = sentinel->next = sentinel;
+      return;
+    }
+    sentinel->next->prev = sentinel;
+    sentinel->prev->next = sentinel;
+  }
+
+  bool IsOverBudget() const {
+    return (max_size_ != NO_AUTO_EVICT && size_ > max_size_) ||
+           total_cost_ > max_cost_;
+  }
+
+  // Evicts the least recently used entries, but not |keep|, until the cache
+  // is within its budget.
+  void Evict(const Link* keep) {
+    while (IsOverBudget() && list_.prev != keep)
+      EvictLast();
+  }
+
+  // Takes |node| out of the list and the map.
+  void Remove(Node* node) {
+    Unlink(node);
+    index_.erase(node->value.first);
+    --size_;
+    total_cost_ -= node->cost;
+  }
+
+  void EvictLast() {
+    WINBASE_DCHECK(size_);
+    Node* node = static_cast<Node*>(list_.prev);
+    Remove(node);
+    if (eviction_callback_)
+      eviction_callback_.Run(node->value.first, std::move(node->value.second));
+    delete node;
+  }
+
+  MapType index_;
+  Link list_;
+  size_type size_ = 0;
+  size_type max_size_;
+  size_t total_cost_ = 0;
+  size_t max_cost_;
+  EvictionCallback eviction_callback_;
+};
+
+template <class KeyType, class PayloadType, class MapType>
+constexpr size_t MRUCacheBase<KeyType, PayloadType, MapType>::kNoCostLimit;
+
+}  // namespace internal
+
+// MRUCache --------------------------------------------------------------------
+
+// A container that does not do anything to free its data. Use this when
+// storing value types (as opposed to pointers) in the list. Lookups take
+// O(log(size)); prefer HashingMRUCache unless the keys cannot be hashed.
+template <class KeyType, class PayloadType, class CompareType = std::less<>>
+class MRUCache : public internal::MRUCacheBase<
+                     KeyType,
+                     PayloadType,
+                     std::map<KeyType,
+                              internal::MRUCacheNode<KeyType, PayloadType>*,
+                              CompareType>> {
+ private:
+  using ParentType = internal::MRUCacheBase<
+      KeyType,
+      PayloadType,
+      std::map<KeyType,
+               internal::MRUCacheNode<KeyType, PayloadType>*,
+               CompareType>>;
+
+ public:
+  // See MRUCacheBase, noting the possibility of using NO_AUTO_EVICT.
+  explicit MRUCache(typename ParentType::size_type max_size,
+                    size_t max_cost = ParentType::kNoCostLimit)
+      : ParentType(max_size, max_cost) {}
+  ~MRUCache() override = default;
+
+  MRUCache(const MRUCache&) = delete;
+  MRUCache& operator=(const MRUCache&) = delete;
+};
+
+// HashingMRUCache ------------------------------------------------------------
+
+// A container that uses a flat_hash_map as the map type instead of std::map,
+// so that Get(), Put() and Erase() take O(1).
+template <class KeyType,
+          class PayloadType,
+          class HashType = FlatHash<KeyType>,
+          class KeyEqual = std::equal_to<>>
+class HashingMRUCache
+    : public internal::MRUCacheBase<
+          KeyType,
+          PayloadType,
+          flat_hash_map<KeyType,
+                        internal::MRUCacheNode<KeyType, PayloadType>*,
+                        HashType,
+                        KeyEqual>> {
+ private:
+  using ParentType = internal::MRUCacheBase<
+      KeyType,
+      PayloadType,
+      flat_hash_map<KeyType,
+                    internal::MRUCacheNode<KeyType, PayloadType>*,
+                    HashType,
+                    KeyEqual>>;
+
+ public:
+  // See MRUCacheBase, noting the possibility of using NO_AUTO_EVICT.
+  explicit HashingMRUCache(typename ParentType::size_type max_size,
+                           size_t max_cost = ParentType::kNoCostLimit)
+      : ParentType(max_size, max_cost) {}
+  ~HashingMRUCache() override = default;
+
+  HashingMRUCache(const HashingMRUCache&) = delete;
+  HashingMRUCache& operator=(const HashingMRUCache&) = delete;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_MRU_CACHE_H_
\ No newline at end of file
@@ -0,0 +1,287 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\containers\packed_int_array.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "winbase\bits.h"
+#include "winbase\pickle.h"
+#include "winlib\build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
+
+namespace winbase {
+
+namespace {
+
+// Changes whenever the layout of the values changes.
+constexpr uint32_t kPickleVersion = 1;
+
+#if defined(ARCH_CPU_X86_FAMILY)
+
+// The values decoded by one call to UnpackBlock(): one run of 32 per lane.
+constexpr size_t kBlockSize = 128;
+
+// Transposes the 4x4 matrix of 32-bit values whose rows are |r0| to |r3|.
+inline void Transpose(__m128i* r0, __m128i* r1, __m128i* r2, __m128i* r3) {
+  __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+  __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+  __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+  __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+  *r0 = _mm_unpacklo_epi64(t0, t1);
+  *r1 = _mm_unpackhi_epi64(t0, t1);
+  *r2 = _mm_unpacklo_epi64(t2, t3);
+  *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+inline void Store(__m128i values, uint32_t* out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), values);
+}
+
+inline void Store(__m128i values, uint64_t* out) {
+  __m128i zero = _mm_setzero_si128();
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                   _mm_unpacklo_epi32(values, zero));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2),
+                   _mm_unpackhi_epi32(values, zero));
+}
+
+inline __m128i Load(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline int Load32(const char* data) {
+  int value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Unpacks the 128 values of |bit_width| bits, from 1 to 32, that start at
+// |data|. Lane k of the vectors decodes the values 32 * k to 32 * k + 31,
+// which start at the 32-bit word k * |bit_width|: all the lanes find their
+// values at the same word and shift, so that the words can be loaded a row
+// of four at a time and transposed.
+template <typename T>
+void UnpackBlock(const char* data, int bit_width, T* out) {
+  const char* lanes[4];
+  for (int k = 0; k < 4; ++k)
+    lanes[k] = data + k * bit_width * sizeof(uint32_t);
+
+  // words[i] holds the ith 32-bit word of each lane.
+  __m128i words[32];
+  int i = 0;
+  for (; i + 4 <= bit_width; i += 4) {
+    size_t offset = i * sizeof(uint32_t);
+    words[i] = Load(lanes[0] + offset);
+    words[i + 1] = Load(lanes[1] + offset);
+    words[i + 2] = Load(lanes[2] + offset);
+    words[i + 3] = Load(lanes[3] + offset);
+    Transpose(&words[i], &words[i + 1], &words[i + 2], &words[i + 3]);
+  }
+  for (; i < bit_width; ++i) {
+    size_t offset = i * sizeof(uint32_t);
+    words[i] = _mm_set_epi32(Load32(lanes[3] + offset),
+                             Load32(lanes[2] + offset),
+                             Load32(lanes[1] + offset),
+                             Load32(lanes[0] + offset));
+  }
+
+  const __m128i mask = _mm_set1_epi32(
+      bit_width == 32 ? -1 : static_cast<int>((1u << bit_width) - 1));
+  int bit = 0;
+  for (int j = 0; j < 32; j += 4) {
+    __m128i values[4];
+    for (int n = 0; n < 4; ++n, bit += bit_width) {
+      int word = bit / 32;
+      int shift = bit % 32;
+      __m128i value = _mm_srl_epi32(words[word], _mm_cvtsi32_si128(shift));
+      if (shift + bit_width > 32) {
+        __m128i high =
+            _mm_sll_epi32(words[word + 1], _mm_cvtsi32_si128(32 - shift));
+        value = _mm_or_si128(value, high);
+      }
+      values[n] = _mm_and_si128(value, mask);
+    }
+    // Row n holds value j + n of each lane; make row k the values of lane k.
+    Transpose(&values[0], &values[1], &values[2], &values[3]);
+    for (int k = 0; k < 4; ++k)
+      Store(values[k], out + 32 * k + j);
+  }
+}
+
+#endif  // defined(ARCH_CPU_X86_FAMILY)
+
+}  // namespace
+
+PackedIntArray::PackedIntArray() = default;
+
+PackedIntArray::PackedIntArray(size_t size, int bit_width) {
+  Init(size, bit_width);
+}
+
+PackedIntArray::PackedIntArray(PackedIntArray&& other) noexcept {
+  *this = std::move(other);
+}
+
+PackedIntArray& PackedIntArray::operator=(PackedIntArray&& other) noexcept {
+  size_ = other.size_;
+  bit_width_ = other.bit_width_;
+  mask_ = other.mask_;
+  mapped_ = other.mapped_;
+  owned_words_ = std::move(other.owned_words_);
+  words_ = mapped_ ? other.words_
+                   : reinterpret_cast<const char*>(owned_words_.data());
+  other.Init(0, 0);
+  return *this;
+}
+
+PackedIntArray::~PackedIntArray() = default;
+
+// static
+int PackedIntArray::BitWidthFor(uint64_t max_value) {
+  // The 64-bit bit scan is only available on 64-bit targets.
+  uint32_t high = static_cast<uint32_t>(max_value >> 32);
+  if (high)
+    return 64 - static_cast<int>(bits::CountLeadingZeroBits(high));
+  uint32_t low = static_cast<uint32_t>(max_value);
+  return 32 - static_cast<int>(bits::CountLeadingZeroBits(low));
+}
+
+void PackedIntArray::Set(size_t index, uint64_t value) {
+  WINBASE_DCHECK(!mapped_);
+  WINBASE_DCHECK(index < size_);
+  WINBASE_DCHECK_EQ(value & ~mask_, 0u);
+  if (!bit_width_)
+    return;
+  size_t bit = index * bit_width_;
+  size_t word = bit / 64;
+  unsigned offset = bit % 64;
+  owned_words_[word] =
+      (owned_words_[word] & ~(mask_ << offset)) | (value << offset);
+  if (offset + bit_width_ > 64) {
+    unsigned shift = 64 - offset;
+    owned_words_[word + 1] =
+        (owned_words_[word + 1] & ~(mask_ >> shift)) | (value >> shift);
+  }
+}
+
+void PackedIntArray::PushBack(uint64_t value) {
+  WINBASE_DCHECK(!mapped_);
+  size_t num_words = NumWords(size_ + 1, bit_width_);
+  if (num_words > owned_words_.size()) {
+    owned_words_.resize(num_words);
+    words_ = reinterpret_cast<const char*>(owned_words_.data());
+  }
+  ++size_;
+  Set(size_ - 1, value);
+}
+
+void PackedIntArray::Unpack(size_t first, size_t count, uint32_t* out) const {
+  WINBASE_DCHECK_LE(bit_width_, 32);
+  UnpackTo(first, count, out);
+}
+
+void PackedIntArray::Unpack(size_t first, size_t count, uint64_t* out) const {
+  UnpackTo(first, count, out);
+}
+
+template <typename T>
+void PackedIntArray::UnpackTo(size_t first, size_t count, T* out) const {
+  WINBASE_DCHECK_LE(first, size_);
+  WINBASE_DCHECK_LE(count, size_ - first);
+  if (!bit_width_) {
+    std::fill(out, out + count, 0);
+    return;
+  }
+
+  size_t i = 0;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (bit_width_ <= 32) {
+    // A block must start on a 32-bit word, so at a multiple of 32 values.
+    size_t head = std::min(count, (32 - first % 32) % 32);
+    for (; i < head; ++i)
+      out[i] = static_cast<T>(Get(first + i));
+    for (; i + kBlockSize <= count; i += kBlockSize) {
+      UnpackBlock(words_ + (first + i) * bit_width_ / 8, bit_width_,
+                  out + i);
+    }
+  }
+#endif
+  for (; i < count; ++i)
+    out[i] = static_cast<T>(Get(first + i));
+}
+
+void PackedIntArray::WriteToPickle(Pickle* pickle) const {
+  WINBASE_CHECK(size_in_bytes() <=
+                static_cast<size_t>(std::numeric_limits<int>::max()));
+  pickle->WriteUInt32(kPickleVersion);
+  pickle->WriteUInt64(size_);
+  pickle->WriteInt(bit_width_);
+  pickle->WriteData(words_, static_cast<int>(size_in_bytes()));
+}
+
+bool PackedIntArray::ReadFromPickle(PickleIterator* iter) {
+  size_t size;
+  int bit_width;
+  const char* words;
+  if (!ReadPickle(iter, &size, &bit_width, &words))
+    return false;
+  Init(size, bit_width);
+  if (!owned_words_.empty())
+    memcpy(owned_words_.data(), words, size_in_bytes());
+  return true;
+}
+
+bool PackedIntArray::MapFromPickle(PickleIterator* iter) {
+  size_t size;
+  int bit_width;
+  const char* words;
+  if (!ReadPickle(iter, &size, &bit_width, &words))
+    return false;
+  Init(0, bit_width);
+  size_ = size;
+  mapped_ = true;
+  words_ = words;
+  return true;
+}
+
+bool PackedIntArray::ReadPickle(PickleIterator* iter,
+                                size_t* size,
+                                int* bit_width,
+                                const char** words) const {
+  uint32_t version;
+  uint64_t count;
+  int width;
+  int length;
+  if (!iter->ReadUInt32(&version) || version != kPickleVersion ||
+      !iter->ReadUInt64(&count) || !iter->ReadInt(&width) || width < 0 ||
+      width > 64 || !iter->ReadData(words, &length)) {
+    return false;
+  }
+  // The length is below 2 GiB, so a valid |count| * |width| cannot overflow.
+  if (width && count > static_cast<uint64_t>(length) * 8 / width)
+    return false;
+  if (!width && count > std::numeric_limits<size_t>::max())
+    return false;
+  *size = static_cast<size_t>(count);
+  *bit_width = width;
+  return static_cast<size_t>(length) == NumWords(*size, width) * 8;
+}
+
+void PackedIntArray::Init(size_t size, int bit_width) {
+  WINBASE_DCHECK(bit_width >= 0 && bit_width <= 64);
+  size_ = size;
+  bit_width_ = bit_width;
+  mask_ = bit_width == 64 ? ~uint64_t(0) : (uint64_t(1) << bit_width) - 1;
+  mapped_ = false;
+  owned_words_.assign(NumWords(size, bit_width), 0);
+  words_ = reinterpret_cast<const char*>(owned_words_.data());
+}
+
+}  // namespace winbase
\ No newline at end of file
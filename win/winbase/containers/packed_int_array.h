@@ -0,0 +1,142 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_PACKED_INT_ARRAY_H_
+#define WINLIB_WINBASE_CONTAINERS_PACKED_INT_ARRAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+class Pickle;
+class PickleIterator;
+
+// PackedIntArray stores unsigned integers of |bit_width| bits each, from 0 to
+// 64, back to back with no padding: value i takes bits [i * bit_width,
+// (i + 1) * bit_width) of a stream of little-endian 64-bit words. An array of
+// a million values below 1000 takes 1.25 MB instead of 4 or 8.
+//
+// Get() reads one value in constant time. Unpack() reads a run of values,
+// and for widths up to 32 bits on x86 decodes them 128 at a time with SSE2:
+// each lane decodes a run of 32 values, and as each run starts on a 32-bit
+// word, the four lanes find their values at the same shifts.
+//
+// Like BitVector, the array can be written to a Pickle and mapped back from
+// the pickle buffer, for instance a MemoryMappedFile through a PickleView,
+// without copying or parsing anything.
+//
+// Example:
+//   winbase::PackedIntArray lengths(
+//       0, winbase::PackedIntArray::BitWidthFor(max_length));
+//   for (uint32_t length : all_lengths)
+//     lengths.PushBack(length);
+//   ...
+//   std::vector<uint32_t> batch(256);
+//   lengths.Unpack(first, batch.size(), batch.data());
+class WINBASE_EXPORT PackedIntArray {
+ public:
+  // Creates an empty array of 0-bit values.
+  PackedIntArray();
+
+  // Creates an array of |size| zeros of |bit_width| bits, at most 64.
+  PackedIntArray(size_t size, int bit_width);
+
+  PackedIntArray(const PackedIntArray&) = delete;
+  PackedIntArray& operator=(const PackedIntArray&) = delete;
+
+  // A moved-from array is empty.
+  PackedIntArray(PackedIntArray&& other) noexcept;
+  PackedIntArray& operator=(PackedIntArray&& other) noexcept;
+
+  ~PackedIntArray();
+
+  // Returns the number of bits needed to store |max_value|.
+  static int BitWidthFor(uint64_t max_value);
+
+  size_t size() const { return size_; }
+  bool empty() const { return !size_; }
+  int bit_width() const { return bit_width_; }
+
+  uint64_t Get(size_t index) const {
+    WINBASE_DCHECK(index < size_);
+    if (UNLIKELY(!bit_width_))
+      return 0;
+    size_t bit = index * bit_width_;
+    size_t word = bit / 64;
+    unsigned offset = bit % 64;
+    uint64_t value = Word(word) >> offset;
+    if (offset + bit_width_ > 64)
+      value |= Word(word + 1) << (64 - offset);
+    return value & mask_;
+  }
+  uint64_t operator[](size_t index) const { return Get(index); }
+
+  // These change the values, which must fit in bit_width() bits. A mapped
+  // array cannot be changed.
+  void Set(size_t index, uint64_t value);
+  void PushBack(uint64_t value);
+
+  // Copies the |count| values from |first| on to |out|. The first form needs
+  // a bit_width() of at most 32.
+  void Unpack(size_t first, size_t count, uint32_t* out) const;
+  void Unpack(size_t first, size_t count, uint64_t* out) const;
+
+  // The size of the packed values.
+  size_t size_in_bytes() const { return NumWords(size_, bit_width_) * 8; }
+
+  // Writes the array to |pickle|.
+  void WriteToPickle(Pickle* pickle) const;
+
+  // Reads an array written by WriteToPickle(), copying it. Returns false and
+  // leaves the array unchanged if the data is not valid.
+  bool ReadFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT;
+
+  // Like ReadFromPickle(), but the array reads the values from the buffer of
+  // the pickle, which must outlive it or be replaced first.
+  bool MapFromPickle(PickleIterator* iter) WARN_UNUSED_RESULT;
+
+ private:
+  static size_t NumWords(size_t size, int bit_width) {
+    return (size * bit_width + 63) / 64;
+  }
+
+  // Loads the |index|th word. Mapped data is only 4-byte aligned.
+  uint64_t Word(size_t index) const {
+    uint64_t word;
+    memcpy(&word, words_ + index * sizeof(word), sizeof(word));
+    return word;
+  }
+
+  template <typename T>
+  void UnpackTo(size_t first, size_t count, T* out) const;
+
+  bool ReadPickle(PickleIterator* iter,
+                  size_t* size,
+                  int* bit_width,
+                  const char** words) const;
+
+  void Init(size_t size, int bit_width);
+
+  size_t size_ = 0;
+  int bit_width_ = 0;
+  uint64_t mask_ = 0;
+  bool mapped_ = false;
+
+  std::vector<uint64_t> owned_words_;
+
+  // |owned_words_|, or the pickle buffer of a mapped array.
+  const char* words_ = nullptr;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_PACKED_INT_ARRAY_H_
\ No newline at end of file
@@ -0,0 +1,369 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_RING_BUFFER_H_
+#define WINLIB_WINBASE_CONTAINERS_RING_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+
+// Bounded lock-free ring buffers for handing items between threads.
+//
+// SpscRingBuffer<T> supports exactly one producer thread and one consumer
+// thread. Each side owns one index and publishes it with a release store; the
+// other side reads it with an acquire load and caches it, so the fast path
+// touches no cache line written by the other thread.
+//
+// MpmcRingBuffer<T> supports any number of producers and consumers. Every slot
+// carries a sequence number telling whether it is ready to be written or read
+// for a given lap of the ring (Dmitry Vyukov's bounded MPMC queue). Producers
+// and consumers only contend on their own index.
+//
+// Both buffers are bounded: the capacity is rounded up to a power of two and
+// fixed at construction. Push operations fail instead of blocking when the
+// buffer is full, and pop operations fail when it is empty.
+//
+// Both support batch operations that move |count| contiguous items with a
+// single index update:
+//   size_t TryPushBatch(T* items, size_t count);   // Moves from |items|.
+//   size_t TryPopBatch(T* items, size_t max_count);  // Move-assigns |items|.
+// They return the number of items actually transferred, which may be less
+// than requested.
+//
+// Example:
+//   winbase::SpscRingBuffer<Packet> buffer(1024);
+//
+//   // Producer thread.
+//   while (!buffer.TryPush(std::move(packet)))
+//     YieldProcessor();
+//
+//   // Consumer thread.
+//   Packet batch[64];
+//   size_t count = buffer.TryPopBatch(batch, array_size(batch));
+
+namespace winbase {
+
+namespace internal {
+
+inline size_t RingBufferCapacityFor(size_t min_capacity) {
+  size_t capacity = 2;
+  while (capacity < min_capacity)
+    capacity <<= 1;
+  return capacity;
+}
+
+}  // namespace internal
+
+template <typename T>
+class SpscRingBuffer {
+ public:
+  // Creates a buffer that can hold at least |min_capacity| items.
+  explicit SpscRingBuffer(size_t min_capacity)
+      : mask_(internal::RingBufferCapacityFor(min_capacity) - 1),
+        buffer_(new Storage[mask_ + 1]) {}
+
+  SpscRingBuffer(const SpscRingBuffer&) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+  // Must not race with either side.
+  ~SpscRingBuffer() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+      At(i)->~T();
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Approximate when called concurrently with either side.
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+
+  // Producer side ------------------------------------------------------------
+
+  template <typename... Args>
+  bool TryEmplace(Args&&... args) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - producer_cached_head_ > mask_) {
+      producer_cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - producer_cached_head_ > mask_)
+        return false;
+    }
+    new (At(tail)) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(const T& value) { return TryEmplace(value); }
+  bool TryPush(T&& value) { return TryEmplace(std::move(value)); }
+
+  size_t TryPushBatch(T* items, size_t count) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t free_slots = capacity() - (tail - producer_cached_head_);
+    if (free_slots < count) {
+      producer_cached_head_ = head_.load(std::memory_order_acquire);
+      free_slots = capacity() - (tail - producer_cached_head_);
+    }
+    if (count > free_slots)
+      count = free_slots;
+    for (size_t i = 0; i < count; ++i)
+      new (At(tail + i)) T(std::move(items[i]));
+    if (count)
+      tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side ------------------------------------------------------------
+
+  bool TryPop(T* out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == consumer_cached_tail_) {
+      consumer_cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == consumer_cached_tail_)
+        return false;
+    }
+    T* item = At(head);
+    *out = std::move(*item);
+    item->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t TryPopBatch(T* out, size_t max_count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t available = consumer_cached_tail_ - head;
+    if (available < max_count) {
+      consumer_cached_tail_ = tail_.load(std::memory_order_acquire);
+      available = consumer_cached_tail_ - head;
+    }
+    size_t count = available < max_count ? available : max_count;
+    for (size_t i = 0; i < count; ++i) {
+      T* item = At(head + i);
+      out[i] = std::move(*item);
+      item->~T();
+    }
+    if (count)
+      head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  T* At(size_t index) const {
+    return reinterpret_cast<T*>(&buffer_[index & mask_]);
+  }
+
+  // Read-mostly state shared by both sides.
+  const size_t mask_;
+  const std::unique_ptr<Storage[]> buffer_;
+
+  // Each side's state sits on its own cache line (64 bytes on every x86 CPU
+  // we support) so the producer and the consumer do not false-share.
+  //
+  // Consumer-owned line: the read index and the consumer's view of tail_.
+  ALIGNAS(64)
+  std::atomic<size_t> head_{0};
+  size_t consumer_cached_tail_ = 0;
+
+  // Producer-owned line: the write index and the producer's view of head_.
+  ALIGNAS(64)
+  std::atomic<size_t> tail_{0};
+  size_t producer_cached_head_ = 0;
+};
+
+template <typename T>
+class MpmcRingBuffer {
+ public:
+  // Creates a buffer that can hold at least |min_capacity| items.
+  explicit MpmcRingBuffer(size_t min_capacity)
+      : mask_(internal::RingBufferCapacityFor(min_capacity) - 1),
+        slots_(new Slot[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i)
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+  MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+
+  // Must not race with any producer or consumer.
+  ~MpmcRingBuffer() {
+    size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    for (size_t i = dequeue_pos_.load(std::memory_order_relaxed); i != tail;
+         ++i) {
+      slots_[i & mask_].value()->~T();
+    }
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Approximate when called concurrently with producers or consumers.
+  size_t size() const {
+    size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  bool empty() const { return size() == 0; }
+
+  template <typename... Args>
+  bool TryEmplace(Args&&... args) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot still holds the item of the previous lap: full.
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (slot->value()) T(std::forward<Args>(args)...);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool TryPush(const T& value) { return TryEmplace(value); }
+  bool TryPush(T&& value) { return TryEmplace(std::move(value)); }
+
+  bool TryPop(T* out) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot has not been written for this lap yet: empty.
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* item = slot->value();
+    *out = std::move(*item);
+    item->~T();
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Claims up to |count| consecutive free slots with a single CAS on the
+  // enqueue index, then fills and publishes them one by one. Consumers may
+  // start popping the first items before the last ones are written.
+  size_t TryPushBatch(T* items, size_t count) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t claimed;
+    for (;;) {
+      claimed = CountReady(pos, 0, count);
+      if (!claimed) {
+        // Either full, or another producer moved the index under us.
+        size_t current = enqueue_pos_.load(std::memory_order_relaxed);
+        if (current == pos)
+          return 0;
+        pos = current;
+        continue;
+      }
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + claimed,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < claimed; ++i) {
+      Slot& slot = slots_[(pos + i) & mask_];
+      new (slot.value()) T(std::move(items[i]));
+      slot.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return claimed;
+  }
+
+  // Claims up to |max_count| consecutive published items with a single CAS on
+  // the dequeue index, then moves them out and releases their slots.
+  size_t TryPopBatch(T* out, size_t max_count) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    size_t claimed;
+    for (;;) {
+      claimed = CountReady(pos, 1, max_count);
+      if (!claimed) {
+        size_t current = dequeue_pos_.load(std::memory_order_relaxed);
+        if (current == pos)
+          return 0;
+        pos = current;
+        continue;
+      }
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + claimed,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    for (size_t i = 0; i < claimed; ++i) {
+      Slot& slot = slots_[(pos + i) & mask_];
+      T* item = slot.value();
+      out[i] = std::move(*item);
+      item->~T();
+      slot.sequence.store(pos + i + mask_ + 1, std::memory_order_release);
+    }
+    return claimed;
+  }
+
+ private:
+  struct Slot {
+    T* value() { return reinterpret_cast<T*>(&storage); }
+
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  // Returns how many slots starting at |pos| have the sequence expected for
+  // the operation, up to |max_count|. |offset| is 0 for producers (slot free
+  // for this lap) and 1 for consumers (slot written for this lap).
+  size_t CountReady(size_t pos, size_t offset, size_t max_count) const {
+    if (max_count > capacity())
+      max_count = capacity();
+    size_t count = 0;
+    while (count < max_count &&
+           slots_[(pos + count) & mask_].sequence.load(
+               std::memory_order_acquire) == pos + count + offset) {
+      ++count;
+    }
+    return count;
+  }
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+
+  // Each index sits on its own cache line (64 bytes on every x86 CPU we
+  // support) so producers and consumers do not false-share.
+  ALIGNAS(64)
+  std::atomic<size_t> enqueue_pos_{0};
+
+  ALIGNAS(64)
+  std::atomic<size_t> dequeue_pos_{0};
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_RING_BUFFER_H_
\ No newline at end of file
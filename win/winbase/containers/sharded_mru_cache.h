@@ -0,0 +1,180 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_SHARDED_MRU_CACHE_H_
+#define WINLIB_WINBASE_CONTAINERS_SHARDED_MRU_CACHE_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "winbase\bits.h"
+#include "winbase\containers\mru_cache.h"
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+#include "winbase\synchronization\lock.h"
+
+namespace winbase {
+
+// ShardedMRUCache is a HashingMRUCache that can be used from any thread. The
+// keys are split by hash across a number of shards, each a HashingMRUCache
+// with its own Lock, so that threads working on different keys rarely wait
+// for each other. The budget is split evenly too, so each shard evicts its
+// own least recently used entries; the cache as a whole is only
+// approximately LRU.
+//
+// As entries can be evicted by another thread at any time, the interface
+// copies payloads in and out instead of handing out iterators. Payloads that
+// are expensive to copy are best held through a scoped_refptr.
+//
+// Example:
+//   winbase::ShardedMRUCache<std::string, scoped_refptr<Image>> images(
+//       16, winbase::ShardedMRUCache<std::string,
+//                                    scoped_refptr<Image>>::NO_AUTO_EVICT,
+//       64 * 1024 * 1024);
+//   images.Put(url, image, image->size_in_bytes());
+//   ...
+//   scoped_refptr<Image> image;
+//   if (images.Get(url, &image))
+//     Draw(image);
+template <class KeyType,
+          class PayloadType,
+          class HashType = FlatHash<KeyType>,
+          class KeyEqual = std::equal_to<>>
+class ShardedMRUCache {
+ public:
+  using Cache = HashingMRUCache<KeyType, PayloadType, HashType, KeyEqual>;
+  using EvictionCallback = typename Cache::EvictionCallback;
+  using size_type = size_t;
+
+  enum { NO_AUTO_EVICT = Cache::NO_AUTO_EVICT };
+
+  // |num_shards| is rounded up to a power of two. |max_size| and |max_cost|
+  // are split evenly between the shards, see MRUCacheBase.
+  ShardedMRUCache(size_t num_shards,
+                  size_type max_size,
+                  size_t max_cost = Cache::kNoCostLimit) {
+    WINBASE_DCHECK(num_shards);
+    int shard_bits = bits::Log2Ceiling(static_cast<uint32_t>(num_shards));
+    shard_shift_ = sizeof(size_t) * 8 - shard_bits;
+    num_shards = size_t(1) << shard_bits;
+    size_type shard_size =
+        max_size == NO_AUTO_EVICT ? max_size
+                                  : (max_size + num_shards - 1) / num_shards;
+    size_t shard_cost = max_cost == Cache::kNoCostLimit
+                            ? max_cost
+                            : (max_cost + num_shards - 1) / num_shards;
+    shards_.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; ++i)
+      shards_.push_back(std::make_unique<Shard>(shard_size, shard_cost));
+  }
+
+  ShardedMRUCache(const ShardedMRUCache&) = delete;
+  ShardedMRUCache& operator=(const ShardedMRUCache&) = delete;
+
+  // The callback runs on the thread that caused the eviction, with the lock
+  // of the shard held, so it must not call back into this cache.
+  void SetEvictionCallback(const EvictionCallback& callback) {
+    for (auto& shard : shards_) {
+      AutoLock auto_lock(shard->lock);
+      shard->cache.SetEvictionCallback(callback);
+    }
+  }
+
+  // Inserts or replaces the payload of |key|, see MRUCacheBase::Put().
+  template <typename Payload>
+  void Put(const KeyType& key, Payload&& payload, size_t cost = 1) {
+    Shard& shard = GetShard(key);
+    AutoLock auto_lock(shard.lock);
+    shard.cache.Put(key, std::forward<Payload>(payload), cost);
+  }
+
+  // Copies the payload of |key| to |payload| and makes it the most recently
+  // used entry of its shard. Returns false if |key| is not in the cache.
+  template <typename K>
+  bool Get(const K& key, PayloadType* payload) {
+    Shard& shard = GetShard(key);
+    AutoLock auto_lock(shard.lock);
+    auto it = shard.cache.Get(key);
+    if (it == shard.cache.end())
+      return false;
+    *payload = it->second;
+    return true;
+  }
+
+  // Erases |key| without running the eviction callback. Returns false if it
+  // was not in the cache.
+  template <typename K>
+  bool Erase(const K& key) {
+    Shard& shard = GetShard(key);
+    AutoLock auto_lock(shard.lock);
+    auto it = shard.cache.Peek(key);
+    if (it == shard.cache.end())
+      return false;
+    shard.cache.Erase(it);
+    return true;
+  }
+
+  // Deletes everything from the cache without running the eviction callback.
+  void Clear() {
+    for (auto& shard : shards_) {
+      AutoLock auto_lock(shard->lock);
+      shard->cache.Clear();
+    }
+  }
+
+  // The number of entries and their total cost. As the shards are visited
+  // one at a time, these are only a snapshot if other threads are writing.
+  size_type size() const {
+    size_type size = 0;
+    for (auto& shard : shards_) {
+      AutoLock auto_lock(shard->lock);
+      size += shard->cache.size();
+    }
+    return size;
+  }
+
+  size_t total_cost() const {
+    size_t total_cost = 0;
+    for (auto& shard : shards_) {
+      AutoLock auto_lock(shard->lock);
+      total_cost += shard->cache.total_cost();
+    }
+    return total_cost;
+  }
+
+  size_t num_shards() const { return shards_.size(); }
+
+ private:
+  // Each shard is allocated on its own so that the locks of neighbouring
+  // shards are unlikely to share a cache line.
+  struct Shard {
+    Shard(size_type max_size, size_t max_cost) : cache(max_size, max_cost) {}
+
+    Lock lock;
+    Cache cache;
+  };
+
+  // The shard is picked with the top bits of the hash mixed again: string
+  // hashes are only 32 bits wide, and the hash tables of the shards pick
+  // slots with the bottom bits of the hash.
+  template <typename K>
+  Shard& GetShard(const K& key) {
+    // Shifting by the width of size_t would be undefined.
+    if (shards_.size() == 1)
+      return *shards_[0];
+    return *shards_[HashInt(hash_(key)) >> shard_shift_];
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  unsigned shard_shift_;
+  HashType hash_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_SHARDED_MRU_CACHE_H_
\ No newline at end of file
@@ -0,0 +1,262 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_CONTAINERS_SLOT_MAP_H_
+#define WINLIB_WINBASE_CONTAINERS_SLOT_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "winbase\hash.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+// The handle of a value in a SlotMap: the index of its slot, and the
+// generation of the slot when the value was inserted. A default-constructed
+// key refers to no value.
+struct SlotMapKey {
+  constexpr SlotMapKey() = default;
+  constexpr SlotMapKey(uint32_t index, uint32_t generation)
+      : index(index), generation(generation) {}
+
+  bool is_null() const { return generation == 0; }
+
+  // The key as a single integer, for callers that already pass around
+  // 64-bit IDs. FromUint64(key.ToUint64()) == key.
+  uint64_t ToUint64() const {
+    return (static_cast<uint64_t>(generation) << 32) | index;
+  }
+  static SlotMapKey FromUint64(uint64_t value) {
+    return SlotMapKey(static_cast<uint32_t>(value),
+                      static_cast<uint32_t>(value >> 32));
+  }
+
+  uint32_t index = 0;
+  uint32_t generation = 0;
+};
+
+inline bool operator==(SlotMapKey lhs, SlotMapKey rhs) {
+  return lhs.index == rhs.index && lhs.generation == rhs.generation;
+}
+
+inline bool operator!=(SlotMapKey lhs, SlotMapKey rhs) {
+  return !(lhs == rhs);
+}
+
+inline bool operator<(SlotMapKey lhs, SlotMapKey rhs) {
+  return lhs.ToUint64() < rhs.ToUint64();
+}
+
+template <>
+struct FlatHash<SlotMapKey> {
+  size_t operator()(SlotMapKey key) const { return HashInt(key.ToUint64()); }
+};
+
+// SlotMap owns a set of values and hands out a SlotMapKey for each of them,
+// for registries of live objects (observers, timers, watchers) that are
+// looked up by ID. Insert(), Erase() and Lookup() take constant time, and a
+// key whose value was erased is detected instead of finding whatever value
+// was inserted after it, as happens when the IDs of a std::map are reused.
+//
+// The values are kept packed in a vector, so iterating over them is as fast
+// as iterating over a vector. Each key names a slot, which holds the
+// position of its value in the vector and a generation count. Erasing a value
+// moves the last value into its place, bumps the generation of its slot and
+// puts the slot on a free list; keys to the erased value no longer match the
+// generation and Lookup() returns null for them.
+//
+// As values move when others are erased, pointers and iterators to values
+// are invalidated by Insert() and Erase(), like those of a vector; only keys
+// stay valid. The order of iteration is not the order of insertion.
+//
+// The generation of a slot wraps after 2^31 reuses, so a key kept that long
+// could in theory match a newer value.
+//
+// Example:
+//   winbase::SlotMap<std::unique_ptr<Timer>> timers;
+//   winbase::SlotMapKey key = timers.Insert(std::make_unique<Timer>(delay));
+//   ...
+//   if (std::unique_ptr<Timer>* timer = timers.Lookup(key))
+//     (*timer)->Reset();
+//   timers.Erase(key);
+template <typename T>
+class SlotMap {
+ public:
+  using Key = SlotMapKey;
+  using value_type = T;
+  using size_type = size_t;
+  using iterator = typename std::vector<T>::iterator;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  SlotMap() = default;
+  SlotMap(const SlotMap&) = default;
+  SlotMap& operator=(const SlotMap&) = default;
+
+  // A moved-from map is empty.
+  SlotMap(SlotMap&& other) noexcept { swap(other); }
+  SlotMap& operator=(SlotMap&& other) noexcept {
+    SlotMap(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  // Inserts a value constructed from |args| and returns its key.
+  template <typename... Args>
+  Key Emplace(Args&&... args) {
+    WINBASE_CHECK(values_.size() < kMaxSize);
+    uint32_t index;
+    if (free_head_ != kNoSlot) {
+      index = free_head_;
+      free_head_ = slots_[index].position;
+    } else {
+      WINBASE_CHECK(slots_.size() < kMaxSize);
+      index = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(Slot());
+    }
+    values_.emplace_back(std::forward<Args>(args)...);
+    value_slots_.push_back(index);
+    Slot& slot = slots_[index];
+    slot.position = static_cast<uint32_t>(values_.size() - 1);
+    // Odd generations are in use.
+    ++slot.generation;
+    return Key(index, slot.generation);
+  }
+
+  Key Insert(const T& value) { return Emplace(value); }
+  Key Insert(T&& value) { return Emplace(std::move(value)); }
+
+  // Returns the value of |key|, or null if it was erased or |key| is null.
+  T* Lookup(Key key) {
+    const Slot* slot = FindSlot(key);
+    return slot ? &values_[slot->position] : nullptr;
+  }
+  const T* Lookup(Key key) const {
+    const Slot* slot = FindSlot(key);
+    return slot ? &values_[slot->position] : nullptr;
+  }
+
+  bool Contains(Key key) const { return FindSlot(key) != nullptr; }
+
+  // Erases the value of |key|. Returns false if there was none.
+  bool Erase(Key key) {
+    if (!FindSlot(key))
+      return false;
+    EraseSlot(key.index);
+    return true;
+  }
+
+  // Erases the value at |position| and returns an iterator to the value that
+  // took its place, so that values can be erased while iterating:
+  //   for (auto it = map.begin(); it != map.end();)
+  //     it = ShouldErase(*it) ? map.Erase(it) : it + 1;
+  iterator Erase(const_iterator position) {
+    size_t offset = static_cast<size_t>(position - values_.cbegin());
+    WINBASE_DCHECK(offset < values_.size());
+    EraseSlot(value_slots_[offset]);
+    return values_.begin() + offset;
+  }
+
+  // Returns the key of the value at |position|.
+  Key GetKey(const_iterator position) const {
+    size_t offset = static_cast<size_t>(position - values_.cbegin());
+    WINBASE_DCHECK(offset < values_.size());
+    uint32_t index = value_slots_[offset];
+    return Key(index, slots_[index].generation);
+  }
+
+  // Erases every value. Keys to them stay stale: the slots are kept, with
+  // their generations bumped, and reused by later insertions.
+  void Clear() {
+    for (uint32_t index : value_slots_) {
+      Slot& slot = slots_[index];
+      ++slot.generation;
+      slot.position = free_head_;
+      free_head_ = index;
+    }
+    values_.clear();
+    value_slots_.clear();
+  }
+
+  void reserve(size_type new_capacity) {
+    values_.reserve(new_capacity);
+    value_slots_.reserve(new_capacity);
+    slots_.reserve(new_capacity);
+  }
+
+  size_type size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  iterator begin() { return values_.begin(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator cbegin() const { return values_.cbegin(); }
+  iterator end() { return values_.end(); }
+  const_iterator end() const { return values_.end(); }
+  const_iterator cend() const { return values_.cend(); }
+
+  void swap(SlotMap& other) noexcept {
+    values_.swap(other.values_);
+    value_slots_.swap(other.value_slots_);
+    slots_.swap(other.slots_);
+    std::swap(free_head_, other.free_head_);
+  }
+
+ private:
+  // A slot in use holds the position of its value in |values_|; a free slot
+  // holds the index of the next free slot, or kNoSlot.
+  struct Slot {
+    uint32_t position = 0;
+    uint32_t generation = 0;
+  };
+
+  static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+  static constexpr size_t kMaxSize = kNoSlot;
+
+  const Slot* FindSlot(Key key) const {
+    if (key.index >= slots_.size())
+      return nullptr;
+    const Slot& slot = slots_[key.index];
+    // A null key has generation 0, which is even and never in use.
+    if (slot.generation != key.generation || !(slot.generation & 1))
+      return nullptr;
+    return &slot;
+  }
+
+  // Moves the last value into the place of the value of slot |index|, then
+  // frees the slot.
+  void EraseSlot(uint32_t index) {
+    Slot& slot = slots_[index];
+    uint32_t position = slot.position;
+    uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+    if (position != last) {
+      values_[position] = std::move(values_[last]);
+      value_slots_[position] = value_slots_[last];
+      slots_[value_slots_[position]].position = position;
+    }
+    values_.pop_back();
+    value_slots_.pop_back();
+    ++slot.generation;
+    slot.position = free_head_;
+    free_head_ = index;
+  }
+
+  // The values, packed, and the index of the slot of each.
+  std::vector<T> values_;
+  std::vector<uint32_t> value_slots_;
+
+  std::vector<Slot> slots_;
+  uint32_t free_head_ = kNoSlot;
+};
+
+template <typename T>
+void swap(SlotMap<T>& lhs, SlotMap<T>& rhs) noexcept {
+  lhs.swap(rhs);
+}
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_CONTAINERS_SLOT_MAP_H_
\ No newline at end of file
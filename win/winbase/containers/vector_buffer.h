@@ -13,6 +13,7 @@
 
 ///#include "winbase\logging.h"
 #include "winbase\macros.h"
+#include "winbase\template_util.h"
 
 namespace winbase {
 namespace internal {
@@ -74,6 +75,7 @@ class VectorBuffer {
   T& operator[](size_t i) { return buffer_[i]; }
   const T& operator[](size_t i) const { return buffer_[i]; }
   T* begin() { return buffer_; }
+  const T* begin() const { return buffer_; }
   T* end() { return &buffer_[capacity_]; }
 
   // DestructRange ------------------------------------------------------------
@@ -82,14 +84,14 @@ class VectorBuffer {
   template <typename T2 = T,
             typename std::enable_if<std::is_trivially_destructible<T2>::value,
                                     int>::type = 0>
-  void DestructRange(T* begin, T* end) {}
+  static void DestructRange(T* begin, T* end) {}
 
   // Non-trivially destructible objects must have their destructors called
   // individually.
   template <typename T2 = T,
             typename std::enable_if<!std::is_trivially_destructible<T2>::value,
                                     int>::type = 0>
-  void DestructRange(T* begin, T* end) {
+  static void DestructRange(T* begin, T* end) {
     while (begin != end) {
       begin->~T();
       begin++;
@@ -108,7 +110,7 @@ class VectorBuffer {
   // Trivially copyable types can use memcpy. trivially copyable implies
   // that there is a trivial destructor as we don't have to call it.
   template <typename T2 = T,
-            typename std::enable_if<base::is_trivially_copyable<T2>::value,
+            typename std::enable_if<is_trivially_copyable<T2>::value,
                                     int>::type = 0>
   static void MoveRange(T* from_begin, T* from_end, T* to) {
     ///DCHECK(!RangesOverlap(from_begin, from_end, to));
@@ -119,7 +121,7 @@ class VectorBuffer {
   // destruct the original.
   template <typename T2 = T,
             typename std::enable_if<std::is_move_constructible<T2>::value &&
-                                        !base::is_trivially_copyable<T2>::value,
+                                        !is_trivially_copyable<T2>::value,
                                     int>::type = 0>
   static void MoveRange(T* from_begin, T* from_end, T* to) {
     ///DCHECK(!RangesOverlap(from_begin, from_end, to));
@@ -135,7 +137,7 @@ class VectorBuffer {
   // destruct the original.
   template <typename T2 = T,
             typename std::enable_if<!std::is_move_constructible<T2>::value &&
-                                        !base::is_trivially_copyable<T2>::value,
+                                        !is_trivially_copyable<T2>::value,
                                     int>::type = 0>
   static void MoveRange(T* from_begin, T* from_end, T* to) {
     ///DCHECK(!RangesOverlap(from_begin, from_end, to));
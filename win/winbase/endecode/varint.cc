@@ -0,0 +1,123 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\endecode\varint.h"
+
+#include "winbase\bits.h"
+#include "winlib\build_config.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#endif
+
+namespace winbase {
+
+namespace {
+
+// Decodes the complete varint of |length| bytes at |p|. Returns false if it
+// does not fit in 32 bits.
+inline bool DecodeCompleteVarint32(const uint8_t* p,
+                                   size_t length,
+                                   uint32_t* value) {
+  if (length > kMaxVarint32Length)
+    return false;
+  // The fifth byte only holds the four most significant bits.
+  if (length == kMaxVarint32Length && p[kMaxVarint32Length - 1] > 0x0F)
+    return false;
+  uint32_t result = 0;
+  for (size_t i = 0; i < length; ++i)
+    result |= static_cast<uint32_t>(p[i] & 0x7F) << (7 * i);
+  *value = result;
+  return true;
+}
+
+}  // namespace
+
+namespace internal {
+
+const char* DecodeVarint64Slow(const char* p,
+                               const char* end,
+                               uint64_t* value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(p);
+  size_t available = static_cast<size_t>(end - p);
+  uint64_t result = 0;
+  for (size_t i = 0; i < kMaxVarint64Length && i < available; ++i) {
+    // The tenth byte only holds the most significant bit.
+    if (i == kMaxVarint64Length - 1 && bytes[i] > 0x01)
+      return nullptr;
+    result |= static_cast<uint64_t>(bytes[i] & 0x7F) << (7 * i);
+    if (!(bytes[i] & 0x80)) {
+      *value = result;
+      return p + i + 1;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace internal
+
+const char* DecodeVarint32(const char* p, const char* end, uint32_t* value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(p);
+  size_t available = static_cast<size_t>(end - p);
+  for (size_t i = 0; i < kMaxVarint32Length && i < available; ++i) {
+    if (!(bytes[i] & 0x80))
+      return DecodeCompleteVarint32(bytes, i + 1, value) ? p + i + 1 : nullptr;
+  }
+  return nullptr;
+}
+
+const char* DecodeVarint32Array(const char* p,
+                                const char* end,
+                                uint32_t* values,
+                                size_t count) {
+#if defined(ARCH_CPU_X86_FAMILY)
+  const __m128i zero = _mm_setzero_si128();
+  while (count >= 16 && end - p >= 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // One bit per byte, set for the bytes that do not end a varint.
+    unsigned continued = static_cast<unsigned>(_mm_movemask_epi8(block));
+    if (!continued) {
+      // Sixteen single-byte varints: widen them all to 32 bits.
+      __m128i low = _mm_unpacklo_epi8(block, zero);
+      __m128i high = _mm_unpackhi_epi8(block, zero);
+      __m128i* out = reinterpret_cast<__m128i*>(values);
+      _mm_storeu_si128(out, _mm_unpacklo_epi16(low, zero));
+      _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(low, zero));
+      _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(high, zero));
+      _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(high, zero));
+      p += 16;
+      values += 16;
+      count -= 16;
+      continue;
+    }
+
+    // Decode the varints that end within the block, using the mask to find
+    // their boundaries instead of testing each byte.
+    unsigned ends = ~continued & 0xFFFF;
+    if (!ends)
+      return nullptr;  // Longer than kMaxVarint32Length.
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(p);
+    size_t start = 0;
+    do {
+      size_t last = bits::CountTrailingZeroBits(ends);
+      if (!DecodeCompleteVarint32(bytes + start, last - start + 1, values))
+        return nullptr;
+      ++values;
+      --count;
+      start = last + 1;
+      ends &= ends - 1;
+    } while (ends);
+    p += start;
+  }
+#endif
+
+  for (; count; --count) {
+    p = DecodeVarint32(p, end, values++);
+    if (!p)
+      return nullptr;
+  }
+  return p;
+}
+
+}  // namespace winbase
\ No newline at end of file
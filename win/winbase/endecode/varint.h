@@ -0,0 +1,104 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// LEB128 variable-length integers. A value is stored seven bits at a time,
+// least significant group first, and every byte but the last has its high
+// bit set. Values below 128 take a single byte. Signed values should be
+// zigzag-encoded first so that small negative numbers stay small too.
+
+#ifndef WINLIB_WINBASE_ENDECODE_VARINT_H_
+#define WINLIB_WINBASE_ENDECODE_VARINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+
+namespace winbase {
+
+// Maximum encoded lengths of 32-bit and 64-bit values.
+constexpr size_t kMaxVarint32Length = 5;
+constexpr size_t kMaxVarint64Length = 10;
+
+// Maps signed values to unsigned ones so that values of small magnitude get
+// small codes: 0 -> 0, -1 -> 1, 1 -> 2, -2 -> 3, ...
+constexpr uint32_t ZigZagEncode32(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+constexpr int32_t ZigZagDecode32(uint32_t value) {
+  return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+constexpr uint64_t ZigZagEncode64(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+constexpr int64_t ZigZagDecode64(uint64_t value) {
+  return static_cast<int64_t>((value >> 1) ^ (0ull - (value & 1)));
+}
+
+// Returns the number of bytes EncodeVarint64() writes for |value|.
+inline size_t VarintLength(uint64_t value) {
+  size_t length = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++length;
+  }
+  return length;
+}
+
+// Writes |value| at |out|, which must have room for kMaxVarint64Length bytes,
+// and returns the address following the last byte written.
+inline char* EncodeVarint64(uint64_t value, char* out) {
+  uint8_t* p = reinterpret_cast<uint8_t*>(out);
+  while (value >= 0x80) {
+    *p++ = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = static_cast<uint8_t>(value);
+  return reinterpret_cast<char*>(p);
+}
+
+namespace internal {
+
+WINBASE_EXPORT const char* DecodeVarint64Slow(const char* p,
+                                              const char* end,
+                                              uint64_t* value);
+
+}  // namespace internal
+
+// Decodes the varint starting at |p|, which must not extend past |end|, into
+// |*value|. Returns the address following the varint, or null if it is
+// truncated or does not fit in 64 bits.
+inline const char* DecodeVarint64(const char* p,
+                                  const char* end,
+                                  uint64_t* value) {
+  if (LIKELY(p < end && !(*p & 0x80))) {
+    *value = static_cast<uint8_t>(*p);
+    return p + 1;
+  }
+  return internal::DecodeVarint64Slow(p, end, value);
+}
+
+// Same as above, but fails if the value does not fit in 32 bits.
+WINBASE_EXPORT const char* DecodeVarint32(const char* p,
+                                          const char* end,
+                                          uint32_t* value);
+
+// Decodes |count| consecutive 32-bit varints into |values|. Returns the
+// address following the last one, or null if any of them is invalid, in which
+// case the contents of |values| are unspecified. Runs of single-byte values,
+// the common case for small integers, are decoded sixteen at a time on x86.
+WINBASE_EXPORT const char* DecodeVarint32Array(const char* p,
+                                               const char* end,
+                                               uint32_t* values,
+                                               size_t count);
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_ENDECODE_VARINT_H_
\ No newline at end of file
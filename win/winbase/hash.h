@@ -8,13 +8,16 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <functional>
 #include <limits>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include "winbase\base_export.h"
 #include "winbase\logging.h"
 #include "winbase\strings\string16.h"
+#include "winbase\strings\string_piece.h"
 
 namespace winbase {
 
@@ -64,6 +67,106 @@ struct IntPairHash<std::pair<Type1, Type2>> {
   }
 };
 
+// Mixes the bits of |value| so that every bit of the result depends on every
+// bit of |value|, which hash tables that take their index and tag from
+// different bits of a hash rely on. This is the finalizer of MurmurHash3.
+inline uint64_t HashInt64(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+// HashInt64() narrowed to size_t.
+inline size_t HashInt(uint64_t value) {
+  return static_cast<size_t>(HashInt64(value));
+}
+
+// The default hasher of flat_hash_map and flat_hash_set. Integers, enums and
+// pointers go through HashInt() and strings through Hash(); other types use
+// std::hash. The string hashers are transparent: FlatHash<std::string>
+// hashes a StringPiece as it hashes the equal std::string, so that a table
+// of std::string can be searched for a StringPiece without a copy.
+template <typename T, typename = void>
+struct FlatHash : std::hash<T> {};
+
+template <typename T>
+struct FlatHash<T,
+                std::enable_if_t<std::is_integral<T>::value ||
+                                 std::is_enum<T>::value>> {
+  size_t operator()(T value) const {
+    return HashInt(static_cast<uint64_t>(value));
+  }
+};
+
+template <typename T>
+struct FlatHash<T*> {
+  size_t operator()(const T* value) const {
+    return HashInt(reinterpret_cast<uintptr_t>(value));
+  }
+};
+
+template <>
+struct FlatHash<StringPiece> {
+  using is_transparent = void;
+  size_t operator()(StringPiece value) const {
+    return Hash(value.data(), value.size());
+  }
+};
+
+template <>
+struct FlatHash<std::string> : FlatHash<StringPiece> {};
+
+template <>
+struct FlatHash<StringPiece16> {
+  using is_transparent = void;
+  size_t operator()(StringPiece16 value) const {
+    return Hash(value.data(), value.size() * sizeof(char16));
+  }
+};
+
+template <>
+struct FlatHash<string16> : FlatHash<StringPiece16> {};
+
+// A hasher for values whose hashes are stored, such as in a BloomFilter
+// written to disk. Unlike FlatHash, whose size_t result is 32 bits on 32-bit
+// builds, it returns a uint64_t that is the same on every build and does not
+// change between versions. Integers and enums hash to their value, so the
+// result must be mixed, with HashInt64() for instance, before its bits are
+// used; strings hash with PersistentHash(). There is no hasher for other
+// types, since std::hash is neither.
+template <typename T, typename = void>
+struct StableHash;
+
+template <typename T>
+struct StableHash<T,
+                  std::enable_if_t<std::is_integral<T>::value ||
+                                   std::is_enum<T>::value>> {
+  uint64_t operator()(T value) const { return static_cast<uint64_t>(value); }
+};
+
+template <>
+struct StableHash<StringPiece> {
+  uint64_t operator()(StringPiece value) const {
+    return PersistentHash(value.data(), value.size());
+  }
+};
+
+template <>
+struct StableHash<std::string> : StableHash<StringPiece> {};
+
+template <>
+struct StableHash<StringPiece16> {
+  uint64_t operator()(StringPiece16 value) const {
+    return PersistentHash(value.data(), value.size() * sizeof(char16));
+  }
+};
+
+template <>
+struct StableHash<string16> : StableHash<StringPiece16> {};
+
 }  // namespace winbase
 
 #endif  // WINLIB_WINBASE_HASH_H_
\ No newline at end of file
@@ -0,0 +1,302 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\ipc\channel.h"
+
+#include <string.h>
+#include <windows.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "winbase\logging.h"
+#include "winbase\message_loop\message_loop_current.h"
+#include "winbase\rand_util.h"
+#include "winbase\strings\stringprintf.h"
+#include "winbase\win\handle_attachment.h"
+
+namespace winbase {
+
+namespace {
+
+// Size of the pipe's buffers and of the free space offered to each read.
+constexpr DWORD kPipeBufferSize = 64 * 1024;
+
+// Writes larger than this are split, the rest going out when the first part
+// completes.
+constexpr size_t kMaxWriteSize = 16 * 1024 * 1024;
+
+// Handles are written as 64-bit values after the payload, whatever the
+// bitness of either process.
+using WireHandle = uint64_t;
+
+// Closes handles that were duplicated into |process| for a message that is
+// not going to be sent.
+void CloseRemoteHandles(HANDLE process, const char* values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    WireHandle value;
+    memcpy(&value, values + i * sizeof(value), sizeof(value));
+    ::DuplicateHandle(process,
+                      reinterpret_cast<HANDLE>(static_cast<uintptr_t>(value)),
+                      nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+  }
+}
+
+}  // namespace
+
+constexpr size_t Channel::kMaximumMessageSize;
+
+// static
+bool Channel::CreatePipePair(win::ScopedHandle* handle0,
+                             win::ScopedHandle* handle1) {
+  string16 name = StringPrintf(L"\\\\.\\pipe\\winbase.%lu.%llu",
+                               ::GetCurrentProcessId(), RandUint64());
+  win::ScopedHandle server(::CreateNamedPipeW(
+      name.c_str(),
+      PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_REJECT_REMOTE_CLIENTS, 1,
+      kPipeBufferSize, kPipeBufferSize, 0, nullptr));
+  if (!server.IsValid()) {
+    WINBASE_DPLOG(ERROR) << "CreateNamedPipe";
+    return false;
+  }
+
+  // Connects the pipe. The server end accepts no other client since it
+  // allows a single instance.
+  win::ScopedHandle client(::CreateFileW(
+      name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+      SECURITY_SQOS_PRESENT | SECURITY_ANONYMOUS | FILE_FLAG_OVERLAPPED,
+      nullptr));
+  if (!client.IsValid()) {
+    WINBASE_DPLOG(ERROR) << "CreateFile";
+    return false;
+  }
+
+  *handle0 = std::move(server);
+  *handle1 = std::move(client);
+  return true;
+}
+
+Channel::Channel(win::ScopedHandle pipe,
+                 win::ScopedHandle peer_process,
+                 Listener* listener)
+    : pipe_(std::move(pipe)),
+      peer_process_(std::move(peer_process)),
+      listener_(listener) {
+  WINBASE_DCHECK(listener_);
+}
+
+Channel::~Channel() {
+  WINBASE_DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  Close();
+}
+
+bool Channel::Connect() {
+  WINBASE_DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  if (closed_ || !pipe_.IsValid())
+    return false;
+  if (FAILED(MessageLoopCurrentForIO::Get()->RegisterIOHandler(pipe_.Get(),
+                                                               this))) {
+    WINBASE_DPLOG(ERROR) << "RegisterIOHandler";
+    return false;
+  }
+  input_buf_.resize(kPipeBufferSize);
+  return StartRead();
+}
+
+void Channel::Close() {
+  WINBASE_DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  if (closed_)
+    return;
+  closed_ = true;
+
+  if (input_state_.is_pending || output_state_.is_pending) {
+    ::CancelIo(pipe_.Get());
+    // Completions are still delivered for cancelled IO, and the buffers must
+    // stay alive until then.
+    while (input_state_.is_pending || output_state_.is_pending)
+      MessageLoopCurrentForIO::Get()->WaitForIOCompletion(INFINITE, this);
+  }
+  pipe_.Close();
+  peer_process_.Close();
+  writing_.clear();
+  pending_.clear();
+}
+
+bool Channel::Send(const ChannelMessage& message) {
+  WINBASE_DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  if (closed_ || !pipe_.IsValid())
+    return false;
+
+  size_t message_offset = pending_.size();
+  pending_.append(static_cast<const char*>(message.data()), message.size());
+  size_t num_handles = message.attachments_.size();
+  ChannelMessage::Header header;
+  memcpy(&header, &pending_[message_offset], sizeof(header));
+  header.num_handles = static_cast<uint32_t>(num_handles);
+  memcpy(&pending_[message_offset], &header, sizeof(header));
+
+  size_t handles_offset = pending_.size();
+  for (size_t i = 0; i < num_handles; ++i) {
+    win::HandleAttachment* attachment =
+        win::HandleAttachment::FromAttachment(message.attachments_[i].get());
+    HANDLE remote = nullptr;
+    if (!attachment || !peer_process_.IsValid() ||
+        !::DuplicateHandle(::GetCurrentProcess(), attachment->handle(),
+                           peer_process_.Get(), &remote, 0, FALSE,
+                           DUPLICATE_SAME_ACCESS)) {
+      WINBASE_DPLOG(ERROR) << "DuplicateHandle";
+      CloseRemoteHandles(peer_process_.Get(), &pending_[handles_offset], i);
+      pending_.resize(message_offset);
+      return false;
+    }
+    WireHandle value = reinterpret_cast<uintptr_t>(remote);
+    pending_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  if (output_state_.is_pending)
+    return true;
+  // The bytes queued so far may be partly written; nothing can follow them.
+  if (!StartWrite()) {
+    OnError();
+    return false;
+  }
+  return true;
+}
+
+void Channel::OnIOCompleted(MessagePumpForIO::IOContext* context,
+                            DWORD bytes_transferred,
+                            DWORD error) {
+  WINBASE_DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  if (context == &input_state_.context) {
+    input_state_.is_pending = false;
+    if (closed_)
+      return;
+    if (error != ERROR_SUCCESS || !bytes_transferred) {
+      OnError();
+      return;
+    }
+    input_size_ += bytes_transferred;
+    if (!DispatchMessages()) {
+      if (!closed_)
+        OnError();
+      return;
+    }
+    if (!StartRead())
+      OnError();
+    return;
+  }
+
+  WINBASE_DCHECK(context == &output_state_.context);
+  output_state_.is_pending = false;
+  if (closed_)
+    return;
+  if (error != ERROR_SUCCESS) {
+    OnError();
+    return;
+  }
+  // A pipe may complete only part of a write; the rest goes out first.
+  writing_.erase(0, bytes_transferred);
+  if (!writing_.empty()) {
+    writing_.append(pending_);
+    pending_.swap(writing_);
+  }
+  writing_.clear();
+  if (!StartWrite())
+    OnError();
+}
+
+bool Channel::StartRead() {
+  WINBASE_DCHECK(!input_state_.is_pending);
+  // Offer at least kPipeBufferSize bytes of free space to each read, so that
+  // one read picks up many small messages.
+  if (input_buf_.size() - input_size_ < kPipeBufferSize)
+    input_buf_.resize(input_size_ + kPipeBufferSize);
+
+  DWORD size = static_cast<DWORD>(input_buf_.size() - input_size_);
+  if (!::ReadFile(pipe_.Get(), input_buf_.data() + input_size_, size, nullptr,
+                  &input_state_.context.overlapped) &&
+      ::GetLastError() != ERROR_IO_PENDING) {
+    WINBASE_DPLOG_IF(ERROR, ::GetLastError() != ERROR_BROKEN_PIPE)
+        << "ReadFile";
+    return false;
+  }
+  // The completion port is notified even if the read completed immediately.
+  input_state_.is_pending = true;
+  return true;
+}
+
+bool Channel::StartWrite() {
+  WINBASE_DCHECK(!output_state_.is_pending);
+  if (pending_.empty())
+    return true;
+
+  writing_.swap(pending_);
+  if (writing_.size() > kMaxWriteSize) {
+    pending_.assign(writing_, kMaxWriteSize, std::string::npos);
+    writing_.resize(kMaxWriteSize);
+  }
+
+  if (!::WriteFile(pipe_.Get(), writing_.data(),
+                   static_cast<DWORD>(writing_.size()), nullptr,
+                   &output_state_.context.overlapped) &&
+      ::GetLastError() != ERROR_IO_PENDING) {
+    WINBASE_DPLOG_IF(ERROR, ::GetLastError() != ERROR_NO_DATA)
+        << "WriteFile";
+    return false;
+  }
+  output_state_.is_pending = true;
+  return true;
+}
+
+bool Channel::DispatchMessages() {
+  size_t offset = 0;
+  while (input_size_ - offset >= sizeof(ChannelMessage::Header)) {
+    const char* data = input_buf_.data() + offset;
+    ChannelMessage::Header header;
+    memcpy(&header, data, sizeof(header));
+    if (header.payload_size > kMaximumMessageSize ||
+        header.num_handles > ChannelMessage::kMaxAttachments) {
+      WINBASE_DLOG(ERROR) << "Malformed message";
+      return false;
+    }
+    size_t message_size = sizeof(header) + header.payload_size;
+    size_t wire_size = message_size + header.num_handles * sizeof(WireHandle);
+    if (input_size_ - offset < wire_size) {
+      // Make room for the rest of the message; StartRead() adds the free
+      // space for the next read.
+      if (input_buf_.size() - offset < wire_size)
+        input_buf_.resize(offset + wire_size);
+      break;
+    }
+
+    // The sender duplicated the handles into this process; the message owns
+    // them from here on.
+    ChannelMessage message(data, static_cast<int>(message_size));
+    for (uint32_t i = 0; i < header.num_handles; ++i) {
+      WireHandle value;
+      memcpy(&value, data + message_size + i * sizeof(value), sizeof(value));
+      message.attachments_.push_back(MakeRefCounted<win::HandleAttachment>(
+          win::ScopedHandle(
+              reinterpret_cast<HANDLE>(static_cast<uintptr_t>(value)))));
+    }
+    offset += wire_size;
+
+    listener_->OnMessageReceived(message);
+    if (closed_)
+      return false;
+  }
+
+  input_size_ -= offset;
+  if (offset && input_size_)
+    memmove(input_buf_.data(), input_buf_.data() + offset, input_size_);
+  return true;
+}
+
+void Channel::OnError() {
+  Close();
+  listener_->OnChannelError();
+}
+
+}  // namespace winbase
\ No newline at end of file
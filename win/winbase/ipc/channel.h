@@ -0,0 +1,143 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_IPC_CHANNEL_H_
+#define WINLIB_WINBASE_IPC_CHANNEL_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\ipc\channel_message.h"
+#include "winbase\message_loop\message_pump_for_io.h"
+#include "winbase\threading\thread_checker.h"
+#include "winbase\win\scoped_handle.h"
+
+namespace winbase {
+
+// Sends and receives ChannelMessages over a named pipe, using the completion
+// port of the current thread's MessageLoopForIO. Each message goes on the
+// wire as its pickle data followed by the values of the handles it carries,
+// which the sender duplicates into the receiving process.
+//
+// Messages sent while a write is in flight are queued and go out together in
+// the next write, so a burst of small messages costs a couple of WriteFile()
+// calls rather than one each. Reads use a large buffer and dispatch every
+// complete message it holds.
+//
+// Received handle values are taken at face value, so the peer must be trusted
+// not to name handles of this process it did not send.
+//
+// A Channel must be created, used and destroyed on the thread of a
+// MessageLoopForIO.
+//
+// Example:
+//   winbase::win::ScopedHandle mine, theirs;
+//   if (!winbase::Channel::CreatePipePair(&mine, &theirs))
+//     return false;
+//   ...  // Hand |theirs| to the child process.
+//   channel_ = std::make_unique<winbase::Channel>(
+//       std::move(mine), std::move(child_process), this);
+//   if (!channel_->Connect())
+//     return false;
+class WINBASE_EXPORT Channel : public MessagePumpForIO::IOHandler {
+ public:
+  class Listener {
+   public:
+    // Called for every message received. |message| and its payload are only
+    // valid during the call; take the handles out of its attachments with
+    // win::HandleAttachment::TakeHandle() to keep them. The listener may
+    // Close() the channel but must not destroy it from here.
+    virtual void OnMessageReceived(const ChannelMessage& message) = 0;
+
+    // Called once when the pipe is broken or the peer sent a malformed
+    // message. The channel is closed when this is called.
+    virtual void OnChannelError() = 0;
+
+   protected:
+    virtual ~Listener() {}
+  };
+
+  // The largest payload a message may have.
+  static constexpr size_t kMaximumMessageSize = 128 * 1024 * 1024;
+
+  // Creates the two ends of a new pipe, opened for overlapped IO. Neither is
+  // inheritable.
+  static bool CreatePipePair(win::ScopedHandle* handle0,
+                             win::ScopedHandle* handle1) WARN_UNUSED_RESULT;
+
+  // |pipe| must be a connected pipe opened for overlapped IO. Handles are
+  // duplicated into |peer_process|, which needs PROCESS_DUP_HANDLE access; it
+  // may be invalid if no message sent over the channel carries handles.
+  // |listener| must outlive the channel.
+  Channel(win::ScopedHandle pipe,
+          win::ScopedHandle peer_process,
+          Listener* listener);
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+  ~Channel() override;
+
+  // Registers the pipe with the current thread's MessageLoopForIO and starts
+  // reading. Returns false on failure.
+  bool Connect() WARN_UNUSED_RESULT;
+
+  // Cancels pending IO, waiting for it to finish, and closes the pipe.
+  // Queued messages that were not written yet are dropped.
+  void Close();
+
+  // Queues |message| for writing. Returns false if the channel is closed or
+  // a handle attached to |message| could not be duplicated into the peer.
+  // The handles stay owned by |message|. If the write cannot be started, the
+  // channel is closed and the listener's OnChannelError() is called before
+  // Send() returns false.
+  bool Send(const ChannelMessage& message);
+
+ private:
+  struct IOState {
+    MessagePumpForIO::IOContext context;
+    bool is_pending = false;
+  };
+
+  // MessagePumpForIO::IOHandler:
+  void OnIOCompleted(MessagePumpForIO::IOContext* context,
+                     DWORD bytes_transferred,
+                     DWORD error) override;
+
+  bool StartRead();
+  bool StartWrite();
+
+  // Dispatches the complete messages at the start of the input buffer.
+  // Returns false if a message is malformed or the listener closed the
+  // channel.
+  bool DispatchMessages();
+
+  // Closes the channel and tells the listener.
+  void OnError();
+
+  win::ScopedHandle pipe_;
+  win::ScopedHandle peer_process_;
+  Listener* const listener_;
+  bool closed_ = false;
+
+  IOState input_state_;
+  IOState output_state_;
+
+  // Bytes read from the pipe and not dispatched yet. Messages are dispatched
+  // straight from this buffer.
+  std::vector<char> input_buf_;
+  size_t input_size_ = 0;
+
+  // Bytes handed to the in-flight WriteFile(), and bytes queued behind it.
+  std::string writing_;
+  std::string pending_;
+
+  WINBASE_THREAD_CHECKER(thread_checker_);
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_IPC_CHANNEL_H_
\ No newline at end of file
@@ -0,0 +1,49 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\ipc\channel_message.h"
+
+#include <utility>
+
+namespace winbase {
+
+constexpr size_t ChannelMessage::kMaxAttachments;
+
+ChannelMessage::ChannelMessage() : Pickle(sizeof(Header)) {
+  headerT<Header>()->num_handles = 0;
+}
+
+ChannelMessage::ChannelMessage(const char* data, int data_len)
+    : Pickle(data, data_len) {}
+
+ChannelMessage::ChannelMessage(const ChannelMessage& other) = default;
+ChannelMessage& ChannelMessage::operator=(const ChannelMessage& other) =
+    default;
+ChannelMessage::~ChannelMessage() = default;
+
+bool ChannelMessage::WriteAttachment(scoped_refptr<Attachment> attachment) {
+  if (!attachment || attachment->GetType() != Attachment::Type::kHandle ||
+      attachments_.size() >= kMaxAttachments) {
+    return false;
+  }
+  WriteUInt32(static_cast<uint32_t>(attachments_.size()));
+  attachments_.push_back(std::move(attachment));
+  return true;
+}
+
+bool ChannelMessage::ReadAttachment(
+    PickleIterator* iter,
+    scoped_refptr<Attachment>* attachment) const {
+  uint32_t index;
+  if (!iter->ReadUInt32(&index) || index >= attachments_.size())
+    return false;
+  *attachment = attachments_[index];
+  return true;
+}
+
+bool ChannelMessage::HasAttachments() const {
+  return !attachments_.empty();
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,69 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_IPC_CHANNEL_MESSAGE_H_
+#define WINLIB_WINBASE_IPC_CHANNEL_MESSAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\memory\scoped_refptr.h"
+#include "winbase\pickle.h"
+
+namespace winbase {
+
+// A Pickle sent over a Channel. Unlike a plain Pickle, it accepts
+// win::HandleAttachments: WriteAttachment() records the index of the handle
+// in the payload, and the channel carries the handles themselves next to the
+// message.
+//
+// Example:
+//   winbase::ChannelMessage message;
+//   message.WriteInt(kOpenFileReply);
+//   message.WriteAttachment(
+//       winbase::MakeRefCounted<winbase::win::HandleAttachment>(
+//           std::move(file_handle)));
+//   channel->Send(message);
+class WINBASE_EXPORT ChannelMessage : public Pickle {
+ public:
+  struct Header : Pickle::Header {
+    // Number of handles following the payload on the wire.
+    uint32_t num_handles;
+  };
+
+  // The largest number of attachments a message may carry.
+  static constexpr size_t kMaxAttachments = 64;
+
+  ChannelMessage();
+
+  // Initializes a message from a const block of data, as the corresponding
+  // Pickle constructor does. The data is not copied.
+  ChannelMessage(const char* data, int data_len);
+
+  ChannelMessage(const ChannelMessage& other);
+  ChannelMessage& operator=(const ChannelMessage& other);
+  ~ChannelMessage() override;
+
+  // Pickle:
+  bool WriteAttachment(scoped_refptr<Attachment> attachment) override;
+  bool ReadAttachment(PickleIterator* iter,
+                      scoped_refptr<Attachment>* attachment) const override;
+  bool HasAttachments() const override;
+
+  const std::vector<scoped_refptr<Attachment>>& attachments() const {
+    return attachments_;
+  }
+
+ private:
+  friend class Channel;
+
+  std::vector<scoped_refptr<Attachment>> attachments_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_IPC_CHANNEL_MESSAGE_H_
\ No newline at end of file
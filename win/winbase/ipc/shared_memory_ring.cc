@@ -0,0 +1,366 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\ipc\shared_memory_ring.h"
+
+#include <string.h>
+#include <windows.h>
+
+#include <atomic>
+#include <utility>
+
+#include "winbase\bits.h"
+#include "winbase\logging.h"
+#include "winbase\numerics\safe_conversions.h"
+#include "winbase\pickle.h"
+#include "winbase\segmented_pickle.h"
+#include "winbase\win\handle_attachment.h"
+
+namespace winbase {
+
+namespace internal {
+
+// Lives at the start of the shared region, followed by the message buffer.
+// Each side's fields are on their own cache line so that the writer and the
+// reader do not bounce a line back and forth on every message.
+//
+// Positions count bytes since the ring was created and never wrap; the
+// offset into the buffer is the position modulo the capacity.
+struct SharedMemoryRingControl {
+  // Written by the writer only.
+  ALIGNAS(64) std::atomic<uint64_t> write_pos;
+
+  // Written by the reader only, except that the writer clears
+  // |reader_sleeping| when it rings the doorbell.
+  ALIGNAS(64) std::atomic<uint64_t> read_pos;
+  std::atomic<uint32_t> reader_sleeping;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Ring positions are shared between processes");
+
+}  // namespace internal
+
+namespace {
+
+using internal::SharedMemoryRingControl;
+
+constexpr size_t kMinCapacity = 4096;
+constexpr size_t kMaxCapacity = 1u << 30;
+
+// Every message is preceded by a record header holding its size, and records
+// start on 8-byte boundaries so that pickle headers stay aligned. A record
+// never wraps around the end of the buffer: when the next one does not fit,
+// the writer leaves a wrap marker and starts over at offset 0.
+constexpr size_t kRecordHeaderSize = 8;
+constexpr size_t kRecordAlignment = 8;
+constexpr uint32_t kWrapMarker = 0xFFFFFFFF;
+
+// Number of polls before a waiting reader goes to sleep on the doorbell.
+constexpr int kSpinCount = 256;
+
+size_t RecordSize(size_t message_size) {
+  return bits::Align(kRecordHeaderSize + message_size, kRecordAlignment);
+}
+
+// Returns the capacity of the message buffer in a mapping, or 0 if the
+// mapping does not hold a ring.
+size_t GetCapacity(const SharedMemoryMapping& mapping) {
+  if (!mapping.IsValid() || mapping.size() <= sizeof(SharedMemoryRingControl))
+    return 0;
+  size_t capacity = mapping.size() - sizeof(SharedMemoryRingControl);
+  if (capacity < kMinCapacity || capacity > kMaxCapacity ||
+      !bits::IsPowerOfTwo(capacity)) {
+    return 0;
+  }
+  return capacity;
+}
+
+HANDLE DuplicateEvent(HANDLE event) {
+  HANDLE process = ::GetCurrentProcess();
+  HANDLE duplicate = nullptr;
+  if (!::DuplicateHandle(process, event, process, &duplicate, 0, FALSE,
+                         DUPLICATE_SAME_ACCESS)) {
+    WINBASE_DPLOG(ERROR) << "DuplicateHandle";
+    return nullptr;
+  }
+  return duplicate;
+}
+
+}  // namespace
+
+// SharedMemoryRing ------------------------------------------------------------
+
+// static
+SharedMemoryRing SharedMemoryRing::Create(size_t capacity) {
+  WINBASE_CHECK_LE(capacity, kMaxCapacity);
+  size_t rounded = kMinCapacity;
+  while (rounded < capacity)
+    rounded <<= 1;
+
+  // The region is zero-filled, which is the initial state of the control
+  // block.
+  UnsafeSharedMemoryRegion region = UnsafeSharedMemoryRegion::Create(
+      sizeof(SharedMemoryRingControl) + rounded);
+  if (!region.IsValid())
+    return SharedMemoryRing();
+
+  // Auto-reset, so that a doorbell rung while the reader was awake wakes it
+  // up at most once.
+  win::ScopedHandle doorbell(::CreateEvent(nullptr, FALSE, FALSE, nullptr));
+  if (!doorbell.IsValid()) {
+    WINBASE_DPLOG(ERROR) << "CreateEvent";
+    return SharedMemoryRing();
+  }
+  return SharedMemoryRing(std::move(region), std::move(doorbell));
+}
+
+// static
+bool SharedMemoryRing::WriteToPickle(Pickle* pickle, SharedMemoryRing ring) {
+  if (!ring.IsValid())
+    return false;
+  return pickle->WriteAttachment(MakeRefCounted<win::HandleAttachment>(
+             std::move(ring.doorbell_))) &&
+         UnsafeSharedMemoryRegion::WriteToPickle(pickle,
+                                                 std::move(ring.region_));
+}
+
+// static
+bool SharedMemoryRing::ReadFromPickle(const Pickle& pickle,
+                                      PickleIterator* iter,
+                                      SharedMemoryRing* ring) {
+  scoped_refptr<Pickle::Attachment> attachment;
+  if (!pickle.ReadAttachment(iter, &attachment))
+    return false;
+  win::HandleAttachment* doorbell =
+      win::HandleAttachment::FromAttachment(attachment.get());
+  if (!doorbell)
+    return false;
+
+  UnsafeSharedMemoryRegion region;
+  if (!UnsafeSharedMemoryRegion::ReadFromPickle(pickle, iter, &region))
+    return false;
+  *ring = SharedMemoryRing(std::move(region), doorbell->TakeHandle());
+  return ring->IsValid();
+}
+
+SharedMemoryRing::SharedMemoryRing() = default;
+SharedMemoryRing::SharedMemoryRing(SharedMemoryRing&&) = default;
+SharedMemoryRing& SharedMemoryRing::operator=(SharedMemoryRing&&) = default;
+SharedMemoryRing::~SharedMemoryRing() = default;
+
+SharedMemoryRing::SharedMemoryRing(UnsafeSharedMemoryRegion region,
+                                   win::ScopedHandle doorbell)
+    : region_(std::move(region)), doorbell_(std::move(doorbell)) {}
+
+bool SharedMemoryRing::IsValid() const {
+  return region_.IsValid() && doorbell_.IsValid();
+}
+
+SharedMemoryRing SharedMemoryRing::Duplicate() const {
+  if (!IsValid())
+    return SharedMemoryRing();
+  return SharedMemoryRing(region_.Duplicate(),
+                          win::ScopedHandle(DuplicateEvent(doorbell_.Get())));
+}
+
+// SharedMemoryRingWriter ------------------------------------------------------
+
+SharedMemoryRingWriter::SharedMemoryRingWriter(SharedMemoryRing ring)
+    : mapping_(ring.region_.Map()), doorbell_(std::move(ring.doorbell_)) {
+  capacity_ = GetCapacity(mapping_);
+  if (!capacity_ || !doorbell_.IsValid())
+    return;
+
+  control_ = static_cast<SharedMemoryRingControl*>(mapping_.memory());
+  buffer_ = static_cast<char*>(mapping_.memory()) +
+            sizeof(SharedMemoryRingControl);
+  write_pos_ = control_->write_pos.load(std::memory_order_relaxed);
+  read_pos_ = control_->read_pos.load(std::memory_order_acquire);
+}
+
+SharedMemoryRingWriter::~SharedMemoryRingWriter() = default;
+
+size_t SharedMemoryRingWriter::max_message_size() const {
+  // Guarantees that any message fits in an empty ring, whatever the offset
+  // of the next record.
+  return capacity_ ? capacity_ / 2 - kRecordHeaderSize : 0;
+}
+
+bool SharedMemoryRingWriter::Write(const Pickle& pickle) {
+  WINBASE_DCHECK(!pickle.HasAttachments());
+  return Write(pickle.data(), pickle.size());
+}
+
+bool SharedMemoryRingWriter::Write(SegmentedPickle* pickle) {
+  char* dest = BeginRecord(pickle->size());
+  if (!dest)
+    return false;
+  pickle->CopyTo(dest);
+  CommitRecord(pickle->size());
+  return true;
+}
+
+bool SharedMemoryRingWriter::Write(const void* data, size_t size) {
+  char* dest = BeginRecord(size);
+  if (!dest)
+    return false;
+  memcpy(dest, data, size);
+  CommitRecord(size);
+  return true;
+}
+
+char* SharedMemoryRingWriter::BeginRecord(size_t size) {
+  // The reader parses every record as a pickle and stops at the first one
+  // that is not valid, so reject what cannot even hold a pickle header.
+  if (!control_ || size < sizeof(Pickle::Header) || size > max_message_size())
+    return nullptr;
+
+  size_t record_size = RecordSize(size);
+  size_t offset = static_cast<size_t>(write_pos_ & (capacity_ - 1));
+  size_t contiguous = capacity_ - offset;
+  size_t needed =
+      record_size <= contiguous ? record_size : contiguous + record_size;
+
+  if (needed > capacity_ - (write_pos_ - read_pos_)) {
+    uint64_t read_pos = control_->read_pos.load(std::memory_order_acquire);
+    if (read_pos < read_pos_ || read_pos > write_pos_) {
+      WINBASE_DLOG(ERROR) << "Corrupt shared memory ring";
+      return nullptr;
+    }
+    read_pos_ = read_pos;
+    if (needed > capacity_ - (write_pos_ - read_pos_))
+      return nullptr;
+  }
+
+  if (record_size > contiguous) {
+    memcpy(buffer_ + offset, &kWrapMarker, sizeof(kWrapMarker));
+    write_pos_ += contiguous;
+    offset = 0;
+  }
+  uint32_t header = static_cast<uint32_t>(size);
+  memcpy(buffer_ + offset, &header, sizeof(header));
+  return buffer_ + offset + kRecordHeaderSize;
+}
+
+void SharedMemoryRingWriter::CommitRecord(size_t size) {
+  write_pos_ += RecordSize(size);
+  // Sequentially consistent with the load of |reader_sleeping| below, and
+  // paired with the reader storing |reader_sleeping| before loading
+  // |write_pos|: either the reader sees the new message, or the writer sees
+  // that the reader is going to sleep.
+  control_->write_pos.store(write_pos_, std::memory_order_seq_cst);
+  if (control_->reader_sleeping.load(std::memory_order_seq_cst) &&
+      control_->reader_sleeping.exchange(0, std::memory_order_seq_cst)) {
+    if (!::SetEvent(doorbell_.Get()))
+      WINBASE_DPLOG(ERROR) << "SetEvent";
+  }
+}
+
+// SharedMemoryRingReader ------------------------------------------------------
+
+SharedMemoryRingReader::SharedMemoryRingReader(SharedMemoryRing ring)
+    : mapping_(ring.region_.Map()), doorbell_(std::move(ring.doorbell_)) {
+  capacity_ = GetCapacity(mapping_);
+  if (!capacity_ || !doorbell_.IsValid())
+    return;
+
+  control_ = static_cast<SharedMemoryRingControl*>(mapping_.memory());
+  buffer_ = static_cast<const char*>(mapping_.memory()) +
+            sizeof(SharedMemoryRingControl);
+  read_pos_ = control_->read_pos.load(std::memory_order_relaxed);
+}
+
+SharedMemoryRingReader::~SharedMemoryRingReader() = default;
+
+bool SharedMemoryRingReader::HasMessage() const {
+  return control_ &&
+         control_->write_pos.load(std::memory_order_acquire) != read_pos_;
+}
+
+bool SharedMemoryRingReader::Wait(TimeDelta timeout) {
+  if (!control_)
+    return false;
+  for (int i = 0; i < kSpinCount; ++i) {
+    if (HasMessage())
+      return true;
+    YieldProcessor();
+  }
+
+  TimeTicks deadline =
+      timeout.is_max() ? TimeTicks::Max() : TimeTicks::Now() + timeout;
+  for (;;) {
+    // See SharedMemoryRingWriter::CommitRecord().
+    control_->reader_sleeping.store(1, std::memory_order_seq_cst);
+    if (HasMessage())
+      break;
+
+    DWORD wait_ms = INFINITE;
+    if (!deadline.is_max()) {
+      TimeDelta remaining = deadline - TimeTicks::Now();
+      if (remaining <= TimeDelta())
+        break;
+      wait_ms = saturated_cast<DWORD>(remaining.InMillisecondsRoundedUp());
+    }
+    // The doorbell may also have been left signaled by an earlier message;
+    // the loop re-checks the ring after every wake-up.
+    if (::WaitForSingleObject(doorbell_.Get(), wait_ms) == WAIT_FAILED) {
+      WINBASE_DPLOG(ERROR) << "WaitForSingleObject";
+      break;
+    }
+  }
+  control_->reader_sleeping.store(0, std::memory_order_relaxed);
+  return HasMessage();
+}
+
+bool SharedMemoryRingReader::Peek(PickleView* view) {
+  if (!control_ || has_error_)
+    return false;
+
+  uint64_t write_pos = control_->write_pos.load(std::memory_order_acquire);
+  while (write_pos != read_pos_) {
+    uint64_t available = write_pos - read_pos_;
+    if (write_pos < read_pos_ || available > capacity_)
+      break;
+
+    size_t offset = static_cast<size_t>(read_pos_ & (capacity_ - 1));
+    // Read the header once: the writer could change it under us.
+    uint32_t size;
+    memcpy(&size, buffer_ + offset, sizeof(size));
+    if (size == kWrapMarker) {
+      // A wrap marker is always followed by a record.
+      if (capacity_ - offset >= available)
+        break;
+      read_pos_ += capacity_ - offset;
+      continue;
+    }
+
+    size_t record_size = RecordSize(size);
+    if (size > capacity_ / 2 || record_size > capacity_ - offset ||
+        record_size > available) {
+      break;
+    }
+    PickleView message(buffer_ + offset + kRecordHeaderSize, size);
+    if (!message.IsValid())
+      break;
+    *view = message;
+    peeked_size_ = record_size;
+    return true;
+  }
+
+  if (write_pos != read_pos_) {
+    WINBASE_DLOG(ERROR) << "Corrupt shared memory ring";
+    has_error_ = true;
+  }
+  return false;
+}
+
+void SharedMemoryRingReader::Pop() {
+  WINBASE_DCHECK(peeked_size_);
+  read_pos_ += peeked_size_;
+  peeked_size_ = 0;
+  control_->read_pos.store(read_pos_, std::memory_order_release);
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,190 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_IPC_SHARED_MEMORY_RING_H_
+#define WINLIB_WINBASE_IPC_SHARED_MEMORY_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\memory\shared_memory_mapping.h"
+#include "winbase\memory\shared_memory_region.h"
+#include "winbase\pickle_view.h"
+#include "winbase\time\time.h"
+#include "winbase\win\scoped_handle.h"
+
+namespace winbase {
+
+class Pickle;
+class PickleIterator;
+class SegmentedPickle;
+
+namespace internal {
+struct SharedMemoryRingControl;
+}  // namespace internal
+
+// A single-producer, single-consumer queue of Pickles in shared memory, for
+// passing messages between two processes (or threads) without a system call
+// per message.
+//
+// A SharedMemoryRing is the transferable part: the shared memory region and
+// the doorbell event the writer signals when the reader is asleep. Create one,
+// send a Duplicate() to the peer, e.g. with WriteToPickle() over a channel
+// that duplicates handles, and attach a SharedMemoryRingWriter to one copy and
+// a SharedMemoryRingReader to the other. Each ring carries messages in one
+// direction; use two rings for a request/reply protocol.
+//
+// Messages are copied into the ring once by the writer and read in place by
+// the reader as PickleViews. The writer only enters the kernel, to set the
+// doorbell, when the reader has announced it is about to sleep.
+//
+// Example:
+//   // Process A.
+//   auto ring = winbase::SharedMemoryRing::Create(1 << 20);
+//   SendToProcessB(ring.Duplicate());
+//   winbase::SharedMemoryRingWriter writer(std::move(ring));
+//   winbase::Pickle pickle;
+//   pickle.WriteString("hello");
+//   if (!writer.Write(pickle))
+//     ...  // Full; retry later.
+//
+//   // Process B.
+//   winbase::SharedMemoryRingReader reader(std::move(ring_from_a));
+//   winbase::PickleView view;
+//   while (reader.Wait(winbase::TimeDelta::Max()) && reader.Peek(&view)) {
+//     winbase::PickleIterator iter(view);
+//     ...
+//     reader.Pop();
+//   }
+class WINBASE_EXPORT SharedMemoryRing {
+ public:
+  // Creates a ring holding up to |capacity| bytes of messages. |capacity| is
+  // rounded up to a power of two of at least 4 KB, and may not exceed 1 GB.
+  static SharedMemoryRing Create(size_t capacity);
+
+  // Serializes |ring| as two handle attachments of |pickle|. Returns false if
+  // |ring| is invalid or |pickle| does not support attachments.
+  static bool WriteToPickle(Pickle* pickle, SharedMemoryRing ring);
+  static bool ReadFromPickle(const Pickle& pickle,
+                             PickleIterator* iter,
+                             SharedMemoryRing* ring) WARN_UNUSED_RESULT;
+
+  // Creates an invalid ring.
+  SharedMemoryRing();
+  SharedMemoryRing(SharedMemoryRing&&);
+  SharedMemoryRing& operator=(SharedMemoryRing&&);
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+  ~SharedMemoryRing();
+
+  bool IsValid() const;
+
+  // Returns a new handle to the same ring, for the peer.
+  SharedMemoryRing Duplicate() const;
+
+ private:
+  friend class SharedMemoryRingReader;
+  friend class SharedMemoryRingWriter;
+
+  SharedMemoryRing(UnsafeSharedMemoryRegion region, win::ScopedHandle doorbell);
+
+  UnsafeSharedMemoryRegion region_;
+  win::ScopedHandle doorbell_;
+};
+
+// The producing end of a SharedMemoryRing. Only one writer may be attached to
+// a ring, and it must be used from one thread at a time.
+class WINBASE_EXPORT SharedMemoryRingWriter {
+ public:
+  explicit SharedMemoryRingWriter(SharedMemoryRing ring);
+  SharedMemoryRingWriter(const SharedMemoryRingWriter&) = delete;
+  SharedMemoryRingWriter& operator=(const SharedMemoryRingWriter&) = delete;
+  ~SharedMemoryRingWriter();
+
+  // Returns false if the ring could not be mapped.
+  bool IsValid() const { return !!control_; }
+
+  // Returns the size of the largest message the ring accepts.
+  size_t max_message_size() const;
+
+  // Appends a copy of a serialized pickle to the ring and wakes up the reader
+  // if needed. Returns false if the ring is too full, in which case nothing
+  // is written, or if the message is larger than max_message_size() or too
+  // small to be a pickle. The pickles must not carry attachments.
+  bool Write(const Pickle& pickle) WARN_UNUSED_RESULT;
+  bool Write(SegmentedPickle* pickle) WARN_UNUSED_RESULT;
+  bool Write(const void* data, size_t size) WARN_UNUSED_RESULT;
+
+ private:
+  // Reserves room for a record of |size| bytes of message and returns where
+  // the message goes, or null if the ring is too full.
+  char* BeginRecord(size_t size);
+  void CommitRecord(size_t size);
+
+  WritableSharedMemoryMapping mapping_;
+  win::ScopedHandle doorbell_;
+  internal::SharedMemoryRingControl* control_ = nullptr;
+  char* buffer_ = nullptr;
+  size_t capacity_ = 0;
+
+  // Private copies of the shared positions. |read_pos_| is only refreshed
+  // from shared memory when the ring looks full.
+  uint64_t write_pos_ = 0;
+  uint64_t read_pos_ = 0;
+};
+
+// The consuming end of a SharedMemoryRing. Only one reader may be attached to
+// a ring, and it must be used from one thread at a time.
+//
+// Messages are validated before they are handed out, but the views point into
+// memory the writer can still scribble on. When the writer is less trusted
+// than the reader, copy what is read before acting on it.
+class WINBASE_EXPORT SharedMemoryRingReader {
+ public:
+  explicit SharedMemoryRingReader(SharedMemoryRing ring);
+  SharedMemoryRingReader(const SharedMemoryRingReader&) = delete;
+  SharedMemoryRingReader& operator=(const SharedMemoryRingReader&) = delete;
+  ~SharedMemoryRingReader();
+
+  // Returns false if the ring could not be mapped.
+  bool IsValid() const { return !!control_; }
+
+  // Returns true if the writer broke the ring protocol; Peek() fails from
+  // then on.
+  bool HasError() const { return has_error_; }
+
+  // Returns true if a message is ready to be read. Never blocks.
+  bool HasMessage() const;
+
+  // Blocks until a message is ready or |timeout| has elapsed, and returns
+  // HasMessage(). Spins briefly before going to sleep on the doorbell.
+  bool Wait(TimeDelta timeout);
+
+  // Stores a view of the oldest message in |*view| without removing it from
+  // the ring. The view stays valid until Pop(). Returns false if the ring is
+  // empty or holds a malformed message.
+  bool Peek(PickleView* view) WARN_UNUSED_RESULT;
+
+  // Removes the message returned by the last successful Peek(), handing its
+  // space back to the writer.
+  void Pop();
+
+ private:
+  WritableSharedMemoryMapping mapping_;
+  win::ScopedHandle doorbell_;
+  internal::SharedMemoryRingControl* control_ = nullptr;
+  const char* buffer_ = nullptr;
+  size_t capacity_ = 0;
+
+  uint64_t read_pos_ = 0;
+  // Size of the record returned by Peek(), or 0.
+  size_t peeked_size_ = 0;
+  bool has_error_ = false;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_IPC_SHARED_MEMORY_RING_H_
\ No newline at end of file
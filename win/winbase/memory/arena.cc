@@ -0,0 +1,126 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\arena.h"
+
+#include <stdlib.h>
+
+#include "winbase\no_destructor.h"
+#include "winbase\threading\thread_local.h"
+
+namespace winbase {
+
+namespace {
+
+ThreadLocalPointer<Arena>* GetTLSCurrentArena() {
+  static NoDestructor<ThreadLocalPointer<Arena>> lazy_tls_ptr;
+  return lazy_tls_ptr.get();
+}
+
+// Allocations larger than this fraction of the block size get a block of
+// their own, so that they do not waste the rest of the current block.
+constexpr size_t kLargeAllocationDivisor = 4;
+
+}  // namespace
+
+struct Arena::Block {
+  Block* next;
+  size_t size;
+
+  uintptr_t begin() { return reinterpret_cast<uintptr_t>(this + 1); }
+  uintptr_t end() { return begin() + size; }
+};
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {
+  WINBASE_DCHECK_GT(block_size_, 0u);
+}
+
+Arena::~Arena() {
+  FreeBlocks();
+}
+
+// static
+Arena* Arena::Current() {
+  return GetTLSCurrentArena()->Get();
+}
+
+void Arena::Reset() {
+  size_t used = std::max(round_peak_, bytes_allocated_);
+  high_water_mark_ = std::max(high_water_mark_, used);
+  bytes_allocated_ = 0;
+  round_peak_ = 0;
+  if (!blocks_)
+    return;
+
+  if (!blocks_->next) {
+    ptr_ = blocks_->begin();
+    return;
+  }
+
+  // The last round spilled over several blocks. Replace them with a single
+  // block that fits it.
+  FreeBlocks();
+  size_t size = (used + block_size_ - 1) / block_size_ * block_size_;
+  size = std::max(block_size_, std::min(size, kMaxRetainedSize));
+  blocks_ = NewBlock(size);
+  ptr_ = blocks_->begin();
+  limit_ = blocks_->end();
+}
+
+void* Arena::AllocateSlow(size_t size, size_t alignment) {
+  // Enough room to align the result anywhere in the block.
+  size_t needed = size + alignment - 1;
+  WINBASE_CHECK(needed >= size);
+
+  Block* block = NewBlock(std::max(needed, block_size_));
+  uintptr_t result = (block->begin() + alignment - 1) & ~(alignment - 1);
+
+  if (blocks_ && needed > block_size_ / kLargeAllocationDivisor) {
+    // Keep bumping in the current block.
+    block->next = blocks_->next;
+    blocks_->next = block;
+  } else {
+    block->next = blocks_;
+    blocks_ = block;
+    ptr_ = result + size;
+    limit_ = block->end();
+  }
+
+  bytes_allocated_ += size;
+  return reinterpret_cast<void*>(result);
+}
+
+Arena::Block* Arena::NewBlock(size_t size) {
+  static_assert(sizeof(Block) % alignof(std::max_align_t) == 0,
+                "Block headers must keep the payload aligned");
+  WINBASE_CHECK(size <= std::numeric_limits<size_t>::max() - sizeof(Block));
+  Block* block = static_cast<Block*>(malloc(sizeof(Block) + size));
+  WINBASE_CHECK(block);
+  block->next = nullptr;
+  block->size = size;
+  bytes_reserved_ += size;
+  return block;
+}
+
+void Arena::FreeBlocks() {
+  while (blocks_) {
+    Block* next = blocks_->next;
+    free(blocks_);
+    blocks_ = next;
+  }
+  ptr_ = 0;
+  limit_ = 0;
+  bytes_reserved_ = 0;
+}
+
+ScopedCurrentArena::ScopedCurrentArena(Arena* arena)
+    : previous_(Arena::Current()) {
+  GetTLSCurrentArena()->Set(arena);
+}
+
+ScopedCurrentArena::~ScopedCurrentArena() {
+  GetTLSCurrentArena()->Set(previous_);
+}
+
+}  // namespace winbase
\ No newline at end of file
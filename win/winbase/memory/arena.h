@@ -0,0 +1,227 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A bump-pointer arena for short-lived scratch allocations.
+//
+// Allocating from an Arena only advances a pointer inside the current block;
+// individual allocations are never freed. Everything is released at once by
+// Reset(), which keeps the memory around for the next round of allocations.
+//
+// MessageLoop owns one Arena and makes it the current arena of its thread while
+// a task runs, then resets it once the task returns. Task code can therefore
+// build temporary strings, vectors and maps without touching the heap:
+//
+//   void Task::Run() {
+//     winbase::ArenaString name;               // Uses Arena::Current().
+//     winbase::ArenaVector<int> ids;
+//     winbase::ArenaFlatMap<int, int> counts;
+//     ...
+//   }  // Nothing is freed here; the loop resets the arena after the task.
+//
+// ArenaAllocator binds to Arena::Current() when constructed and falls back to
+// the heap when there is no current arena, so the same code also works outside
+// of a MessageLoop task. Containers using an arena must not outlive the scope
+// that made it current (for MessageLoop, the task): never store them in an
+// object that survives the task or move them into a callback.
+//
+// An Arena is not thread-safe and must only be used on one thread at a time.
+
+#ifndef WINLIB_WINBASE_MEMORY_ARENA_H_
+#define WINLIB_WINBASE_MEMORY_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\containers\flat_map.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+
+class WINBASE_EXPORT Arena {
+ public:
+  // Size of the blocks allocated when the current one is exhausted.
+  static constexpr size_t kDefaultBlockSize = 16 * 1024;
+
+  // Reset() keeps up to this many bytes around for the next round.
+  static constexpr size_t kMaxRetainedSize = 1024 * 1024;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize);
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena();
+
+  // Returns the arena made current on this thread by ScopedCurrentArena, or
+  // null if there is none.
+  static Arena* Current();
+
+  // Returns |size| bytes aligned to |alignment|, which must be a power of two.
+  // The memory is valid until the next Reset(). The result is never null, even
+  // for a |size| of 0.
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    WINBASE_DCHECK(alignment && !(alignment & (alignment - 1)));
+    uintptr_t result = (ptr_ + alignment - 1) & ~(alignment - 1);
+    // Aligning may overflow, or step past |limit_| since blocks have any size.
+    // Before the first block, |ptr_| and |limit_| are null and only a size of
+    // 0 fits; let the slow path allocate a block for it too.
+    if (LIKELY(result >= ptr_ && result <= limit_ && size <= limit_ - result &&
+               result)) {
+      ptr_ = result + size;
+      bytes_allocated_ += size;
+      return reinterpret_cast<void*>(result);
+    }
+    return AllocateSlow(size, alignment);
+  }
+
+  // Returns uninitialized storage for |count| objects of type T.
+  template <typename T>
+  T* AllocateArray(size_t count) {
+    WINBASE_CHECK(count <= std::numeric_limits<size_t>::max() / sizeof(T));
+    return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  // Gives back |size| bytes at |ptr|, which must come from Allocate(). The
+  // memory is only reused if it was the most recent allocation, which makes
+  // growing or popping the last container cheap; otherwise this is a no-op.
+  void Free(void* ptr, size_t size) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+    if (address + size == ptr_) {
+      // Remember the peak this undoes, for high_water_mark() and Reset().
+      round_peak_ = std::max(round_peak_, bytes_allocated_);
+      ptr_ = address;
+      bytes_allocated_ -= size;
+    }
+  }
+
+  // Invalidates every allocation. If the previous round needed more than one
+  // block, the blocks are replaced by a single one large enough to hold it
+  // (capped at kMaxRetainedSize) so that the next round does not spill again.
+  void Reset();
+
+  // Bytes handed out since the last Reset().
+  size_t bytes_allocated() const { return bytes_allocated_; }
+
+  // Largest value bytes_allocated() has reached over the lifetime of the
+  // arena.
+  size_t high_water_mark() const {
+    return std::max(high_water_mark_, std::max(round_peak_, bytes_allocated_));
+  }
+
+  // Bytes currently held in blocks, including unused space.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  struct Block;
+
+  void* AllocateSlow(size_t size, size_t alignment);
+
+  // Allocates a block with |size| usable bytes and links it in |blocks_|.
+  Block* NewBlock(size_t size);
+  void FreeBlocks();
+
+  const size_t block_size_;
+
+  // Most recent block first. The bump pointer always points into the head,
+  // except after a large allocation got a dedicated block.
+  Block* blocks_ = nullptr;
+  uintptr_t ptr_ = 0;
+  uintptr_t limit_ = 0;
+
+  size_t bytes_allocated_ = 0;
+  size_t high_water_mark_ = 0;
+
+  // Largest value of |bytes_allocated_| that a Free() lowered since the last
+  // Reset(). With |bytes_allocated_|, gives the peak of the current round
+  // without tracking it on the Allocate() fast path.
+  size_t round_peak_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+// Makes |arena| the current arena of this thread for the lifetime of the
+// scope, then restores the previous one. Scopes may be nested.
+class WINBASE_EXPORT ScopedCurrentArena {
+ public:
+  explicit ScopedCurrentArena(Arena* arena);
+  ScopedCurrentArena(const ScopedCurrentArena&) = delete;
+  ScopedCurrentArena& operator=(const ScopedCurrentArena&) = delete;
+  ~ScopedCurrentArena();
+
+ private:
+  Arena* const previous_;
+};
+
+// STL allocator drawing from an Arena. Default-constructed allocators bind to
+// Arena::Current(), or to the heap if there is none. Deallocation is a no-op
+// unless the block is the arena's most recent allocation.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() noexcept : arena_(Arena::Current()) {}
+  explicit ArenaAllocator(Arena* arena) noexcept : arena_(arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t count) {
+    if (!arena_) {
+      WINBASE_CHECK(count <= std::numeric_limits<size_t>::max() / sizeof(T));
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    return arena_->AllocateArray<T>(count);
+  }
+
+  void deallocate(T* ptr, size_t count) {
+    if (!arena_) {
+      ::operator delete(ptr);
+      return;
+    }
+    arena_->Free(ptr, count * sizeof(T));
+  }
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+using ArenaString =
+    std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+using ArenaWString =
+    std::basic_string<wchar_t, std::char_traits<wchar_t>,
+                      ArenaAllocator<wchar_t>>;
+
+template <class Key, class Mapped, class Compare = std::less<>>
+using ArenaFlatMap =
+    flat_map<Key, Mapped, Compare, ArenaVector<std::pair<Key, Mapped>>>;
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_ARENA_H_
\ No newline at end of file
@@ -0,0 +1,244 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\epoch_reclaimer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+#include "winbase\no_destructor.h"
+
+namespace winbase {
+
+namespace {
+
+// The low bit of ThreadRecord::state tells whether the thread is inside a
+// critical region; the remaining bits hold the epoch it observed on entry.
+constexpr uint64_t kActiveBit = 1;
+
+// Number of Retire() calls between two attempts to advance the epoch and free
+// the limbo list. Amortizes the scan of every thread record.
+constexpr size_t kRetiresPerCollect = 64;
+
+}  // namespace
+
+// Padded to a cache line so that threads publishing their epoch do not
+// invalidate each other's records.
+struct ALIGNAS(64) EpochReclaimer::ThreadRecord {
+  explicit ThreadRecord(EpochReclaimer* owner) : owner(owner) {}
+
+  EpochReclaimer* const owner;
+
+  // Written by the owning thread only, read by threads advancing the epoch.
+  std::atomic<uint64_t> state{0};
+
+  // False once the owning thread has exited and the record may be reused.
+  std::atomic<bool> in_use{true};
+
+  // Immutable once the record is published in |records_|.
+  ThreadRecord* next = nullptr;
+
+  // Accessed by the owning thread only.
+  int nesting = 0;
+  size_t retires_since_collect = 0;
+  std::vector<RetiredObject> limbo;
+};
+
+EpochReclaimer::EpochReclaimer() : tls_record_(&OnThreadExitThunk) {}
+
+EpochReclaimer::~EpochReclaimer() {
+  ThreadRecord* record = records_.load(std::memory_order_acquire);
+  while (record) {
+    WINBASE_DCHECK_EQ(0, record->nesting);
+    for (const RetiredObject& retired : record->limbo)
+      retired.deleter(retired.object);
+    ThreadRecord* next = record->next;
+    delete record;
+    record = next;
+  }
+  for (const RetiredObject& retired : orphans_)
+    retired.deleter(retired.object);
+}
+
+// static
+EpochReclaimer* EpochReclaimer::GetDefault() {
+  static NoDestructor<EpochReclaimer> reclaimer;
+  return reclaimer.get();
+}
+
+void EpochReclaimer::Enter() {
+  ThreadRecord* record = GetOrCreateRecord();
+  if (record->nesting++ > 0)
+    return;
+
+  uint64_t epoch = global_epoch_.load(std::memory_order_relaxed);
+  record->state.store((epoch << 1) | kActiveBit, std::memory_order_relaxed);
+  // Publishing the epoch must be visible to TryAdvance() before any pointer is
+  // loaded from the protected structure.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void EpochReclaimer::Exit() {
+  ThreadRecord* record = GetRecord();
+  WINBASE_DCHECK(record);
+  WINBASE_DCHECK_GT(record->nesting, 0);
+  if (--record->nesting > 0)
+    return;
+
+  uint64_t state = record->state.load(std::memory_order_relaxed);
+  record->state.store(state & ~kActiveBit, std::memory_order_release);
+}
+
+bool EpochReclaimer::InCriticalRegion() const {
+  ThreadRecord* record = GetRecord();
+  return record && record->nesting > 0;
+}
+
+void EpochReclaimer::Retire(void* object, Deleter deleter) {
+  WINBASE_DCHECK(object);
+  WINBASE_DCHECK(deleter);
+  ThreadRecord* record = GetOrCreateRecord();
+
+  // The stamp must be read after |object| was unlinked, so that any thread
+  // that could still see it entered at this epoch or earlier.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t epoch = global_epoch_.load(std::memory_order_relaxed);
+  record->limbo.push_back({object, deleter, epoch});
+
+  if (++record->retires_since_collect < kRetiresPerCollect)
+    return;
+  record->retires_since_collect = 0;
+  uint64_t global_epoch = TryAdvance();
+  Collect(&record->limbo, global_epoch);
+  // Orphans only become safe as the epoch advances, so only look at them then.
+  if (global_epoch != epoch)
+    CollectOrphans(global_epoch);
+}
+
+void EpochReclaimer::Flush() {
+  // Two successful advances make everything retired so far safe.
+  TryAdvance();
+  uint64_t epoch = TryAdvance();
+  ThreadRecord* record = GetRecord();
+  if (record)
+    Collect(&record->limbo, epoch);
+  CollectOrphans(epoch);
+}
+
+void EpochReclaimer::CollectOrphans(uint64_t global_epoch) {
+  // Deleters may retire more objects, so never run them under the lock.
+  std::vector<RetiredObject> orphans;
+  {
+    AutoLock auto_lock(orphans_lock_);
+    orphans.swap(orphans_);
+  }
+  if (orphans.empty())
+    return;
+  Collect(&orphans, global_epoch);
+  if (orphans.empty())
+    return;
+  AutoLock auto_lock(orphans_lock_);
+  orphans_.insert(orphans_.end(), orphans.begin(), orphans.end());
+}
+
+EpochReclaimer::ThreadRecord* EpochReclaimer::GetOrCreateRecord() {
+  ThreadRecord* record = GetRecord();
+  if (LIKELY(record))
+    return record;
+
+  // Reuse the record of an exited thread if there is one.
+  for (ThreadRecord* candidate = records_.load(std::memory_order_acquire);
+       candidate; candidate = candidate->next) {
+    bool in_use = false;
+    if (!candidate->in_use.load(std::memory_order_relaxed) &&
+        candidate->in_use.compare_exchange_strong(
+            in_use, true, std::memory_order_acquire,
+            std::memory_order_relaxed)) {
+      record = candidate;
+      break;
+    }
+  }
+
+  if (!record) {
+    record = new ThreadRecord(this);
+    record->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(record->next, record,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  tls_record_.Set(record);
+  return record;
+}
+
+EpochReclaimer::ThreadRecord* EpochReclaimer::GetRecord() const {
+  return static_cast<ThreadRecord*>(tls_record_.Get());
+}
+
+uint64_t EpochReclaimer::TryAdvance() {
+  uint64_t epoch = global_epoch_.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  for (ThreadRecord* record = records_.load(std::memory_order_acquire); record;
+       record = record->next) {
+    uint64_t state = record->state.load(std::memory_order_relaxed);
+    if ((state & kActiveBit) && (state >> 1) != epoch)
+      return epoch;
+  }
+
+  // Every thread inside a critical region has observed |epoch|. Synchronize
+  // with their exits before declaring epoch - 1 retirements safe.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (global_epoch_.compare_exchange_strong(epoch, epoch + 1,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+    return epoch + 1;
+  }
+  // Another thread advanced first; |epoch| now holds the current value.
+  return epoch;
+}
+
+// static
+void EpochReclaimer::Collect(std::vector<RetiredObject>* limbo,
+                             uint64_t global_epoch) {
+  auto first_ready = std::partition(
+      limbo->begin(), limbo->end(), [global_epoch](const RetiredObject& r) {
+        return r.epoch + 2 > global_epoch;
+      });
+  if (first_ready == limbo->end())
+    return;
+
+  // Deleters may call Retire() and grow |limbo|, so detach the ready objects
+  // before running them.
+  std::vector<RetiredObject> ready(first_ready, limbo->end());
+  limbo->erase(first_ready, limbo->end());
+  for (const RetiredObject& retired : ready)
+    retired.deleter(retired.object);
+}
+
+void EpochReclaimer::OnThreadExit(ThreadRecord* record) {
+  WINBASE_DCHECK_EQ(0, record->nesting);
+  Collect(&record->limbo, TryAdvance());
+
+  if (!record->limbo.empty()) {
+    AutoLock auto_lock(orphans_lock_);
+    orphans_.insert(orphans_.end(), record->limbo.begin(),
+                    record->limbo.end());
+  }
+  std::vector<RetiredObject>().swap(record->limbo);
+  record->retires_since_collect = 0;
+  record->state.store(0, std::memory_order_relaxed);
+  record->in_use.store(false, std::memory_order_release);
+}
+
+// static
+void EpochReclaimer::OnThreadExitThunk(void* record) {
+  ThreadRecord* thread_record = static_cast<ThreadRecord*>(record);
+  thread_record->owner->OnThreadExit(thread_record);
+}
+
+}  // namespace winbase
\ No newline at end of file
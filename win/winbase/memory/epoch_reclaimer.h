@@ -0,0 +1,164 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Epoch-based memory reclamation for lock-free data structures.
+//
+// A lock-free structure cannot delete a node as soon as it unlinks it: another
+// thread may have loaded a pointer to the node just before it was unlinked and
+// still be dereferencing it. EpochReclaimer defers such deletions until every
+// thread that could possibly hold a reference has moved on.
+//
+// Readers and writers bracket each access to the shared structure with an
+// AutoEpoch (or Enter()/Exit()). Entering a critical region only publishes the
+// current global epoch into a per-thread record, so it is cheap. Nodes that
+// have been unlinked are handed to Retire(); they are stamped with the global
+// epoch and appended to a per-thread limbo list. The global epoch only advances
+// once every thread inside a critical region has observed it, so an object
+// retired at epoch E is unreachable by anyone once the global epoch reaches
+// E + 2, at which point it is freed by the thread that retired it.
+//
+// Example:
+//   winbase::EpochReclaimer* reclaimer = winbase::EpochReclaimer::GetDefault();
+//
+//   Node* Stack::Pop() {
+//     winbase::AutoEpoch epoch(reclaimer);
+//     Node* head = head_.load(std::memory_order_acquire);
+//     while (head && !head_.compare_exchange_weak(head, head->next)) {}
+//     if (head)
+//       reclaimer->Retire(head);  // Not deleted until it is safe.
+//     return head;
+//   }
+//
+// Each thread registers lazily on its first Enter() or Retire(). Thread
+// records are owned by a ThreadLocalStorage::Slot, so when a thread exits its
+// limbo list is flushed: whatever can be freed is freed, and the rest is handed
+// over to the reclaimer and freed by the next thread whose periodic collection
+// in Retire() advances the epoch, or by Flush().
+//
+// An EpochReclaimer must outlive every thread that uses it. Prefer the
+// process-wide instance returned by GetDefault().
+
+#ifndef WINLIB_WINBASE_MEMORY_EPOCH_RECLAIMER_H_
+#define WINLIB_WINBASE_MEMORY_EPOCH_RECLAIMER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\synchronization\lock.h"
+#include "winbase\threading\thread_local_storage.h"
+
+namespace winbase {
+
+class WINBASE_EXPORT EpochReclaimer {
+ public:
+  // Function used to free a retired object.
+  typedef void (*Deleter)(void* object);
+
+  EpochReclaimer();
+  EpochReclaimer(const EpochReclaimer&) = delete;
+  EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+  // Frees every object still pending. No thread may be inside a critical
+  // region of this reclaimer, or use it afterwards.
+  ~EpochReclaimer();
+
+  // Returns the process-wide reclaimer. It is never destroyed.
+  static EpochReclaimer* GetDefault();
+
+  // Enters/exits a critical region on the current thread. Critical regions may
+  // be nested; only the outermost pair publishes anything. Pointers loaded from
+  // a structure protected by this reclaimer are valid until the matching
+  // Exit().
+  void Enter();
+  void Exit();
+
+  // Returns true if the current thread is inside a critical region.
+  bool InCriticalRegion() const;
+
+  // Schedules |object| to be freed with |deleter| once no thread can still be
+  // referencing it. |object| must already be unreachable for threads entering
+  // a critical region from now on.
+  void Retire(void* object, Deleter deleter);
+
+  template <typename T>
+  void Retire(T* object) {
+    Retire(object, &DeleteObject<T>);
+  }
+
+  // Tries to advance the global epoch and frees whatever the current thread
+  // (and exited threads) retired that has become safe. Objects may remain
+  // pending if other threads are still inside older critical regions.
+  void Flush();
+
+ private:
+  struct ThreadRecord;
+
+  struct RetiredObject {
+    void* object;
+    Deleter deleter;
+    uint64_t epoch;
+  };
+
+  template <typename T>
+  static void DeleteObject(void* object) {
+    delete static_cast<T*>(object);
+  }
+
+  // Returns the record of the current thread, registering it if needed.
+  ThreadRecord* GetOrCreateRecord();
+  ThreadRecord* GetRecord() const;
+
+  // Advances the global epoch if every active thread has observed it. Returns
+  // the global epoch after the attempt.
+  uint64_t TryAdvance();
+
+  // Frees the objects of |limbo| that are safe at |global_epoch|.
+  static void Collect(std::vector<RetiredObject>* limbo, uint64_t global_epoch);
+
+  // Frees the objects left behind by exited threads that are safe at
+  // |global_epoch|.
+  void CollectOrphans(uint64_t global_epoch);
+
+  // Collects |record| and releases it after its thread has exited.
+  void OnThreadExit(ThreadRecord* record);
+  static void OnThreadExitThunk(void* record);
+
+  std::atomic<uint64_t> global_epoch_{0};
+
+  // Singly linked list of every record ever registered. Records are never
+  // unlinked; a record released by an exiting thread is reused by the next
+  // thread that registers.
+  std::atomic<ThreadRecord*> records_{nullptr};
+
+  // Objects left behind by exited threads that were not yet safe to free.
+  Lock orphans_lock_;
+  std::vector<RetiredObject> orphans_;
+
+  ThreadLocalStorage::Slot tls_record_;
+};
+
+// Enters a critical region of |reclaimer| for the lifetime of the scope.
+class AutoEpoch {
+ public:
+  explicit AutoEpoch(EpochReclaimer* reclaimer = EpochReclaimer::GetDefault())
+      : reclaimer_(reclaimer) {
+    reclaimer_->Enter();
+  }
+
+  ~AutoEpoch() { reclaimer_->Exit(); }
+
+  AutoEpoch(const AutoEpoch&) = delete;
+  AutoEpoch& operator=(const AutoEpoch&) = delete;
+
+ private:
+  EpochReclaimer* const reclaimer_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_EPOCH_RECLAIMER_H_
\ No newline at end of file
@@ -0,0 +1,184 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\object_pool.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+
+namespace winbase {
+namespace internal {
+
+// Padded to a cache line so that shards locked by different threads do not
+// share one.
+struct ALIGNAS(64) ObjectPoolBase::DepotShard {
+  Lock lock;
+  std::vector<void*> objects;
+
+  // The number of objects the shard may hold. The capacities of the shards
+  // add up to |max_idle_objects|.
+  size_t capacity = 0;
+};
+
+struct ObjectPoolBase::ThreadCache {
+  ThreadCache(ObjectPoolBase* pool, size_t shard)
+      : pool(pool), shard(shard) {}
+
+  ObjectPoolBase* const pool;
+
+  // Depot shard this thread refills from and drains to.
+  const size_t shard;
+
+  size_t count = 0;
+  void* objects[kThreadCacheSize];
+
+  // Links in |pool->caches_|, guarded by |pool->caches_lock_|.
+  ThreadCache* prev = nullptr;
+  ThreadCache* next = nullptr;
+};
+
+ObjectPoolBase::ObjectPoolBase(size_t max_idle_objects,
+                               DeleteFunction delete_function)
+    : delete_function_(delete_function),
+      thread_cache_size_(std::min(max_idle_objects, kThreadCacheSize)),
+      depot_(new DepotShard[kDepotShards]),
+      tls_cache_(&OnThreadExitThunk) {
+  WINBASE_DCHECK(delete_function_);
+  for (size_t i = 0; i < kDepotShards; ++i) {
+    depot_[i].capacity = max_idle_objects / kDepotShards +
+                         (i < max_idle_objects % kDepotShards ? 1 : 0);
+  }
+}
+
+ObjectPoolBase::~ObjectPoolBase() {
+  AutoLock auto_lock(caches_lock_);
+  while (caches_) {
+    ThreadCache* next = caches_->next;
+    for (size_t i = 0; i < caches_->count; ++i)
+      delete_function_(caches_->objects[i]);
+    delete caches_;
+    caches_ = next;
+  }
+  for (size_t i = 0; i < kDepotShards; ++i) {
+    for (void* object : depot_[i].objects)
+      delete_function_(object);
+  }
+}
+
+void* ObjectPoolBase::Get() {
+  ThreadCache* cache = GetOrCreateCache();
+  if (UNLIKELY(!cache->count)) {
+    Refill(cache);
+    if (!cache->count)
+      return nullptr;
+  }
+  return cache->objects[--cache->count];
+}
+
+void ObjectPoolBase::Put(void* object) {
+  WINBASE_DCHECK(object);
+  if (UNLIKELY(!thread_cache_size_)) {
+    delete_function_(object);
+    return;
+  }
+
+  ThreadCache* cache = GetOrCreateCache();
+  if (UNLIKELY(cache->count == thread_cache_size_))
+    Drain(cache, (thread_cache_size_ + 1) / 2);
+  cache->objects[cache->count++] = object;
+}
+
+void ObjectPoolBase::Trim() {
+  ThreadCache* cache = static_cast<ThreadCache*>(tls_cache_.Get());
+  if (cache) {
+    for (size_t i = 0; i < cache->count; ++i)
+      delete_function_(cache->objects[i]);
+    cache->count = 0;
+  }
+
+  for (size_t i = 0; i < kDepotShards; ++i) {
+    std::vector<void*> objects;
+    {
+      AutoLock auto_lock(depot_[i].lock);
+      objects.swap(depot_[i].objects);
+    }
+    for (void* object : objects)
+      delete_function_(object);
+  }
+}
+
+ObjectPoolBase::ThreadCache* ObjectPoolBase::GetOrCreateCache() {
+  ThreadCache* cache = static_cast<ThreadCache*>(tls_cache_.Get());
+  if (LIKELY(cache))
+    return cache;
+
+  AutoLock auto_lock(caches_lock_);
+  // Spread threads over the shards in creation order.
+  cache = new ThreadCache(this, next_shard_++ % kDepotShards);
+  cache->next = caches_;
+  if (caches_)
+    caches_->prev = cache;
+  caches_ = cache;
+  tls_cache_.Set(cache);
+  return cache;
+}
+
+void ObjectPoolBase::Refill(ThreadCache* cache) {
+  const size_t wanted = std::max<size_t>(thread_cache_size_ / 2, 1);
+  // Start with the thread's own shard, then look at the others.
+  for (size_t i = 0; i < kDepotShards && !cache->count; ++i) {
+    DepotShard& shard = depot_[(cache->shard + i) % kDepotShards];
+    AutoLock auto_lock(shard.lock);
+    size_t count = std::min(wanted, shard.objects.size());
+    std::copy(shard.objects.end() - count, shard.objects.end(),
+              cache->objects + cache->count);
+    shard.objects.resize(shard.objects.size() - count);
+    cache->count += count;
+  }
+}
+
+void ObjectPoolBase::Drain(ThreadCache* cache, size_t count) {
+  WINBASE_DCHECK_LE(count, cache->count);
+  void** first = cache->objects + cache->count - count;
+  void** last = cache->objects + cache->count;
+  cache->count -= count;
+
+  DepotShard& shard = depot_[cache->shard];
+  {
+    AutoLock auto_lock(shard.lock);
+    size_t room =
+        shard.capacity - std::min(shard.capacity, shard.objects.size());
+    size_t kept = std::min(room, count);
+    shard.objects.insert(shard.objects.end(), first, first + kept);
+    first += kept;
+  }
+  // The depot is full; destroy the rest outside of the lock.
+  for (; first != last; ++first)
+    delete_function_(*first);
+}
+
+void ObjectPoolBase::OnThreadExit(ThreadCache* cache) {
+  Drain(cache, cache->count);
+
+  AutoLock auto_lock(caches_lock_);
+  if (cache->prev)
+    cache->prev->next = cache->next;
+  else
+    caches_ = cache->next;
+  if (cache->next)
+    cache->next->prev = cache->prev;
+  delete cache;
+}
+
+// static
+void ObjectPoolBase::OnThreadExitThunk(void* cache) {
+  ThreadCache* thread_cache = static_cast<ThreadCache*>(cache);
+  thread_cache->pool->OnThreadExit(thread_cache);
+}
+
+}  // namespace internal
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,175 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ObjectPool<T> recycles objects that are expensive to create or that own
+// buffers worth keeping, such as PendingTask nodes, Pickle buffers or IO
+// contexts.
+//
+// Idle objects are kept in small per-thread caches, so that a thread acquiring
+// and releasing objects never synchronizes with other threads. When a cache
+// runs empty it refills with a batch from a shared depot, and when it fills up
+// it moves half of its objects there. The depot is split into shards with a
+// lock each, and every thread cache is tied to one shard, so objects released
+// on threads other than the one that acquired them do not all contend on a
+// single lock.
+//
+// Example:
+//   struct PicklePoolTraits : winbase::DefaultObjectPoolTraits<Pickle> {
+//     static void Recycle(Pickle* pickle) { pickle->Clear(); }
+//   };
+//   winbase::ObjectPool<Pickle, PicklePoolTraits> pool;
+//
+//   void Send() {
+//     winbase::ObjectPool<Pickle, PicklePoolTraits>::Handle pickle =
+//         pool.Acquire();
+//     pickle->WriteInt(42);
+//     ...
+//   }  // |pickle| goes back to the pool.
+//
+// The pool may retain at most |max_idle_objects| objects in its depot, plus
+// up to kThreadCacheSize objects per thread cache; objects released beyond
+// that are destroyed. Objects are created on demand, so the number of objects
+// in use is not bounded.
+//
+// A pool may be used from any thread. It must outlive every Handle it gave
+// out and every thread that used it must be done with it before it is
+// destroyed. Each pool takes one of the 256 ThreadLocalStorage slots of the
+// process for its thread caches, so pools are meant to be long-lived and
+// shared, typically one per type of object; never create one per object.
+
+#ifndef WINLIB_WINBASE_MEMORY_OBJECT_POOL_H_
+#define WINLIB_WINBASE_MEMORY_OBJECT_POOL_H_
+
+#include <stddef.h>
+
+#include <limits>
+#include <memory>
+
+#include "winbase\base_export.h"
+#include "winbase\synchronization\lock.h"
+#include "winbase\threading\thread_local_storage.h"
+
+namespace winbase {
+
+// Default traits for ObjectPool<T>. New objects are default-constructed and
+// released objects are reused as they are. Override Recycle() to clear an
+// object before it goes back to the pool.
+template <typename T>
+struct DefaultObjectPoolTraits {
+  static T* New() { return new T(); }
+  static void Recycle(T* object) {}
+  static void Delete(T* object) { delete object; }
+};
+
+namespace internal {
+
+// Type-erased implementation of ObjectPool<T>.
+class WINBASE_EXPORT ObjectPoolBase {
+ public:
+  typedef void (*DeleteFunction)(void* object);
+
+  // Number of idle objects a thread cache can hold.
+  static constexpr size_t kThreadCacheSize = 32;
+
+  // Number of depot shards.
+  static constexpr size_t kDepotShards = 8;
+
+  ObjectPoolBase(size_t max_idle_objects, DeleteFunction delete_function);
+  ObjectPoolBase(const ObjectPoolBase&) = delete;
+  ObjectPoolBase& operator=(const ObjectPoolBase&) = delete;
+  ~ObjectPoolBase();
+
+  // Returns an idle object, or null if the pool has none.
+  void* Get();
+
+  // Hands |object| back to the pool, which destroys it if it is full.
+  void Put(void* object);
+
+  // Destroys the idle objects of the depot and of the current thread's cache.
+  void Trim();
+
+ private:
+  struct ThreadCache;
+  struct DepotShard;
+
+  ThreadCache* GetOrCreateCache();
+
+  // Moves up to kThreadCacheSize / 2 objects from the depot to |cache|.
+  void Refill(ThreadCache* cache);
+
+  // Moves the |count| most recent objects of |cache| to the depot.
+  void Drain(ThreadCache* cache, size_t count);
+
+  void OnThreadExit(ThreadCache* cache);
+  static void OnThreadExitThunk(void* cache);
+
+  const DeleteFunction delete_function_;
+  const size_t thread_cache_size_;
+
+  std::unique_ptr<DepotShard[]> depot_;
+
+  // Every live thread cache, so that the destructor can free their objects.
+  Lock caches_lock_;
+  ThreadCache* caches_ = nullptr;
+  size_t next_shard_ = 0;
+
+  ThreadLocalStorage::Slot tls_cache_;
+};
+
+}  // namespace internal
+
+template <typename T, typename Traits = DefaultObjectPoolTraits<T>>
+class ObjectPool {
+ public:
+  // Returns objects to the pool they were acquired from.
+  class Releaser {
+   public:
+    Releaser() = default;
+    explicit Releaser(ObjectPool* pool) : pool_(pool) {}
+
+    void operator()(T* object) const { pool_->Release(object); }
+
+   private:
+    ObjectPool* pool_ = nullptr;
+  };
+
+  using Handle = std::unique_ptr<T, Releaser>;
+
+  static constexpr size_t kUnbounded = std::numeric_limits<size_t>::max();
+
+  explicit ObjectPool(size_t max_idle_objects = kUnbounded)
+      : base_(max_idle_objects, &DeleteObject) {}
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+  ~ObjectPool() = default;
+
+  // Returns an idle object, or a new one if there is none. The object goes
+  // back to the pool when the handle is destroyed.
+  Handle Acquire() { return Handle(AcquireRaw(), Releaser(this)); }
+
+  // Like Acquire(), but the caller must hand the object to Release().
+  T* AcquireRaw() {
+    void* object = base_.Get();
+    return object ? static_cast<T*>(object) : Traits::New();
+  }
+
+  void Release(T* object) {
+    Traits::Recycle(object);
+    base_.Put(object);
+  }
+
+  // Destroys the idle objects held by the depot and by this thread's cache.
+  void Trim() { base_.Trim(); }
+
+ private:
+  static void DeleteObject(void* object) {
+    Traits::Delete(static_cast<T*>(object));
+  }
+
+  internal::ObjectPoolBase base_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_OBJECT_POOL_H_
\ No newline at end of file
@@ -0,0 +1,125 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\platform_shared_memory_region.h"
+
+#include <utility>
+
+#include "winbase\logging.h"
+#include "winbase\numerics\safe_conversions.h"
+#include "winbase\pickle.h"
+#include "winbase\win\handle_attachment.h"
+
+namespace winbase {
+namespace subtle {
+
+// static
+PlatformSharedMemoryRegion PlatformSharedMemoryRegion::CreateWritable(
+    size_t size) {
+  return Create(Mode::kWritable, size);
+}
+
+// static
+PlatformSharedMemoryRegion PlatformSharedMemoryRegion::CreateUnsafe(
+    size_t size) {
+  return Create(Mode::kUnsafe, size);
+}
+
+// static
+PlatformSharedMemoryRegion PlatformSharedMemoryRegion::Take(
+    win::ScopedHandle handle,
+    Mode mode,
+    size_t size) {
+  if (!handle.IsValid() || !size)
+    return PlatformSharedMemoryRegion();
+  return PlatformSharedMemoryRegion(std::move(handle), mode, size);
+}
+
+// static
+bool PlatformSharedMemoryRegion::WriteToPickle(
+    Pickle* pickle,
+    PlatformSharedMemoryRegion region) {
+  // Handing out a writable handle would defeat ConvertToReadOnly().
+  if (!region.IsValid() || region.mode_ == Mode::kWritable)
+    return false;
+
+  Mode mode = region.mode_;
+  size_t size = region.size_;
+  if (!pickle->WriteAttachment(
+          MakeRefCounted<win::HandleAttachment>(region.PassPlatformHandle()))) {
+    return false;
+  }
+  pickle->WriteUInt64(size);
+  pickle->WriteInt(static_cast<int>(mode));
+  return true;
+}
+
+// static
+bool PlatformSharedMemoryRegion::ReadFromPickle(
+    const Pickle& pickle,
+    PickleIterator* iter,
+    PlatformSharedMemoryRegion* region) {
+  scoped_refptr<Pickle::Attachment> attachment;
+  if (!pickle.ReadAttachment(iter, &attachment))
+    return false;
+  win::HandleAttachment* handle_attachment =
+      win::HandleAttachment::FromAttachment(attachment.get());
+  if (!handle_attachment)
+    return false;
+
+  uint64_t size;
+  int mode;
+  if (!iter->ReadUInt64(&size) || !iter->ReadInt(&mode))
+    return false;
+  if (!IsValueInRangeForNumericType<size_t>(size) ||
+      (mode != static_cast<int>(Mode::kReadOnly) &&
+       mode != static_cast<int>(Mode::kUnsafe))) {
+    return false;
+  }
+
+  win::ScopedHandle handle = handle_attachment->TakeHandle();
+  if (!handle.IsValid() || !size ||
+      !CheckPlatformHandle(handle.Get(), static_cast<Mode>(mode),
+                           static_cast<size_t>(size))) {
+    return false;
+  }
+  *region = Take(std::move(handle), static_cast<Mode>(mode),
+                 static_cast<size_t>(size));
+  return region->IsValid();
+}
+
+PlatformSharedMemoryRegion::PlatformSharedMemoryRegion() = default;
+
+PlatformSharedMemoryRegion::PlatformSharedMemoryRegion(
+    PlatformSharedMemoryRegion&& other)
+    : handle_(std::move(other.handle_)),
+      mode_(other.mode_),
+      size_(other.size_) {
+  other.size_ = 0;
+}
+
+PlatformSharedMemoryRegion& PlatformSharedMemoryRegion::operator=(
+    PlatformSharedMemoryRegion&& other) {
+  handle_ = std::move(other.handle_);
+  mode_ = other.mode_;
+  size_ = other.size_;
+  other.size_ = 0;
+  return *this;
+}
+
+PlatformSharedMemoryRegion::~PlatformSharedMemoryRegion() = default;
+
+PlatformSharedMemoryRegion::PlatformSharedMemoryRegion(
+    win::ScopedHandle handle,
+    Mode mode,
+    size_t size)
+    : handle_(std::move(handle)), mode_(mode), size_(size) {}
+
+win::ScopedHandle PlatformSharedMemoryRegion::PassPlatformHandle() {
+  size_ = 0;
+  return std::move(handle_);
+}
+
+}  // namespace subtle
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,122 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_MEMORY_PLATFORM_SHARED_MEMORY_REGION_H_
+#define WINLIB_WINBASE_MEMORY_PLATFORM_SHARED_MEMORY_REGION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\win\scoped_handle.h"
+#include "winbase\win\windows_types.h"
+
+namespace winbase {
+
+class Pickle;
+class PickleIterator;
+
+namespace subtle {
+
+// PlatformSharedMemoryRegion owns the platform handle of a shared memory
+// region, an unnamed file mapping backed by the paging file, along with its
+// size and access mode. It is the type-erased implementation behind
+// ReadOnlySharedMemoryRegion, WritableSharedMemoryRegion and
+// UnsafeSharedMemoryRegion, and should only be used directly to convert
+// between them or to transfer a region.
+//
+// The mode is enforced by the access rights of the handle:
+// - kReadOnly handles can only map the region for reading. They can be
+//   duplicated.
+// - kWritable handles can map the region for writing. They cannot be
+//   duplicated, so that a writable region can be converted to a read-only one
+//   with the guarantee that no writable handle is left behind.
+// - kUnsafe handles can map the region for writing and can be duplicated.
+class WINBASE_EXPORT PlatformSharedMemoryRegion {
+ public:
+  enum class Mode {
+    kReadOnly,
+    kWritable,
+    kUnsafe,
+  };
+
+  // Creates a new region of |size| bytes, zero-filled. Returns an invalid
+  // region on failure.
+  static PlatformSharedMemoryRegion CreateWritable(size_t size);
+  static PlatformSharedMemoryRegion CreateUnsafe(size_t size);
+
+  // Takes ownership of |handle|, which must have the access rights matching
+  // |mode| and refer to a region of at least |size| bytes.
+  static PlatformSharedMemoryRegion Take(win::ScopedHandle handle,
+                                         Mode mode,
+                                         size_t size);
+
+  // Moves |region| into |pickle| as a win::HandleAttachment followed by its
+  // size and mode. Returns false if |pickle| does not accept attachments or
+  // |region| is writable; the region is closed in both cases.
+  static bool WriteToPickle(Pickle* pickle, PlatformSharedMemoryRegion region);
+
+  // Reads a region written by WriteToPickle() from |pickle|, which must be
+  // the pickle |iter| reads from. Returns false if the handle does not refer
+  // to a region of the size and mode written along with it.
+  static bool ReadFromPickle(const Pickle& pickle,
+                             PickleIterator* iter,
+                             PlatformSharedMemoryRegion* region)
+      WARN_UNUSED_RESULT;
+
+  // Creates an invalid region.
+  PlatformSharedMemoryRegion();
+  PlatformSharedMemoryRegion(PlatformSharedMemoryRegion&&);
+  PlatformSharedMemoryRegion& operator=(PlatformSharedMemoryRegion&&);
+  PlatformSharedMemoryRegion(const PlatformSharedMemoryRegion&) = delete;
+  PlatformSharedMemoryRegion& operator=(const PlatformSharedMemoryRegion&) =
+      delete;
+  ~PlatformSharedMemoryRegion();
+
+  bool IsValid() const { return handle_.IsValid(); }
+  Mode GetMode() const { return mode_; }
+  size_t GetSize() const { return size_; }
+  HANDLE GetPlatformHandle() const { return handle_.Get(); }
+
+  // Transfers ownership of the handle to the caller and invalidates the
+  // region.
+  win::ScopedHandle PassPlatformHandle();
+
+  // Returns a new region referring to the same memory. The mode must not be
+  // kWritable.
+  PlatformSharedMemoryRegion Duplicate() const;
+
+  // Drops the write access of a kWritable region, which becomes kReadOnly.
+  // Returns false on failure, in which case the region is invalidated.
+  bool ConvertToReadOnly();
+
+  // Turns a kWritable region into a kUnsafe one, which may be duplicated.
+  bool ConvertToUnsafe();
+
+  // Maps |size| bytes of the region starting at |offset|, which must be a
+  // multiple of the allocation granularity, for reading, and also for writing
+  // unless the mode is kReadOnly. Returns null on failure. The view must be
+  // released with UnmapViewOfFile(); see SharedMemoryMapping.
+  void* MapAt(uint64_t offset, size_t size) const;
+
+ private:
+  static PlatformSharedMemoryRegion Create(Mode mode, size_t size);
+
+  // Returns true if |handle| refers to a region of at least |size| bytes and
+  // has exactly the access rights of |mode|: a handle received from another
+  // process is not trusted to match the size and mode sent along with it.
+  static bool CheckPlatformHandle(HANDLE handle, Mode mode, size_t size);
+
+  PlatformSharedMemoryRegion(win::ScopedHandle handle, Mode mode, size_t size);
+
+  win::ScopedHandle handle_;
+  Mode mode_ = Mode::kReadOnly;
+  size_t size_ = 0;
+};
+
+}  // namespace subtle
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_PLATFORM_SHARED_MEMORY_REGION_H_
\ No newline at end of file
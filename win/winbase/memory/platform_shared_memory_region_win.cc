@@ -0,0 +1,180 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\platform_shared_memory_region.h"
+
+#include <windows.h>
+#include <winternl.h>
+
+#include <utility>
+
+#include "winbase\logging.h"
+#include "winbase\numerics\safe_conversions.h"
+#include "winbase\win\windows_version.h"
+
+namespace winbase {
+namespace subtle {
+
+namespace {
+
+// Duplicates |handle| within the current process with |access| rights, or
+// the same rights if |access| is 0.
+HANDLE DuplicateWithAccess(HANDLE handle, DWORD access, DWORD options) {
+  HANDLE process = ::GetCurrentProcess();
+  HANDLE duplicate = nullptr;
+  if (!::DuplicateHandle(process, handle, process, &duplicate, access, FALSE,
+                         options)) {
+    WINBASE_DPLOG(ERROR) << "DuplicateHandle";
+    return nullptr;
+  }
+  return duplicate;
+}
+
+// The rights a kReadOnly handle may carry. Anything else, such as
+// FILE_MAP_WRITE or WRITE_DAC, would let its holder write to the region.
+constexpr DWORD kReadOnlyAccess =
+    FILE_MAP_READ | SECTION_QUERY | READ_CONTROL | SYNCHRONIZE;
+
+typedef LONG(WINAPI* NtQueryObjectFunction)(HANDLE handle,
+                                            OBJECT_INFORMATION_CLASS klass,
+                                            void* information,
+                                            ULONG length,
+                                            ULONG* return_length);
+
+// Gets the access rights |handle| was opened or duplicated with.
+bool GetGrantedAccess(HANDLE handle, DWORD* access) {
+  static const NtQueryObjectFunction nt_query_object =
+      reinterpret_cast<NtQueryObjectFunction>(::GetProcAddress(
+          ::GetModuleHandle(L"ntdll.dll"), "NtQueryObject"));
+  if (!nt_query_object)
+    return false;
+  PUBLIC_OBJECT_BASIC_INFORMATION information;
+  if (nt_query_object(handle, ObjectBasicInformation, &information,
+                      sizeof(information), nullptr) < 0) {
+    return false;
+  }
+  *access = information.GrantedAccess;
+  return true;
+}
+
+}  // namespace
+
+// static
+bool PlatformSharedMemoryRegion::CheckPlatformHandle(HANDLE handle,
+                                                     Mode mode,
+                                                     size_t size) {
+  DWORD access;
+  if (!GetGrantedAccess(handle, &access))
+    return false;
+  switch (mode) {
+    case Mode::kReadOnly:
+      if (!(access & FILE_MAP_READ) || (access & ~kReadOnlyAccess))
+        return false;
+      break;
+    case Mode::kWritable:
+    case Mode::kUnsafe:
+      if ((access & (FILE_MAP_READ | FILE_MAP_WRITE)) !=
+          (FILE_MAP_READ | FILE_MAP_WRITE)) {
+        return false;
+      }
+      break;
+  }
+
+  // Mapping the whole region fails if the handle is not a section or the
+  // section is smaller than |size|.
+  void* memory = ::MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+  if (!memory)
+    return false;
+  ::UnmapViewOfFile(memory);
+  return true;
+}
+
+// static
+PlatformSharedMemoryRegion PlatformSharedMemoryRegion::Create(Mode mode,
+                                                              size_t size) {
+  WINBASE_DCHECK(mode != Mode::kReadOnly);
+  if (!size)
+    return PlatformSharedMemoryRegion();
+
+  // An unnamed mapping backed by the paging file; it is zero-filled and goes
+  // away with its last handle and view.
+  uint64_t size64 = size;
+  win::ScopedHandle mapping(::CreateFileMapping(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), nullptr));
+  if (!mapping.IsValid()) {
+    WINBASE_DPLOG(ERROR) << "CreateFileMapping";
+    return PlatformSharedMemoryRegion();
+  }
+
+  // The creator gets every right on the section, including the right to
+  // change its security descriptor. Keep only what mapping needs.
+  win::ScopedHandle handle(DuplicateWithAccess(
+      mapping.Get(), FILE_MAP_READ | FILE_MAP_WRITE | SECTION_QUERY, 0));
+  if (!handle.IsValid())
+    return PlatformSharedMemoryRegion();
+  return PlatformSharedMemoryRegion(std::move(handle), mode, size);
+}
+
+PlatformSharedMemoryRegion PlatformSharedMemoryRegion::Duplicate() const {
+  if (!IsValid())
+    return PlatformSharedMemoryRegion();
+  WINBASE_CHECK(mode_ != Mode::kWritable)
+      << "Duplicating a writable region is not allowed";
+
+  win::ScopedHandle handle(
+      DuplicateWithAccess(handle_.Get(), 0, DUPLICATE_SAME_ACCESS));
+  if (!handle.IsValid())
+    return PlatformSharedMemoryRegion();
+  return PlatformSharedMemoryRegion(std::move(handle), mode_, size_);
+}
+
+bool PlatformSharedMemoryRegion::ConvertToReadOnly() {
+  if (!IsValid())
+    return false;
+  WINBASE_CHECK(mode_ == Mode::kWritable)
+      << "Only writable regions can be converted to read-only";
+
+  // DUPLICATE_CLOSE_SOURCE closes the writable handle even on failure.
+  handle_.Set(DuplicateWithAccess(handle_.Take(),
+                                  FILE_MAP_READ | SECTION_QUERY,
+                                  DUPLICATE_CLOSE_SOURCE));
+  if (!handle_.IsValid()) {
+    size_ = 0;
+    return false;
+  }
+  mode_ = Mode::kReadOnly;
+  return true;
+}
+
+bool PlatformSharedMemoryRegion::ConvertToUnsafe() {
+  if (!IsValid())
+    return false;
+  WINBASE_CHECK(mode_ == Mode::kWritable)
+      << "Only writable regions can be converted to unsafe";
+  mode_ = Mode::kUnsafe;
+  return true;
+}
+
+void* PlatformSharedMemoryRegion::MapAt(uint64_t offset, size_t size) const {
+  if (!IsValid() || !size)
+    return nullptr;
+  if (offset > size_ || size > size_ - offset)
+    return nullptr;
+  if (offset % win::OSInfo::GetInstance()->allocation_granularity() != 0)
+    return nullptr;
+
+  DWORD access = FILE_MAP_READ;
+  if (mode_ != Mode::kReadOnly)
+    access |= FILE_MAP_WRITE;
+  void* memory = ::MapViewOfFile(handle_.Get(), access,
+                                 static_cast<DWORD>(offset >> 32),
+                                 static_cast<DWORD>(offset), size);
+  if (!memory)
+    WINBASE_DPLOG(ERROR) << "MapViewOfFile";
+  return memory;
+}
+
+}  // namespace subtle
+}  // namespace winbase
\ No newline at end of file
@@ -4,6 +4,11 @@
 
 #include "winbase\memory\ref_counted.h"
 
+#include <limits>
+
+#include "winbase\logging.h"
+#include "winbase\threading\platform_thread.h"
+
 ///#include "winbase\threading\thread_collision_warner.h"
 
 namespace winbase {
@@ -13,6 +18,11 @@ namespace {
 ///std::atomic_int g_cross_thread_ref_count_access_allow_count(0);
 ///#endif
 
+// BiasedRefCountedThreadSafeBase::shared_state_ counts each reference twice,
+// and its low bit tells whether the owning thread's references are merged in.
+constexpr int kSharedRef = 2;
+constexpr int kMergedBit = 1;
+
 }  // namespace
 
 namespace subtle {
@@ -39,6 +49,78 @@ void RefCountedBase::AddRefImpl() const {
 }
 #endif
 
+#if !defined(WINLIB_COMPONENT_BUILD)
+thread_local uint32_t g_biased_ref_count_thread_id = 0;
+#endif
+
+BiasedRefCountedThreadSafeBase::BiasedRefCountedThreadSafeBase(
+    StartRefCountFromZeroTag)
+    : owner_thread_id_(CurrentThreadId()) {}
+
+BiasedRefCountedThreadSafeBase::BiasedRefCountedThreadSafeBase(
+    StartRefCountFromOneTag)
+    : biased_ref_count_(1), owner_thread_id_(CurrentThreadId()) {}
+
+bool BiasedRefCountedThreadSafeBase::HasOneRef() const {
+  int shared_state = shared_state_.load(std::memory_order_acquire);
+  if (IsOwnedByCurrentThread())
+    return biased_ref_count_ == 1 && shared_state == 0;
+  // Before the merge, the references of the owning thread are unknown here.
+  return shared_state == (kSharedRef | kMergedBit);
+}
+
+void BiasedRefCountedThreadSafeBase::Unbias() const {
+  if (!IsBiased())
+    return;
+  WINBASE_CHECK(IsOwnedByCurrentThread())
+      << "Unbias() must be called on the thread that created the object";
+  // The thread the reference is handed to synchronizes with the merge through
+  // the handoff itself (e.g. the task queue).
+  Merge();
+}
+
+// static
+uint32_t BiasedRefCountedThreadSafeBase::CurrentThreadIdSlow() {
+  uint32_t thread_id = static_cast<uint32_t>(PlatformThread::CurrentId());
+#if !defined(WINLIB_COMPONENT_BUILD)
+  g_biased_ref_count_thread_id = thread_id;
+#endif
+  return thread_id;
+}
+
+bool BiasedRefCountedThreadSafeBase::Merge() const {
+  WINBASE_DCHECK_LE(biased_ref_count_,
+                    static_cast<uint32_t>(std::numeric_limits<int>::max() /
+                                          kSharedRef));
+  // From now on the owning thread goes through the shared counter too.
+  owner_thread_id_.store(0, std::memory_order_relaxed);
+  int merged = static_cast<int>(biased_ref_count_) * kSharedRef | kMergedBit;
+  biased_ref_count_ = 0;
+  int shared_state =
+      shared_state_.fetch_add(merged, std::memory_order_acq_rel) + merged;
+  WINBASE_CHECK_GE(shared_state, kMergedBit)
+      << "Reference counted on the owning thread released on another thread "
+         "before Unbias() was called";
+  return shared_state == kMergedBit;
+}
+
+void BiasedRefCountedThreadSafeBase::AddRefShared() const {
+  shared_state_.fetch_add(kSharedRef, std::memory_order_relaxed);
+}
+
+bool BiasedRefCountedThreadSafeBase::ReleaseShared() const {
+  int shared_state =
+      shared_state_.fetch_sub(kSharedRef, std::memory_order_acq_rel) -
+      kSharedRef;
+  // Before the merge, the owning thread still holds references and deletes
+  // the object when it merges, so other threads only keep their own count.
+  // Going below zero means they released a reference the owner counted.
+  WINBASE_CHECK_GE(shared_state, 0)
+      << "Reference counted on the owning thread released on another thread "
+         "before Unbias() was called";
+  return shared_state == kMergedBit;
+}
+
 #if !defined(ARCH_CPU_X86_FAMILY)
 bool RefCountedThreadSafeBase::Release() const {
   return ReleaseImpl();
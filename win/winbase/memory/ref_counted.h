@@ -6,7 +6,9 @@
 #define WINLIB_WINBASE_MEMORY_REF_COUNTED_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <atomic>
 #include <utility>
 
 #include "winbase\base_export.h"
@@ -222,6 +224,109 @@ class WINBASE_EXPORT RefCountedThreadSafeBase {
 ///#endif
 };
 
+#if !defined(WINLIB_COMPONENT_BUILD)
+// The id of the current thread, or 0 until BiasedRefCountedThreadSafeBase
+// first looks it up. Variables with thread storage duration cannot be
+// exported from a DLL, so component builds always look the id up.
+extern thread_local uint32_t g_biased_ref_count_thread_id;
+#endif
+
+// Biased reference counting. The thread that creates the object owns a plain,
+// non-atomic counter; every other thread uses an atomic shared counter. As long
+// as the object never leaves its creating thread, AddRef()/Release() cost an
+// increment and a thread id comparison instead of a locked read-modify-write.
+//
+// The two counters are merged when the owning thread releases its last
+// reference, or earlier by Unbias(). From then on every thread, including the
+// former owner, uses the shared counter, exactly like RefCountedThreadSafeBase,
+// and the thread that brings it to zero deletes the object. References taken
+// and released on other threads before the merge are thus always safe; a
+// reference counted by the owning thread, however, must not be released on
+// another thread before Unbias(), which is a CHECK failure.
+class WINBASE_EXPORT BiasedRefCountedThreadSafeBase {
+ public:
+  bool HasOneRef() const;
+
+  // Returns true while the owning thread still counts its references apart.
+  bool IsBiased() const {
+    return owner_thread_id_.load(std::memory_order_relaxed) != 0;
+  }
+
+  // Merges the owning thread's references into the shared counter and
+  // releases the bias. Must be called on the owning thread, before a
+  // reference it counted is handed to another thread (e.g. before posting a
+  // task bound to a scoped_refptr). No-op if the object is already unbiased.
+  void Unbias() const;
+
+ protected:
+  explicit BiasedRefCountedThreadSafeBase(StartRefCountFromZeroTag);
+  explicit BiasedRefCountedThreadSafeBase(StartRefCountFromOneTag);
+
+  ~BiasedRefCountedThreadSafeBase() = default;
+
+  BiasedRefCountedThreadSafeBase(const BiasedRefCountedThreadSafeBase&) =
+      delete;
+  BiasedRefCountedThreadSafeBase& operator=(
+      const BiasedRefCountedThreadSafeBase&) = delete;
+
+  ALWAYS_INLINE void AddRef() const {
+    if (LIKELY(IsOwnedByCurrentThread())) {
+      ++biased_ref_count_;
+      return;
+    }
+    AddRefShared();
+  }
+
+  // Returns true if the object should self-delete.
+  ALWAYS_INLINE bool Release() const {
+    if (LIKELY(IsOwnedByCurrentThread())) {
+      if (--biased_ref_count_)
+        return false;
+      // Other threads may still hold references; the merged count decides.
+      return Merge();
+    }
+    return ReleaseShared();
+  }
+
+ private:
+  template <typename U>
+  friend scoped_refptr<U> winbase::AdoptRef(U*);
+
+  void Adopted() const {}
+
+  bool IsOwnedByCurrentThread() const {
+    return owner_thread_id_.load(std::memory_order_relaxed) ==
+           CurrentThreadId();
+  }
+
+  static uint32_t CurrentThreadId() {
+#if !defined(WINLIB_COMPONENT_BUILD)
+    uint32_t thread_id = g_biased_ref_count_thread_id;
+    if (LIKELY(thread_id))
+      return thread_id;
+#endif
+    return CurrentThreadIdSlow();
+  }
+  static uint32_t CurrentThreadIdSlow();
+
+  // Adds the biased counter to the shared one and drops the bias. Returns
+  // true if no reference is left.
+  bool Merge() const;
+
+  void AddRefShared() const;
+  bool ReleaseShared() const;
+
+  // Only touched by the owning thread while biased.
+  mutable uint32_t biased_ref_count_ = 0;
+
+  // Twice the number of references taken on other threads (negative if they
+  // released references counted by the owner), plus 1 once merged.
+  mutable std::atomic<int> shared_state_{0};
+
+  // 0 once the counters are merged. Only written by the owning thread.
+  mutable std::atomic<uint32_t> owner_thread_id_;
+};
+
 }  // namespace subtle
 
 // ScopedAllowCrossThreadRefCountAccess disables the check documented on
@@ -407,6 +512,70 @@ class RefCountedThreadSafe : public subtle::RefCountedThreadSafeBase {
   }
 };
 
+//
+// A variant of RefCountedThreadSafe<T> with biased reference counting: the
+// creating thread adjusts a non-atomic counter, other threads an atomic one.
+// Use it for objects that are usually created, referenced and released on a
+// single thread but must occasionally be shared, and call Unbias() on the
+// creating thread before handing a reference to another thread:
+//
+//   class MyFoo : public winbase::BiasedRefCountedThreadSafe<MyFoo> {
+//    ...
+//    private:
+//     friend class winbase::BiasedRefCountedThreadSafe<MyFoo>;
+//     ~MyFoo();
+//   };
+//
+//   scoped_refptr<MyFoo> foo = MakeRefCounted<MyFoo>();
+//   UseLocally(foo);  // Copies of |foo| here only use the biased counter.
+//   foo->Unbias();
+//   task_runner->PostTask(FROM_HERE, BindOnce(&UseElsewhere, foo));
+//
+// Without the Unbias(), the reference held by the task would be released on
+// another thread while the creating thread still counts it, which CHECKs.
+template <class T, typename Traits> class BiasedRefCountedThreadSafe;
+
+template <typename T>
+struct DefaultBiasedRefCountedThreadSafeTraits {
+  static void Destruct(const T* x) {
+    BiasedRefCountedThreadSafe<
+        T, DefaultBiasedRefCountedThreadSafeTraits>::DeleteInternal(x);
+  }
+};
+
+template <class T,
+          typename Traits = DefaultBiasedRefCountedThreadSafeTraits<T>>
+class BiasedRefCountedThreadSafe
+    : public subtle::BiasedRefCountedThreadSafeBase {
+ public:
+  static constexpr subtle::StartRefCountFromZeroTag kRefCountPreference =
+      subtle::kStartRefCountFromZeroTag;
+
+  BiasedRefCountedThreadSafe()
+      : subtle::BiasedRefCountedThreadSafeBase(T::kRefCountPreference) {}
+
+  BiasedRefCountedThreadSafe(const BiasedRefCountedThreadSafe&) = delete;
+  BiasedRefCountedThreadSafe& operator=(const BiasedRefCountedThreadSafe&) =
+      delete;
+
+  void AddRef() const { subtle::BiasedRefCountedThreadSafeBase::AddRef(); }
+
+  void Release() const {
+    if (subtle::BiasedRefCountedThreadSafeBase::Release())
+      Traits::Destruct(static_cast<const T*>(this));
+  }
+
+ protected:
+  ~BiasedRefCountedThreadSafe() = default;
+
+ private:
+  friend struct DefaultBiasedRefCountedThreadSafeTraits<T>;
+  template <typename U>
+  static void DeleteInternal(const U* x) {
+    delete x;
+  }
+};
+
 //
 // A thread-safe wrapper for some piece of data so we can place other
 // things in scoped_refptrs<>.
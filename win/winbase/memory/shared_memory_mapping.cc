@@ -0,0 +1,64 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\shared_memory_mapping.h"
+
+#include "winbase\logging.h"
+#include "winbase\win\windows_types.h"
+
+namespace winbase {
+
+SharedMemoryMapping::SharedMemoryMapping() = default;
+
+SharedMemoryMapping::SharedMemoryMapping(SharedMemoryMapping&& other)
+    : memory_(other.memory_), size_(other.size_) {
+  other.memory_ = nullptr;
+  other.size_ = 0;
+}
+
+SharedMemoryMapping& SharedMemoryMapping::operator=(
+    SharedMemoryMapping&& other) {
+  if (this != &other) {
+    Unmap();
+    memory_ = other.memory_;
+    size_ = other.size_;
+    other.memory_ = nullptr;
+    other.size_ = 0;
+  }
+  return *this;
+}
+
+SharedMemoryMapping::~SharedMemoryMapping() {
+  Unmap();
+}
+
+SharedMemoryMapping::SharedMemoryMapping(void* memory, size_t size)
+    : memory_(memory), size_(memory ? size : 0) {}
+
+void SharedMemoryMapping::Unmap() {
+  if (memory_ && !::UnmapViewOfFile(memory_))
+    WINBASE_DPLOG(ERROR) << "UnmapViewOfFile";
+  memory_ = nullptr;
+  size_ = 0;
+}
+
+ReadOnlySharedMemoryMapping::ReadOnlySharedMemoryMapping() = default;
+ReadOnlySharedMemoryMapping::ReadOnlySharedMemoryMapping(
+    ReadOnlySharedMemoryMapping&&) = default;
+ReadOnlySharedMemoryMapping& ReadOnlySharedMemoryMapping::operator=(
+    ReadOnlySharedMemoryMapping&&) = default;
+ReadOnlySharedMemoryMapping::ReadOnlySharedMemoryMapping(void* memory,
+                                                         size_t size)
+    : SharedMemoryMapping(memory, size) {}
+
+WritableSharedMemoryMapping::WritableSharedMemoryMapping() = default;
+WritableSharedMemoryMapping::WritableSharedMemoryMapping(
+    WritableSharedMemoryMapping&&) = default;
+WritableSharedMemoryMapping& WritableSharedMemoryMapping::operator=(
+    WritableSharedMemoryMapping&&) = default;
+WritableSharedMemoryMapping::WritableSharedMemoryMapping(void* memory,
+                                                         size_t size)
+    : SharedMemoryMapping(memory, size) {}
+
+}  // namespace winbase
\ No newline at end of file
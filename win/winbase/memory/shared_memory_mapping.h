@@ -0,0 +1,105 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_MEMORY_SHARED_MEMORY_MAPPING_H_
+#define WINLIB_WINBASE_MEMORY_SHARED_MEMORY_MAPPING_H_
+
+#include <stddef.h>
+
+#include <type_traits>
+
+#include "winbase\base_export.h"
+
+namespace winbase {
+
+// A view of a shared memory region mapped into the address space of the
+// current process. The view is unmapped when the mapping is destroyed; the
+// region it came from may be closed before that. Mappings are created by the
+// Map() methods of the shared memory region classes.
+class WINBASE_EXPORT SharedMemoryMapping {
+ public:
+  // Creates an invalid mapping.
+  SharedMemoryMapping();
+  SharedMemoryMapping(SharedMemoryMapping&& other);
+  SharedMemoryMapping& operator=(SharedMemoryMapping&& other);
+  SharedMemoryMapping(const SharedMemoryMapping&) = delete;
+  SharedMemoryMapping& operator=(const SharedMemoryMapping&) = delete;
+  ~SharedMemoryMapping();
+
+  bool IsValid() const { return !!memory_; }
+
+  // Returns the number of bytes that may be accessed through the mapping.
+  size_t size() const { return size_; }
+
+ protected:
+  SharedMemoryMapping(void* memory, size_t size);
+
+  void* raw_memory_ptr() const { return memory_; }
+
+ private:
+  void Unmap();
+
+  void* memory_ = nullptr;
+  size_t size_ = 0;
+};
+
+// A read-only view of a shared memory region.
+class WINBASE_EXPORT ReadOnlySharedMemoryMapping : public SharedMemoryMapping {
+ public:
+  // Creates an invalid mapping.
+  ReadOnlySharedMemoryMapping();
+  ReadOnlySharedMemoryMapping(ReadOnlySharedMemoryMapping&&);
+  ReadOnlySharedMemoryMapping& operator=(ReadOnlySharedMemoryMapping&&);
+
+  const void* memory() const { return raw_memory_ptr(); }
+
+  // Returns the start of the mapping as a T, or null if the mapping is
+  // invalid or smaller than a T.
+  template <typename T>
+  const T* GetMemoryAs() const {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Shared memory may only hold trivially copyable types");
+    if (!IsValid() || size() < sizeof(T))
+      return nullptr;
+    return static_cast<const T*>(memory());
+  }
+
+ private:
+  friend class ReadOnlySharedMemoryRegion;
+
+  ReadOnlySharedMemoryMapping(void* memory, size_t size);
+};
+
+// A writable view of a shared memory region.
+class WINBASE_EXPORT WritableSharedMemoryMapping : public SharedMemoryMapping {
+ public:
+  // Creates an invalid mapping.
+  WritableSharedMemoryMapping();
+  WritableSharedMemoryMapping(WritableSharedMemoryMapping&&);
+  WritableSharedMemoryMapping& operator=(WritableSharedMemoryMapping&&);
+
+  void* memory() const { return raw_memory_ptr(); }
+
+  // Returns the start of the mapping as a T, or null if the mapping is
+  // invalid or smaller than a T.
+  template <typename T>
+  T* GetMemoryAs() const {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Shared memory may only hold trivially copyable types");
+    if (!IsValid() || size() < sizeof(T))
+      return nullptr;
+    return static_cast<T*>(memory());
+  }
+
+ private:
+  friend class ReadOnlySharedMemoryRegion;
+  friend class WritableSharedMemoryRegion;
+  friend class UnsafeSharedMemoryRegion;
+
+  WritableSharedMemoryMapping(void* memory, size_t size);
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_SHARED_MEMORY_MAPPING_H_
\ No newline at end of file
@@ -0,0 +1,232 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\memory\shared_memory_region.h"
+
+#include <utility>
+
+#include "winbase\logging.h"
+
+namespace winbase {
+
+using Mode = subtle::PlatformSharedMemoryRegion::Mode;
+
+// ReadOnlySharedMemoryRegion --------------------------------------------------
+
+// static
+MappedReadOnlyRegion ReadOnlySharedMemoryRegion::Create(size_t size) {
+  subtle::PlatformSharedMemoryRegion handle =
+      subtle::PlatformSharedMemoryRegion::CreateWritable(size);
+  if (!handle.IsValid())
+    return {};
+
+  void* memory = handle.MapAt(0, handle.GetSize());
+  if (!memory)
+    return {};
+  WritableSharedMemoryMapping mapping(memory, size);
+  if (!handle.ConvertToReadOnly())
+    return {};
+
+  return {ReadOnlySharedMemoryRegion(std::move(handle)), std::move(mapping)};
+}
+
+// static
+ReadOnlySharedMemoryRegion ReadOnlySharedMemoryRegion::Deserialize(
+    subtle::PlatformSharedMemoryRegion handle) {
+  return ReadOnlySharedMemoryRegion(std::move(handle));
+}
+
+// static
+subtle::PlatformSharedMemoryRegion
+ReadOnlySharedMemoryRegion::TakeHandleForSerialization(
+    ReadOnlySharedMemoryRegion region) {
+  return std::move(region.handle_);
+}
+
+// static
+bool ReadOnlySharedMemoryRegion::WriteToPickle(
+    Pickle* pickle,
+    ReadOnlySharedMemoryRegion region) {
+  return subtle::PlatformSharedMemoryRegion::WriteToPickle(
+      pickle, std::move(region.handle_));
+}
+
+// static
+bool ReadOnlySharedMemoryRegion::ReadFromPickle(
+    const Pickle& pickle,
+    PickleIterator* iter,
+    ReadOnlySharedMemoryRegion* region) {
+  subtle::PlatformSharedMemoryRegion handle;
+  if (!subtle::PlatformSharedMemoryRegion::ReadFromPickle(pickle, iter,
+                                                          &handle) ||
+      handle.GetMode() != Mode::kReadOnly) {
+    return false;
+  }
+  *region = ReadOnlySharedMemoryRegion(std::move(handle));
+  return true;
+}
+
+ReadOnlySharedMemoryRegion::ReadOnlySharedMemoryRegion() = default;
+ReadOnlySharedMemoryRegion::ReadOnlySharedMemoryRegion(
+    ReadOnlySharedMemoryRegion&&) = default;
+ReadOnlySharedMemoryRegion& ReadOnlySharedMemoryRegion::operator=(
+    ReadOnlySharedMemoryRegion&&) = default;
+ReadOnlySharedMemoryRegion::~ReadOnlySharedMemoryRegion() = default;
+
+ReadOnlySharedMemoryRegion::ReadOnlySharedMemoryRegion(
+    subtle::PlatformSharedMemoryRegion handle)
+    : handle_(std::move(handle)) {
+  if (handle_.IsValid())
+    WINBASE_CHECK(handle_.GetMode() == Mode::kReadOnly);
+}
+
+ReadOnlySharedMemoryRegion ReadOnlySharedMemoryRegion::Duplicate() const {
+  return ReadOnlySharedMemoryRegion(handle_.Duplicate());
+}
+
+ReadOnlySharedMemoryMapping ReadOnlySharedMemoryRegion::Map() const {
+  return MapAt(0, handle_.GetSize());
+}
+
+ReadOnlySharedMemoryMapping ReadOnlySharedMemoryRegion::MapAt(
+    uint64_t offset,
+    size_t size) const {
+  return ReadOnlySharedMemoryMapping(handle_.MapAt(offset, size), size);
+}
+
+// WritableSharedMemoryRegion --------------------------------------------------
+
+// static
+WritableSharedMemoryRegion WritableSharedMemoryRegion::Create(size_t size) {
+  return WritableSharedMemoryRegion(
+      subtle::PlatformSharedMemoryRegion::CreateWritable(size));
+}
+
+// static
+WritableSharedMemoryRegion WritableSharedMemoryRegion::Deserialize(
+    subtle::PlatformSharedMemoryRegion handle) {
+  return WritableSharedMemoryRegion(std::move(handle));
+}
+
+// static
+subtle::PlatformSharedMemoryRegion
+WritableSharedMemoryRegion::TakeHandleForSerialization(
+    WritableSharedMemoryRegion region) {
+  return std::move(region.handle_);
+}
+
+// static
+ReadOnlySharedMemoryRegion WritableSharedMemoryRegion::ConvertToReadOnly(
+    WritableSharedMemoryRegion region) {
+  subtle::PlatformSharedMemoryRegion handle = std::move(region.handle_);
+  if (!handle.ConvertToReadOnly())
+    return ReadOnlySharedMemoryRegion();
+  return ReadOnlySharedMemoryRegion::Deserialize(std::move(handle));
+}
+
+// static
+UnsafeSharedMemoryRegion WritableSharedMemoryRegion::ConvertToUnsafe(
+    WritableSharedMemoryRegion region) {
+  subtle::PlatformSharedMemoryRegion handle = std::move(region.handle_);
+  if (!handle.ConvertToUnsafe())
+    return UnsafeSharedMemoryRegion();
+  return UnsafeSharedMemoryRegion::Deserialize(std::move(handle));
+}
+
+WritableSharedMemoryRegion::WritableSharedMemoryRegion() = default;
+WritableSharedMemoryRegion::WritableSharedMemoryRegion(
+    WritableSharedMemoryRegion&&) = default;
+WritableSharedMemoryRegion& WritableSharedMemoryRegion::operator=(
+    WritableSharedMemoryRegion&&) = default;
+WritableSharedMemoryRegion::~WritableSharedMemoryRegion() = default;
+
+WritableSharedMemoryRegion::WritableSharedMemoryRegion(
+    subtle::PlatformSharedMemoryRegion handle)
+    : handle_(std::move(handle)) {
+  if (handle_.IsValid())
+    WINBASE_CHECK(handle_.GetMode() == Mode::kWritable);
+}
+
+WritableSharedMemoryMapping WritableSharedMemoryRegion::Map() const {
+  return MapAt(0, handle_.GetSize());
+}
+
+WritableSharedMemoryMapping WritableSharedMemoryRegion::MapAt(
+    uint64_t offset,
+    size_t size) const {
+  return WritableSharedMemoryMapping(handle_.MapAt(offset, size), size);
+}
+
+// UnsafeSharedMemoryRegion ----------------------------------------------------
+
+// static
+UnsafeSharedMemoryRegion UnsafeSharedMemoryRegion::Create(size_t size) {
+  return UnsafeSharedMemoryRegion(
+      subtle::PlatformSharedMemoryRegion::CreateUnsafe(size));
+}
+
+// static
+UnsafeSharedMemoryRegion UnsafeSharedMemoryRegion::Deserialize(
+    subtle::PlatformSharedMemoryRegion handle) {
+  return UnsafeSharedMemoryRegion(std::move(handle));
+}
+
+// static
+subtle::PlatformSharedMemoryRegion
+UnsafeSharedMemoryRegion::TakeHandleForSerialization(
+    UnsafeSharedMemoryRegion region) {
+  return std::move(region.handle_);
+}
+
+// static
+bool UnsafeSharedMemoryRegion::WriteToPickle(Pickle* pickle,
+                                             UnsafeSharedMemoryRegion region) {
+  return subtle::PlatformSharedMemoryRegion::WriteToPickle(
+      pickle, std::move(region.handle_));
+}
+
+// static
+bool UnsafeSharedMemoryRegion::ReadFromPickle(
+    const Pickle& pickle,
+    PickleIterator* iter,
+    UnsafeSharedMemoryRegion* region) {
+  subtle::PlatformSharedMemoryRegion handle;
+  if (!subtle::PlatformSharedMemoryRegion::ReadFromPickle(pickle, iter,
+                                                          &handle) ||
+      handle.GetMode() != Mode::kUnsafe) {
+    return false;
+  }
+  *region = UnsafeSharedMemoryRegion(std::move(handle));
+  return true;
+}
+
+UnsafeSharedMemoryRegion::UnsafeSharedMemoryRegion() = default;
+UnsafeSharedMemoryRegion::UnsafeSharedMemoryRegion(
+    UnsafeSharedMemoryRegion&&) = default;
+UnsafeSharedMemoryRegion& UnsafeSharedMemoryRegion::operator=(
+    UnsafeSharedMemoryRegion&&) = default;
+UnsafeSharedMemoryRegion::~UnsafeSharedMemoryRegion() = default;
+
+UnsafeSharedMemoryRegion::UnsafeSharedMemoryRegion(
+    subtle::PlatformSharedMemoryRegion handle)
+    : handle_(std::move(handle)) {
+  if (handle_.IsValid())
+    WINBASE_CHECK(handle_.GetMode() == Mode::kUnsafe);
+}
+
+UnsafeSharedMemoryRegion UnsafeSharedMemoryRegion::Duplicate() const {
+  return UnsafeSharedMemoryRegion(handle_.Duplicate());
+}
+
+WritableSharedMemoryMapping UnsafeSharedMemoryRegion::Map() const {
+  return MapAt(0, handle_.GetSize());
+}
+
+WritableSharedMemoryMapping UnsafeSharedMemoryRegion::MapAt(
+    uint64_t offset,
+    size_t size) const {
+  return WritableSharedMemoryMapping(handle_.MapAt(offset, size), size);
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,205 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Shared memory regions come in three flavors, which differ in who may write
+// to them:
+//
+// - ReadOnlySharedMemoryRegion: nobody holding the region can write to it.
+//   It is created together with a writable mapping, which the creator uses to
+//   fill the memory before sharing the region with other processes.
+// - WritableSharedMemoryRegion: only the holder of this one region can write
+//   to it. It cannot be duplicated or shared, but can be converted to a
+//   read-only or an unsafe region once the memory is initialized.
+// - UnsafeSharedMemoryRegion: anyone holding a copy can write to it. Use it
+//   when several processes must write to the same memory, and treat the
+//   contents as untrusted.
+//
+// Example:
+//   winbase::MappedReadOnlyRegion shm =
+//       winbase::ReadOnlySharedMemoryRegion::Create(sizeof(Table));
+//   if (!shm.IsValid())
+//     return false;
+//   FillTable(shm.mapping.GetMemoryAs<Table>());
+//   winbase::ReadOnlySharedMemoryRegion::WriteToPickle(&message,
+//                                                     std::move(shm.region));
+
+#ifndef WINLIB_WINBASE_MEMORY_SHARED_MEMORY_REGION_H_
+#define WINLIB_WINBASE_MEMORY_SHARED_MEMORY_REGION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\memory\platform_shared_memory_region.h"
+#include "winbase\memory\shared_memory_mapping.h"
+
+namespace winbase {
+
+class Pickle;
+class PickleIterator;
+class UnsafeSharedMemoryRegion;
+struct MappedReadOnlyRegion;
+
+class WINBASE_EXPORT ReadOnlySharedMemoryRegion {
+ public:
+  using MappingType = ReadOnlySharedMemoryMapping;
+
+  // Creates a region of |size| bytes along with a writable mapping of all of
+  // it, which is the only way to write to the region.
+  static MappedReadOnlyRegion Create(size_t size);
+
+  // Wraps |handle|, whose mode must be kReadOnly.
+  static ReadOnlySharedMemoryRegion Deserialize(
+      subtle::PlatformSharedMemoryRegion handle);
+
+  // Extracts the platform region from |region|, e.g. to transfer it.
+  static subtle::PlatformSharedMemoryRegion TakeHandleForSerialization(
+      ReadOnlySharedMemoryRegion region);
+
+  // Moves |region| into |pickle|, which must accept attachments.
+  static bool WriteToPickle(Pickle* pickle, ReadOnlySharedMemoryRegion region);
+
+  // Reads a region written by WriteToPickle().
+  static bool ReadFromPickle(const Pickle& pickle,
+                             PickleIterator* iter,
+                             ReadOnlySharedMemoryRegion* region)
+      WARN_UNUSED_RESULT;
+
+  // Creates an invalid region.
+  ReadOnlySharedMemoryRegion();
+  ReadOnlySharedMemoryRegion(ReadOnlySharedMemoryRegion&&);
+  ReadOnlySharedMemoryRegion& operator=(ReadOnlySharedMemoryRegion&&);
+  ReadOnlySharedMemoryRegion(const ReadOnlySharedMemoryRegion&) = delete;
+  ReadOnlySharedMemoryRegion& operator=(const ReadOnlySharedMemoryRegion&) =
+      delete;
+  ~ReadOnlySharedMemoryRegion();
+
+  // Returns another handle to the same memory.
+  ReadOnlySharedMemoryRegion Duplicate() const;
+
+  // Maps the whole region, or |size| bytes of it starting at |offset|, which
+  // must be a multiple of the allocation granularity. Returns an invalid
+  // mapping on failure.
+  ReadOnlySharedMemoryMapping Map() const;
+  ReadOnlySharedMemoryMapping MapAt(uint64_t offset, size_t size) const;
+
+  bool IsValid() const { return handle_.IsValid(); }
+  size_t GetSize() const { return handle_.GetSize(); }
+
+ private:
+  explicit ReadOnlySharedMemoryRegion(
+      subtle::PlatformSharedMemoryRegion handle);
+
+  subtle::PlatformSharedMemoryRegion handle_;
+};
+
+// The result of ReadOnlySharedMemoryRegion::Create().
+struct WINBASE_EXPORT MappedReadOnlyRegion {
+  bool IsValid() const { return region.IsValid() && mapping.IsValid(); }
+
+  ReadOnlySharedMemoryRegion region;
+  WritableSharedMemoryMapping mapping;
+};
+
+class WINBASE_EXPORT WritableSharedMemoryRegion {
+ public:
+  using MappingType = WritableSharedMemoryMapping;
+
+  // Creates a zero-filled region of |size| bytes. Returns an invalid region
+  // on failure.
+  static WritableSharedMemoryRegion Create(size_t size);
+
+  // Wraps |handle|, whose mode must be kWritable.
+  static WritableSharedMemoryRegion Deserialize(
+      subtle::PlatformSharedMemoryRegion handle);
+
+  // Extracts the platform region from |region|.
+  static subtle::PlatformSharedMemoryRegion TakeHandleForSerialization(
+      WritableSharedMemoryRegion region);
+
+  // Drops the write access of |region|. Mappings made from it stay writable.
+  static ReadOnlySharedMemoryRegion ConvertToReadOnly(
+      WritableSharedMemoryRegion region);
+
+  // Allows |region| to be duplicated and shared with write access.
+  static UnsafeSharedMemoryRegion ConvertToUnsafe(
+      WritableSharedMemoryRegion region);
+
+  // Creates an invalid region.
+  WritableSharedMemoryRegion();
+  WritableSharedMemoryRegion(WritableSharedMemoryRegion&&);
+  WritableSharedMemoryRegion& operator=(WritableSharedMemoryRegion&&);
+  WritableSharedMemoryRegion(const WritableSharedMemoryRegion&) = delete;
+  WritableSharedMemoryRegion& operator=(const WritableSharedMemoryRegion&) =
+      delete;
+  ~WritableSharedMemoryRegion();
+
+  // See ReadOnlySharedMemoryRegion::Map().
+  WritableSharedMemoryMapping Map() const;
+  WritableSharedMemoryMapping MapAt(uint64_t offset, size_t size) const;
+
+  bool IsValid() const { return handle_.IsValid(); }
+  size_t GetSize() const { return handle_.GetSize(); }
+
+ private:
+  explicit WritableSharedMemoryRegion(
+      subtle::PlatformSharedMemoryRegion handle);
+
+  subtle::PlatformSharedMemoryRegion handle_;
+};
+
+class WINBASE_EXPORT UnsafeSharedMemoryRegion {
+ public:
+  using MappingType = WritableSharedMemoryMapping;
+
+  // Creates a zero-filled region of |size| bytes. Returns an invalid region
+  // on failure.
+  static UnsafeSharedMemoryRegion Create(size_t size);
+
+  // Wraps |handle|, whose mode must be kUnsafe.
+  static UnsafeSharedMemoryRegion Deserialize(
+      subtle::PlatformSharedMemoryRegion handle);
+
+  // Extracts the platform region from |region|, e.g. to transfer it.
+  static subtle::PlatformSharedMemoryRegion TakeHandleForSerialization(
+      UnsafeSharedMemoryRegion region);
+
+  // Moves |region| into |pickle|, which must accept attachments.
+  static bool WriteToPickle(Pickle* pickle, UnsafeSharedMemoryRegion region);
+
+  // Reads a region written by WriteToPickle().
+  static bool ReadFromPickle(const Pickle& pickle,
+                             PickleIterator* iter,
+                             UnsafeSharedMemoryRegion* region)
+      WARN_UNUSED_RESULT;
+
+  // Creates an invalid region.
+  UnsafeSharedMemoryRegion();
+  UnsafeSharedMemoryRegion(UnsafeSharedMemoryRegion&&);
+  UnsafeSharedMemoryRegion& operator=(UnsafeSharedMemoryRegion&&);
+  UnsafeSharedMemoryRegion(const UnsafeSharedMemoryRegion&) = delete;
+  UnsafeSharedMemoryRegion& operator=(const UnsafeSharedMemoryRegion&) =
+      delete;
+  ~UnsafeSharedMemoryRegion();
+
+  // Returns another handle to the same memory, with the same write access.
+  UnsafeSharedMemoryRegion Duplicate() const;
+
+  // See ReadOnlySharedMemoryRegion::Map().
+  WritableSharedMemoryMapping Map() const;
+  WritableSharedMemoryMapping MapAt(uint64_t offset, size_t size) const;
+
+  bool IsValid() const { return handle_.IsValid(); }
+  size_t GetSize() const { return handle_.GetSize(); }
+
+ private:
+  explicit UnsafeSharedMemoryRegion(subtle::PlatformSharedMemoryRegion handle);
+
+  subtle::PlatformSharedMemoryRegion handle_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_MEMORY_SHARED_MEMORY_REGION_H_
\ No newline at end of file
@@ -4,75 +4,85 @@
 
 #include "winbase\memory\weak_ptr.h"
 
+#include "winbase\no_destructor.h"
+#include "winbase\synchronization\lock.h"
+
 namespace winbase {
 namespace internal {
 
-WeakReference::Flag::Flag() {
-  // Flags only become bound when checked for validity, or invalidated,
-  // so that we can check that later validity/invalidation operations on
-  // the same Flag take place on the same sequenced thread.
-  ///DETACH_FROM_SEQUENCE(sequence_checker_);
-}
-
-void WeakReference::Flag::Invalidate() {
-  // The flag being invalidated with a single ref implies that there are no
-  // weak pointers in existence. Allow deletion on other thread in this case.
-///#if DCHECK_IS_ON()
-///  DCHECK(sequence_checker_.CalledOnValidSequence() || HasOneRef())
-///      << "WeakPtrs must be invalidated on the same sequenced thread.";
-///#endif
-  invalidated_.Set();
-}
-
-bool WeakReference::Flag::IsValid() const {
-  ///DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_)
-  ///    << "WeakPtrs must be checked on the same sequenced thread.";
-  return !invalidated_.IsSet();
-}
-
-bool WeakReference::Flag::MaybeValid() const {
-  return !invalidated_.IsSet();
-}
-
-WeakReference::Flag::~Flag() = default;
-
-WeakReference::WeakReference() = default;
-
-WeakReference::WeakReference(const scoped_refptr<Flag>& flag) : flag_(flag) {}
+namespace {
+
+// Process-wide pool of WeakReference slots. Slots are allocated in chunks and
+// never freed, since references to a slot may outlive its owner.
+class SlotTable {
+ public:
+  SlotTable() = default;
+  SlotTable(const SlotTable&) = delete;
+  SlotTable& operator=(const SlotTable&) = delete;
+
+  WeakReference::Slot* Allocate() {
+    AutoLock auto_lock(lock_);
+    if (!free_list_) {
+      WeakReference::Slot* chunk = new WeakReference::Slot[kSlotsPerChunk];
+      for (size_t i = 0; i < kSlotsPerChunk; ++i) {
+        chunk[i].next_free = free_list_;
+        free_list_ = &chunk[i];
+      }
+    }
+    WeakReference::Slot* slot = free_list_;
+    free_list_ = slot->next_free;
+    slot->next_free = nullptr;
+    return slot;
+  }
 
-WeakReference::~WeakReference() = default;
+  void Free(WeakReference::Slot* slot) {
+    AutoLock auto_lock(lock_);
+    slot->next_free = free_list_;
+    free_list_ = slot;
+  }
 
-WeakReference::WeakReference(WeakReference&& other) = default;
+ private:
+  static constexpr size_t kSlotsPerChunk = 64;
 
-WeakReference::WeakReference(const WeakReference& other) = default;
+  Lock lock_;
+  WeakReference::Slot* free_list_ = nullptr;
+};
 
-bool WeakReference::IsValid() const {
-  return flag_ && flag_->IsValid();
+SlotTable* GetSlotTable() {
+  static NoDestructor<SlotTable> slot_table;
+  return slot_table.get();
 }
 
-bool WeakReference::MaybeValid() const {
-  return flag_ && flag_->MaybeValid();
-}
+}  // namespace
 
 WeakReferenceOwner::WeakReferenceOwner() = default;
 
 WeakReferenceOwner::~WeakReferenceOwner() {
-  Invalidate();
+  if (slot_) {
+    Invalidate();
+    GetSlotTable()->Free(slot_);
+  }
 }
 
 WeakReference WeakReferenceOwner::GetRef() const {
-  // If we hold the last reference to the Flag then create a new one.
-  if (!HasRefs())
-    flag_ = new WeakReference::Flag();
-
-  return WeakReference(flag_);
+  if (!slot_)
+    slot_ = GetSlotTable()->Allocate();
+  handed_out_refs_ = true;
+  return WeakReference(slot_,
+                       slot_->generation.load(std::memory_order_relaxed));
 }
 
 void WeakReferenceOwner::Invalidate() {
-  if (flag_) {
-    flag_->Invalidate();
-    flag_ = nullptr;
-  }
+  ///DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_)
+  ///    << "WeakPtrs must be invalidated on the same sequenced thread.";
+  if (!slot_)
+    return;
+  // Only this sequence writes the generation; the release store pairs with
+  // MaybeValid() on other threads.
+  slot_->generation.store(
+      slot_->generation.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+  handed_out_refs_ = false;
 }
 
 WeakPtrBase::WeakPtrBase() : ptr_(0) {}
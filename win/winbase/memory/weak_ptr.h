@@ -70,6 +70,9 @@
 #ifndef WINLIB_WINBASE_MEMORY_WEAK_PTR_H_
 #define WINLIB_WINBASE_MEMORY_WEAK_PTR_H_
 
+#include <stdint.h>
+
+#include <atomic>
 #include <cstddef>
 #include <type_traits>
 
@@ -78,7 +81,6 @@
 #include "winbase\macros.h"
 #include "winbase\memory\ref_counted.h"
 ///#include "winbase\sequence_checker.h"
-#include "winbase\synchronization\atomic_flag.h"
 
 namespace winbase {
 
@@ -89,42 +91,57 @@ namespace internal {
 // These classes are part of the WeakPtr implementation.
 // DO NOT USE THESE CLASSES DIRECTLY YOURSELF.
 
+// A WeakReference is a (slot, generation) pair. The slot holds a generation
+// counter owned by a WeakReferenceOwner, and the reference is valid as long as
+// the counter still holds the generation it was created with. Invalidating
+// all references is a single increment, and copying or destroying a reference
+// touches no shared state.
+//
+// Slots come from a process-wide table and are never freed: when an owner goes
+// away its slot is invalidated and recycled by a later owner. Generations keep
+// increasing across owners, so a stale reference can never match again.
 class WINBASE_EXPORT WeakReference {
  public:
-  // Although Flag is bound to a specific SequencedTaskRunner, it may be
-  // deleted from another via winbase::WeakPtr::~WeakPtr().
-  class WINBASE_EXPORT Flag : public RefCountedThreadSafe<Flag> {
-   public:
-    Flag();
-
-    void Invalidate();
-    bool IsValid() const;
-
-    bool MaybeValid() const;
-
-   private:
-    friend class winbase::RefCountedThreadSafe<Flag>;
-
-    ~Flag();
+  struct Slot {
+    // Written on the owner's sequence only. Read on that sequence by
+    // IsValid(), and on any thread by MaybeValid().
+    std::atomic<uint64_t> generation{0};
 
-    ///SEQUENCE_CHECKER(sequence_checker_);
-    AtomicFlag invalidated_;
+    // Next free slot, guarded by the slot table's lock.
+    Slot* next_free = nullptr;
   };
 
-  WeakReference();
-  explicit WeakReference(const scoped_refptr<Flag>& flag);
-  ~WeakReference();
+  WeakReference() = default;
+  WeakReference(const Slot* slot, uint64_t generation)
+      : slot_(slot), generation_(generation) {}
+  ~WeakReference() = default;
 
-  WeakReference(WeakReference&& other);
-  WeakReference(const WeakReference& other);
-  WeakReference& operator=(WeakReference&& other) = default;
+  WeakReference(WeakReference&& other) noexcept
+      : slot_(other.slot_), generation_(other.generation_) {
+    other.slot_ = nullptr;
+  }
+  WeakReference(const WeakReference& other) = default;
+  WeakReference& operator=(WeakReference&& other) noexcept {
+    slot_ = other.slot_;
+    generation_ = other.generation_;
+    other.slot_ = nullptr;
+    return *this;
+  }
   WeakReference& operator=(const WeakReference& other) = default;
 
-  bool IsValid() const;
-  bool MaybeValid() const;
+  bool IsValid() const {
+    return slot_ &&
+           slot_->generation.load(std::memory_order_relaxed) == generation_;
+  }
+
+  bool MaybeValid() const {
+    return slot_ &&
+           slot_->generation.load(std::memory_order_acquire) == generation_;
+  }
 
  private:
-  scoped_refptr<const Flag> flag_;
+  const Slot* slot_ = nullptr;
+  uint64_t generation_ = 0;
 };
 
 class WINBASE_EXPORT WeakReferenceOwner {
@@ -134,12 +151,17 @@ class WINBASE_EXPORT WeakReferenceOwner {
 
   WeakReference GetRef() const;
 
-  bool HasRefs() const { return flag_ && !flag_->HasOneRef(); }
+  // Returns true if references were handed out since the last invalidation.
+  // References are not counted, so this stays true after they are destroyed;
+  // there is deliberately no way to ask whether any are still alive.
+  bool HasHandedOutRefs() const { return handed_out_refs_; }
 
   void Invalidate();
 
  private:
-  mutable scoped_refptr<WeakReference::Flag> flag_;
+  // Acquired on the first GetRef() and kept until destruction.
+  mutable WeakReference::Slot* slot_ = nullptr;
+  mutable bool handed_out_refs_ = false;
 };
 
 // This class simplifies the implementation of WeakPtr's type conversion
@@ -334,10 +356,12 @@ class WeakPtrFactory : public internal::WeakPtrFactoryBase {
     weak_reference_owner_.Invalidate();
   }
 
-  // Call this method to determine if any weak pointers exist.
-  bool HasWeakPtrs() const {
+  // Call this method to determine if any weak pointers were handed out since
+  // the last invalidation. Weak pointers are not counted, so this does not
+  // become false again when they are all destroyed.
+  bool HasHandedOutWeakPtrs() const {
     ///DCHECK(ptr_);
-    return weak_reference_owner_.HasRefs();
+    return weak_reference_owner_.HasHandedOutRefs();
   }
 };
 
@@ -384,12 +384,21 @@ void MessageLoop::RunTask(PendingTask* pending_task) {
 
   ///TRACE_TASK_EXECUTION("MessageLoop::RunTask", *pending_task);
 
-  for (auto& observer : task_observers_)
-    observer.WillProcessTask(*pending_task);
-  message_loop_controller_->task_annotator().RunTask("MessageLoop::PostTask",
-                                                     pending_task);
-  for (auto& observer : task_observers_)
-    observer.DidProcessTask(*pending_task);
+  {
+    ScopedCurrentArena scoped_arena(&task_arena_);
+    ++task_arena_nesting_depth_;
+
+    for (auto& observer : task_observers_)
+      observer.WillProcessTask(*pending_task);
+    message_loop_controller_->task_annotator().RunTask("MessageLoop::PostTask",
+                                                       pending_task);
+    for (auto& observer : task_observers_)
+      observer.DidProcessTask(*pending_task);
+  }
+
+  // Everything the task allocated from the arena is dead by now.
+  if (--task_arena_nesting_depth_ == 0)
+    task_arena_.Reset();
 
   task_execution_allowed_ = true;
 }
@@ -12,6 +12,7 @@
 #include "winbase\base_export.h"
 #include "winbase\functional\callback_forward.h"
 #include "winbase\macros.h"
+#include "winbase\memory\arena.h"
 #include "winbase\memory\scoped_refptr.h"
 #include "winbase\message_loop\incoming_task_queue.h"
 #include "winbase\message_loop\message_loop_current.h"
@@ -192,6 +193,11 @@ class WINBASE_EXPORT MessageLoop : public MessagePump::Delegate,
   // Runs the specified PendingTask.
   void RunTask(PendingTask* pending_task);
 
+  // Returns the arena that is current while tasks run on this loop. It is
+  // reset after each task; its high_water_mark() tells how much scratch memory
+  // the most demanding task needed.
+  const Arena& task_arena() const { return task_arena_; }
+
   //----------------------------------------------------------------------------
  protected:
   std::unique_ptr<MessagePump> pump_;
@@ -293,6 +299,12 @@ class WINBASE_EXPORT MessageLoop : public MessagePump::Delegate,
   // is known to generate a system-driven nested loop.
   bool task_execution_allowed_ = true;
 
+  // Scratch memory for the running task, see Arena::Current(). Tasks nested in
+  // another task (e.g. through a nested RunLoop) share the arena of the
+  // outermost task, which resets it when it returns.
+  Arena task_arena_;
+  int task_arena_nesting_depth_ = 0;
+
   // pump_factory_.Run() is called to create a message pump for this loop
   // if type_ is TYPE_CUSTOM and pump_ is null.
   MessagePumpFactoryCallback pump_factory_;
@@ -8,11 +8,14 @@
 
 #include <algorithm>  // for max()
 #include <limits>
+#include <type_traits>
 
 #include "winbase\bits.h"
+#include "winbase\endecode\varint.h"
 #include "winbase\macros.h"
 #include "winbase\numerics/safe_conversions.h"
 #include "winbase\numerics/safe_math.h"
+#include "winbase\pickle_view.h"
 
 namespace winbase {
 
@@ -24,7 +27,15 @@ static const size_t kCapacityReadOnly = static_cast<size_t>(-1);
 PickleIterator::PickleIterator(const Pickle& pickle)
     : payload_(pickle.payload()),
       read_index_(0),
-      end_index_(pickle.payload_size()) {
+      end_index_(pickle.payload_size()),
+      compact_(pickle.encoding() == PickleEncoding::kCompact) {
+}
+
+PickleIterator::PickleIterator(const PickleView& view, PickleEncoding encoding)
+    : payload_(view.payload()),
+      read_index_(0),
+      end_index_(view.payload_size()),
+      compact_(encoding == PickleEncoding::kCompact) {
 }
 
 template <typename Type>
@@ -39,8 +50,39 @@ inline bool PickleIterator::ReadBuiltinType(Type* result) {
   return true;
 }
 
+bool PickleIterator::ReadRawVarint(uint64_t* result) {
+  WINBASE_DCHECK(compact_);
+  const char* end = DecodeVarint64(payload_ + read_index_,
+                                   payload_ + end_index_, result);
+  if (!end) {
+    read_index_ = end_index_;
+    return false;
+  }
+  read_index_ = end - payload_;
+  return true;
+}
+
+template <typename Type>
+inline bool PickleIterator::ReadVarint(Type* result) {
+  uint64_t value;
+  if (!ReadRawVarint(&value))
+    return false;
+  if (std::is_signed<Type>::value) {
+    int64_t decoded = ZigZagDecode64(value);
+    if (IsValueInRangeForNumericType<Type>(decoded)) {
+      *result = static_cast<Type>(decoded);
+      return true;
+    }
+  } else if (IsValueInRangeForNumericType<Type>(value)) {
+    *result = static_cast<Type>(value);
+    return true;
+  }
+  read_index_ = end_index_;
+  return false;
+}
+
 inline void PickleIterator::Advance(size_t size) {
-  size_t aligned_size = bits::Align(size, sizeof(uint32_t));
+  size_t aligned_size = compact_ ? size : bits::Align(size, sizeof(uint32_t));
   if (end_index_ - read_index_ < aligned_size) {
     read_index_ = end_index_;
   } else {
@@ -81,10 +123,19 @@ inline const char* PickleIterator::GetReadPointerAndAdvance(
 }
 
 bool PickleIterator::ReadBool(bool* result) {
+  if (compact_) {
+    int value;
+    if (!ReadVarint(&value))
+      return false;
+    *result = value != 0;
+    return true;
+  }
   return ReadBuiltinType(result);
 }
 
 bool PickleIterator::ReadInt(int* result) {
+  if (compact_)
+    return ReadVarint(result);
   return ReadBuiltinType(result);
 }
 
@@ -92,7 +143,7 @@ bool PickleIterator::ReadLong(long* result) {
   // Always read long as a 64-bit value to ensure compatibility between 32-bit
   // and 64-bit processes.
   int64_t result_int64 = 0;
-  if (!ReadBuiltinType(&result_int64))
+  if (!ReadInt64(&result_int64))
     return false;
   // CHECK if the cast truncates the value so that we know to change this IPC
   // parameter to use int64_t.
@@ -101,18 +152,26 @@ bool PickleIterator::ReadLong(long* result) {
 }
 
 bool PickleIterator::ReadUInt16(uint16_t* result) {
+  if (compact_)
+    return ReadVarint(result);
   return ReadBuiltinType(result);
 }
 
 bool PickleIterator::ReadUInt32(uint32_t* result) {
+  if (compact_)
+    return ReadVarint(result);
   return ReadBuiltinType(result);
 }
 
 bool PickleIterator::ReadInt64(int64_t* result) {
+  if (compact_)
+    return ReadVarint(result);
   return ReadBuiltinType(result);
 }
 
 bool PickleIterator::ReadUInt64(uint64_t* result) {
+  if (compact_)
+    return ReadVarint(result);
   return ReadBuiltinType(result);
 }
 
@@ -198,6 +257,16 @@ bool PickleIterator::ReadData(const char** data, int* length) {
   return ReadBytes(data, *length);
 }
 
+bool PickleIterator::ReadData(StringPiece* result) {
+  const char* data;
+  int length;
+  if (!ReadData(&data, &length))
+    return false;
+
+  *result = StringPiece(data, length);
+  return true;
+}
+
 bool PickleIterator::ReadBytes(const char** data, int length) {
   const char* read_from = GetReadPointerAndAdvance(length);
   if (!read_from)
@@ -206,39 +275,79 @@ bool PickleIterator::ReadBytes(const char** data, int length) {
   return true;
 }
 
+bool PickleIterator::ReadUInt32Array(std::vector<uint32_t>* result) {
+  int count;
+  if (!ReadLength(&count))
+    return false;
+
+  if (!compact_) {
+    const char* read_from = GetReadPointerAndAdvance(count, sizeof(uint32_t));
+    if (!read_from)
+      return false;
+    result->resize(count);
+    memcpy(result->data(), read_from, count * sizeof(uint32_t));
+    return true;
+  }
+
+  // Every varint takes at least one byte; do not let a corrupt count make us
+  // allocate more than the payload could hold.
+  if (static_cast<size_t>(count) > end_index_ - read_index_) {
+    read_index_ = end_index_;
+    return false;
+  }
+  result->resize(count);
+  const char* end = DecodeVarint32Array(payload_ + read_index_,
+                                        payload_ + end_index_,
+                                        result->data(), count);
+  if (!end) {
+    read_index_ = end_index_;
+    return false;
+  }
+  read_index_ = end - payload_;
+  return true;
+}
+
 Pickle::Attachment::Attachment() = default;
 
 Pickle::Attachment::~Attachment() = default;
 
 // Payload is uint32_t aligned.
 
-Pickle::Pickle()
+Pickle::Pickle() : Pickle(PickleEncoding::kClassic) {}
+
+Pickle::Pickle(int header_size)
+    : Pickle(header_size, PickleEncoding::kClassic) {}
+
+Pickle::Pickle(PickleEncoding encoding)
     : header_(nullptr),
       header_size_(sizeof(Header)),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      encoding_(encoding) {
   static_assert((Pickle::kPayloadUnit & (Pickle::kPayloadUnit - 1)) == 0,
                 "Pickle::kPayloadUnit must be a power of two");
   Resize(kPayloadUnit);
   header_->payload_size = 0;
 }
 
-Pickle::Pickle(int header_size)
+Pickle::Pickle(int header_size, PickleEncoding encoding)
     : header_(nullptr),
       header_size_(bits::Align(header_size, sizeof(uint32_t))),
       capacity_after_header_(0),
-      write_offset_(0) {
+      write_offset_(0),
+      encoding_(encoding) {
   WINBASE_DCHECK_GE(static_cast<size_t>(header_size), sizeof(Header));
   WINBASE_DCHECK_LE(header_size, kPayloadUnit);
   Resize(kPayloadUnit);
   header_->payload_size = 0;
 }
 
-Pickle::Pickle(const char* data, int data_len)
+Pickle::Pickle(const char* data, int data_len, PickleEncoding encoding)
     : header_(reinterpret_cast<Header*>(const_cast<char*>(data))),
       header_size_(0),
       capacity_after_header_(kCapacityReadOnly),
-      write_offset_(0) {
+      write_offset_(0),
+      encoding_(encoding) {
   if (data_len >= static_cast<int>(sizeof(Header)))
     header_size_ = data_len - header_->payload_size;
 
@@ -257,7 +366,8 @@ Pickle::Pickle(const Pickle& other)
     : header_(nullptr),
       header_size_(other.header_size_),
       capacity_after_header_(0),
-      write_offset_(other.write_offset_) {
+      write_offset_(other.write_offset_),
+      encoding_(other.encoding_) {
   Resize(other.header_->payload_size);
   memcpy(header_, other.header_, header_size_ + other.header_->payload_size);
 }
@@ -284,6 +394,7 @@ Pickle& Pickle::operator=(const Pickle& other) {
   memcpy(header_, other.header_,
          other.header_size_ + other.header_->payload_size);
   write_offset_ = other.write_offset_;
+  encoding_ = other.encoding_;
   return *this;
 }
 
@@ -307,6 +418,25 @@ void Pickle::WriteBytes(const void* data, int length) {
   WriteBytesCommon(data, length);
 }
 
+void Pickle::WriteUInt32Array(const uint32_t* values, int count) {
+  WINBASE_DCHECK_GE(count, 0);
+  WriteInt(count);
+  if (encoding_ != PickleEncoding::kCompact) {
+    WriteBytes(values, count * static_cast<int>(sizeof(uint32_t)));
+    return;
+  }
+
+  // Claim room for the longest encoding, then give back what was not used.
+  // This is only possible because compact pickles are not padded.
+  size_t max_length = static_cast<size_t>(count) * kMaxVarint32Length;
+  char* start = static_cast<char*>(ClaimUninitializedBytesInternal(max_length));
+  char* write = start;
+  for (int i = 0; i < count; ++i)
+    write = EncodeVarint64(values[i], write);
+  write_offset_ -= max_length - (write - start);
+  header_->payload_size = static_cast<uint32_t>(write_offset_);
+}
+
 void Pickle::Reserve(size_t length) {
   size_t data_len = bits::Align(length, sizeof(uint32_t));
   WINBASE_DCHECK_GE(data_len, length);
@@ -391,6 +521,16 @@ bool Pickle::PeekNext(size_t header_size,
   return true;
 }
 
+void Pickle::WriteVarint(uint64_t value) {
+  WINBASE_DCHECK(encoding_ == PickleEncoding::kCompact);
+  char buffer[kMaxVarint64Length];
+  WriteBytesCommon(buffer, EncodeVarint64(value, buffer) - buffer);
+}
+
+void Pickle::WriteSignedVarint(int64_t value) {
+  WriteVarint(ZigZagEncode64(value));
+}
+
 template <size_t length> void Pickle::WriteBytesStatic(const void* data) {
   WriteBytesCommon(data, length);
 }
@@ -402,7 +542,9 @@ template void Pickle::WriteBytesStatic<8>(const void* data);
 inline void* Pickle::ClaimUninitializedBytesInternal(size_t length) {
   WINBASE_DCHECK_NE(kCapacityReadOnly, capacity_after_header_)
       << "oops: pickle is readonly";
-  size_t data_len = bits::Align(length, sizeof(uint32_t));
+  size_t data_len = encoding_ == PickleEncoding::kCompact
+                        ? length
+                        : bits::Align(length, sizeof(uint32_t));
   WINBASE_DCHECK_GE(data_len, length);
 #ifdef ARCH_CPU_64_BITS
   WINBASE_DCHECK_LE(data_len, std::numeric_limits<uint32_t>::max());
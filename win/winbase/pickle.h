@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "winbase\base_export.h"
 #include "winbase\compiler_specific.h"
@@ -20,13 +21,29 @@
 namespace winbase {
 
 class Pickle;
+class PickleView;
+
+// How values are laid out in a Pickle. The encoding is not recorded in the
+// pickle itself, so the reader must use the one the writer used.
+enum class PickleEncoding {
+  // Every value is padded to 4 bytes and integers keep their native size.
+  kClassic,
+
+  // Integers are stored as LEB128 varints, signed ones zigzag-encoded first,
+  // and nothing is padded. Pickles made mostly of small integers and short
+  // strings shrink considerably, at the cost of a few more cycles per read.
+  kCompact,
+};
 
 // PickleIterator reads data from a Pickle. The Pickle object must remain valid
 // while the PickleIterator object is in use.
 class WINBASE_EXPORT PickleIterator {
  public:
-  PickleIterator() : payload_(NULL), read_index_(0), end_index_(0) {}
+  PickleIterator()
+      : payload_(NULL), read_index_(0), end_index_(0), compact_(false) {}
   explicit PickleIterator(const Pickle& pickle);
+  explicit PickleIterator(const PickleView& view,
+                          PickleEncoding encoding = PickleEncoding::kClassic);
 
   // Methods for reading the payload of the Pickle. To read from the start of
   // the Pickle, create a PickleIterator from a Pickle. If successful, these
@@ -54,6 +71,8 @@ class WINBASE_EXPORT PickleIterator {
   // message's buffer so it will be scoped to the lifetime of the message (or
   // until the message data is mutated). Do not keep the pointer around!
   bool ReadData(const char** data, int* length) WARN_UNUSED_RESULT;
+  // Same as above, but returns the blob as a StringPiece.
+  bool ReadData(StringPiece* result) WARN_UNUSED_RESULT;
 
   // A pointer to the data will be placed in |*data|. The caller specifies the
   // number of bytes to read, and ReadBytes will validate this length. The
@@ -62,12 +81,23 @@ class WINBASE_EXPORT PickleIterator {
   // mutated). Do not keep the pointer around!
   bool ReadBytes(const char** data, int length) WARN_UNUSED_RESULT;
 
+  // Reads an array written by Pickle::WriteUInt32Array().
+  bool ReadUInt32Array(std::vector<uint32_t>* result) WARN_UNUSED_RESULT;
+
   // A safer version of ReadInt() that checks for the result not being negative.
   // Use it for reading the object sizes.
   bool ReadLength(int* result) WARN_UNUSED_RESULT {
     return ReadInt(result) && *result >= 0;
   }
 
+  // Returns the encoding of the payload being read.
+  PickleEncoding encoding() const {
+    return compact_ ? PickleEncoding::kCompact : PickleEncoding::kClassic;
+  }
+
+  // Returns the number of bytes left to read.
+  size_t RemainingBytes() const { return end_index_ - read_index_; }
+
   // Skips bytes in the read buffer and returns true if there are at least
   // num_bytes available. Otherwise, does nothing and returns false.
   bool SkipBytes(int num_bytes) WARN_UNUSED_RESULT {
@@ -79,8 +109,16 @@ class WINBASE_EXPORT PickleIterator {
   template <typename Type>
   bool ReadBuiltinType(Type* result);
 
+  // Read a varint from a compact Pickle.
+  bool ReadRawVarint(uint64_t* result);
+
+  // Read a varint from a compact Pickle, zigzag-decoding it if Type is signed,
+  // and check that it fits in Type.
+  template <typename Type>
+  bool ReadVarint(Type* result);
+
   // Advance read_index_ but do not allow it to exceed end_index_.
-  // Keeps read_index_ aligned.
+  // Keeps read_index_ aligned, unless the Pickle is compact.
   void Advance(size_t size);
 
   // Get read pointer for Type and advance read pointer.
@@ -99,6 +137,7 @@ class WINBASE_EXPORT PickleIterator {
   const char* payload_;  // Start of our pickle's payload.
   size_t read_index_;  // Offset of the next readable byte in payload.
   size_t end_index_;  // Payload size.
+  bool compact_;  // Whether the payload uses PickleEncoding::kCompact.
 };
 
 // This class provides facilities for basic binary value packing and unpacking.
@@ -118,6 +157,10 @@ class WINBASE_EXPORT PickleIterator {
 // space is controlled by the header_size parameter passed to the Pickle
 // constructor.
 //
+// By default values are stored with their native size and padded to 4 bytes.
+// A Pickle constructed with PickleEncoding::kCompact stores integers as
+// varints and does not pad; see PickleEncoding.
+//
 class WINBASE_EXPORT Pickle {
  public:
   // Auxiliary data attached to a Pickle. Pickle must be subclassed along with
@@ -130,6 +173,15 @@ class WINBASE_EXPORT Pickle {
     Attachment(const Attachment&) = delete;
     Attachment& operator=(const Attachment&) = delete;
 
+    // Kinds of attachments. Readers check the type of an attachment before
+    // downcasting it.
+    enum class Type {
+      // A Win32 handle, see win::HandleAttachment.
+      kHandle,
+    };
+
+    virtual Type GetType() const = 0;
+
    protected:
     friend class RefCountedThreadSafe<Attachment>;
     virtual ~Attachment();
@@ -143,11 +195,18 @@ class WINBASE_EXPORT Pickle {
   // will be rounded up to ensure that the header size is 32bit-aligned.
   explicit Pickle(int header_size);
 
+  // Same as above, but with the given encoding.
+  explicit Pickle(PickleEncoding encoding);
+  Pickle(int header_size, PickleEncoding encoding);
+
   // Initializes a Pickle from a const block of data.  The data is not copied;
   // instead the data is merely referenced by this Pickle.  Only const methods
   // should be used on the Pickle when initialized this way.  The header
-  // padding size is deduced from the data length.
-  Pickle(const char* data, int data_len);
+  // padding size is deduced from the data length.  |encoding| must match the
+  // one the data was written with.
+  Pickle(const char* data,
+         int data_len,
+         PickleEncoding encoding = PickleEncoding::kClassic);
 
   // Initializes a Pickle as a deep copy of another Pickle.
   Pickle(const Pickle& other);
@@ -168,6 +227,8 @@ class WINBASE_EXPORT Pickle {
   // Returns the data for this Pickle.
   const void* data() const { return header_; }
 
+  PickleEncoding encoding() const { return encoding_; }
+
   // Returns the effective memory capacity of this Pickle, that is, the total
   // number of bytes currently dynamically allocated or 0 in the case of a
   // read-only Pickle. This should be used only for diagnostic / profiling
@@ -180,16 +241,41 @@ class WINBASE_EXPORT Pickle {
   // to the Pickle.
 
   void WriteBool(bool value) { WriteInt(value ? 1 : 0); }
-  void WriteInt(int value) { WritePOD(value); }
+  void WriteInt(int value) {
+    if (encoding_ == PickleEncoding::kCompact)
+      WriteSignedVarint(value);
+    else
+      WritePOD(value);
+  }
   void WriteLong(long value) {
     // Always write long as a 64-bit value to ensure compatibility between
     // 32-bit and 64-bit processes.
-    WritePOD(static_cast<int64_t>(value));
+    WriteInt64(static_cast<int64_t>(value));
+  }
+  void WriteUInt16(uint16_t value) {
+    if (encoding_ == PickleEncoding::kCompact)
+      WriteVarint(value);
+    else
+      WritePOD(value);
+  }
+  void WriteUInt32(uint32_t value) {
+    if (encoding_ == PickleEncoding::kCompact)
+      WriteVarint(value);
+    else
+      WritePOD(value);
+  }
+  void WriteInt64(int64_t value) {
+    if (encoding_ == PickleEncoding::kCompact)
+      WriteSignedVarint(value);
+    else
+      WritePOD(value);
+  }
+  void WriteUInt64(uint64_t value) {
+    if (encoding_ == PickleEncoding::kCompact)
+      WriteVarint(value);
+    else
+      WritePOD(value);
   }
-  void WriteUInt16(uint16_t value) { WritePOD(value); }
-  void WriteUInt32(uint32_t value) { WritePOD(value); }
-  void WriteInt64(int64_t value) { WritePOD(value); }
-  void WriteUInt64(uint64_t value) { WritePOD(value); }
   void WriteFloat(float value) { WritePOD(value); }
   void WriteDouble(double value) { WritePOD(value); }
   void WriteString(const StringPiece& value);
@@ -201,6 +287,9 @@ class WINBASE_EXPORT Pickle {
   // when reading and writing. It is normally used to serialize PoD types of a
   // known size. See also WriteData.
   void WriteBytes(const void* data, int length);
+  // Writes |count| values preceded by their number. In a compact Pickle the
+  // values are varints, which ReadUInt32Array() decodes in bulk.
+  void WriteUInt32Array(const uint32_t* values, int count);
 
   // WriteAttachment appends |attachment| to the pickle. It returns
   // false iff the set is full or if the Pickle implementation does not support
@@ -275,6 +364,7 @@ class WINBASE_EXPORT Pickle {
   // Claims |num_bytes| bytes of payload. This is similar to Reserve() in that
   // it may grow the capacity, but it also advances the write offset of the
   // pickle by |num_bytes|. Claimed memory, including padding, is zeroed.
+  // Compact pickles are not padded.
   //
   // Returns the address of the first byte claimed.
   void* ClaimBytes(size_t num_bytes);
@@ -311,6 +401,7 @@ class WINBASE_EXPORT Pickle {
   // The offset at which we will write the next field. Note: this doesn't count
   // the header.
   size_t write_offset_;
+  PickleEncoding encoding_;
 
   // Just like WriteBytes, but with a compile-time size, for performance.
   template<size_t length> 
@@ -322,6 +413,11 @@ class WINBASE_EXPORT Pickle {
     return true;
   }
 
+  // Writes |value| as a varint, zigzag-encoded for the signed version. Only
+  // used by compact Pickles.
+  void WriteVarint(uint64_t value);
+  void WriteSignedVarint(int64_t value);
+
   inline void* ClaimUninitializedBytesInternal(size_t num_bytes);
   inline void WriteBytesCommon(const void* data, size_t length);
 };
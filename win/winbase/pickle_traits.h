@@ -0,0 +1,420 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// PickleTraits<T> generates the code that writes a T to a Pickle and reads it
+// back, so that messages do not need hand-written WriteFoo()/ReadFoo()
+// sequences that must be kept in sync.
+//
+// Scalars, std::string, string16 and std::vector of any of the supported
+// types work out of the box. A struct opts in by listing its fields, in wire
+// order, with WINBASE_PICKLE_FIELDS() in a public section:
+//
+//   struct Point {
+//     int x;
+//     int y;
+//     WINBASE_PICKLE_FIELDS(x, y)
+//   };
+//
+//   struct Shape {
+//     std::string name;
+//     std::vector<Point> points;
+//     WINBASE_PICKLE_FIELDS(name, points)
+//   };
+//
+//   winbase::Pickle pickle;
+//   winbase::WriteToPickle(&pickle, shape);
+//   ...
+//   winbase::PickleIterator iter(pickle);
+//   Shape shape;
+//   if (!winbase::ReadFromPickle(&iter, &shape))
+//     return false;
+//
+// The bytes are exactly those of the equivalent WriteFoo() calls, so either
+// side may keep using the hand-written form. WriteToPickle() computes the
+// size of the message once and reserves it before writing anything. When
+// reading a classic pickle, consecutive fields whose encoded size does not
+// depend on their value, such as the two ints of Point or every element of
+// a std::vector<Point>, are bounds-checked once as a block and then decoded
+// without further checks.
+//
+// To support another type, specialize PickleTraits<T> with:
+//   // Size of the classic encoding if it is the same for every value, or 0.
+//   static constexpr size_t kFixedSize;
+//   // Size of the classic encoding of |value|.
+//   static size_t GetSize(const T& value);
+//   static void Write(Pickle* pickle, const T& value);
+//   static bool Read(PickleIterator* iter, T* value);
+//   // Only if kFixedSize is not 0: decodes a value from kFixedSize bytes that
+//   // the caller has already bounds-checked.
+//   static void ReadFixed(const char* data, T* value);
+
+#ifndef WINLIB_WINBASE_PICKLE_TRAITS_H_
+#define WINLIB_WINBASE_PICKLE_TRAITS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "winbase\bits.h"
+#include "winbase\numerics\checked_math.h"
+#include "winbase\numerics\safe_conversions.h"
+#include "winbase\pickle.h"
+#include "winbase\strings\string16.h"
+
+// Lists the fields of a struct for PickleTraits. Must be used in a public
+// section of the struct, and only once.
+#define WINBASE_PICKLE_FIELDS(...)          \
+  auto PickleFields() {                     \
+    return std::tie(__VA_ARGS__);           \
+  }                                         \
+  auto PickleFields() const {               \
+    return std::tie(__VA_ARGS__);           \
+  }
+
+namespace winbase {
+
+template <typename T, typename = void>
+struct PickleTraits;
+
+namespace internal {
+
+// Traits for types stored with their native size, padded to 4 bytes, by a
+// pair of Pickle/PickleIterator methods.
+template <typename T,
+          void (Pickle::*WriteMethod)(T),
+          bool (PickleIterator::*ReadMethod)(T*)>
+struct ScalarPickleTraits {
+  static constexpr size_t kFixedSize =
+      (sizeof(T) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+
+  static size_t GetSize(const T& value) { return kFixedSize; }
+  static void Write(Pickle* pickle, const T& value) {
+    (pickle->*WriteMethod)(value);
+  }
+  static bool Read(PickleIterator* iter, T* value) {
+    return (iter->*ReadMethod)(value);
+  }
+  static void ReadFixed(const char* data, T* value) {
+    memcpy(value, data, sizeof(T));
+  }
+};
+
+// Field list of a struct using WINBASE_PICKLE_FIELDS().
+template <typename T>
+using PickleFieldsTuple = decltype(std::declval<T&>().PickleFields());
+
+template <typename T, size_t I>
+using PickleFieldType =
+    std::decay_t<std::tuple_element_t<I, PickleFieldsTuple<T>>>;
+
+// Describes how the fields of a struct group into runs of fixed-size fields.
+template <typename... Fields>
+struct PickleFieldLayout {
+  static constexpr size_t kCount = sizeof...(Fields);
+
+  // Trailing 0 so that the array is never empty.
+  static constexpr size_t kSizes[] = {PickleTraits<Fields>::kFixedSize..., 0};
+
+  // Total size of the run of fixed-size fields starting at field |i|.
+  static constexpr size_t RunSize(size_t i) {
+    size_t size = 0;
+    for (; i < kCount && kSizes[i]; ++i)
+      size += kSizes[i];
+    return size;
+  }
+
+  // Offset of field |i| from the start of its run.
+  static constexpr size_t RunOffset(size_t i) {
+    size_t offset = 0;
+    for (; i > 0 && kSizes[i - 1]; --i)
+      offset += kSizes[i - 1];
+    return offset;
+  }
+
+  // Encoded size of the struct if every field has a fixed size, or 0.
+  static constexpr size_t FixedSize() {
+    size_t size = 0;
+    for (size_t i = 0; i < kCount; ++i) {
+      if (!kSizes[i])
+        return 0;
+      size += kSizes[i];
+    }
+    return size;
+  }
+};
+
+template <typename T, typename Indices>
+struct StructPickleTraitsImpl;
+
+template <typename T, size_t... Is>
+struct StructPickleTraitsImpl<T, std::index_sequence<Is...>> {
+  using Layout = PickleFieldLayout<PickleFieldType<T, Is>...>;
+
+  static constexpr size_t kFixedSize = Layout::FixedSize();
+
+  static size_t GetSize(const T& value) {
+    if (kFixedSize)
+      return kFixedSize;
+    auto fields = value.PickleFields();
+    size_t size = 0;
+    // Expands to a sum over the fields; the leading 0 handles empty structs.
+    size_t sizes[] = {0, PickleTraits<PickleFieldType<T, Is>>::GetSize(
+                             std::get<Is>(fields))...};
+    for (size_t field_size : sizes)
+      size += field_size;
+    return size;
+  }
+
+  static void Write(Pickle* pickle, const T& value) {
+    auto fields = value.PickleFields();
+    int dummy[] = {0, (PickleTraits<PickleFieldType<T, Is>>::Write(
+                           pickle, std::get<Is>(fields)),
+                       0)...};
+    (void)dummy;
+  }
+
+  static bool Read(PickleIterator* iter, T* value) {
+    auto fields = value->PickleFields();
+    if (iter->encoding() == PickleEncoding::kCompact) {
+      // Nothing has a fixed size in a compact pickle.
+      return (PickleTraits<PickleFieldType<T, Is>>::Read(
+                  iter, &std::get<Is>(fields)) &&
+              ...);
+    }
+    const char* run = nullptr;
+    return (ReadField<Is>(iter, &run, &std::get<Is>(fields)) && ...);
+  }
+
+  static void ReadFixed(const char* data, T* value) {
+    auto fields = value->PickleFields();
+    int dummy[] = {0, (PickleTraits<PickleFieldType<T, Is>>::ReadFixed(
+                           data + Layout::RunOffset(Is), &std::get<Is>(fields)),
+                       0)...};
+    (void)dummy;
+  }
+
+ private:
+  // Reads field |I| of a classic pickle. The first field of a run of
+  // fixed-size fields checks the bounds of the whole run and stores its
+  // address in |*run| for the following fields.
+  template <size_t I, typename Field>
+  static bool ReadField(PickleIterator* iter, const char** run, Field* field) {
+    if constexpr (Layout::kSizes[I] == 0) {
+      return PickleTraits<Field>::Read(iter, field);
+    } else {
+      if constexpr (Layout::RunOffset(I) == 0) {
+        if (!iter->ReadBytes(run, static_cast<int>(Layout::RunSize(I))))
+          return false;
+      }
+      PickleTraits<Field>::ReadFixed(*run + Layout::RunOffset(I), field);
+      return true;
+    }
+  }
+};
+
+}  // namespace internal
+
+template <>
+struct PickleTraits<bool> {
+  static constexpr size_t kFixedSize = sizeof(int);
+
+  static size_t GetSize(bool value) { return kFixedSize; }
+  static void Write(Pickle* pickle, bool value) { pickle->WriteBool(value); }
+  static bool Read(PickleIterator* iter, bool* value) {
+    return iter->ReadBool(value);
+  }
+  static void ReadFixed(const char* data, bool* value) {
+    int wire;
+    memcpy(&wire, data, sizeof(wire));
+    *value = wire != 0;
+  }
+};
+
+template <>
+struct PickleTraits<int>
+    : internal::ScalarPickleTraits<int,
+                                   &Pickle::WriteInt,
+                                   &PickleIterator::ReadInt> {};
+
+// long is always written as 64 bits, so that 32-bit and 64-bit processes agree;
+// reading a value that does not fit a long CHECKs, like ReadLong().
+template <>
+struct PickleTraits<long> {
+  static constexpr size_t kFixedSize = sizeof(int64_t);
+
+  static size_t GetSize(long value) { return kFixedSize; }
+  static void Write(Pickle* pickle, long value) { pickle->WriteLong(value); }
+  static bool Read(PickleIterator* iter, long* value) {
+    return iter->ReadLong(value);
+  }
+  static void ReadFixed(const char* data, long* value) {
+    int64_t wire;
+    memcpy(&wire, data, sizeof(wire));
+    *value = checked_cast<long>(wire);
+  }
+};
+
+template <>
+struct PickleTraits<uint16_t>
+    : internal::ScalarPickleTraits<uint16_t,
+                                   &Pickle::WriteUInt16,
+                                   &PickleIterator::ReadUInt16> {};
+
+template <>
+struct PickleTraits<uint32_t>
+    : internal::ScalarPickleTraits<uint32_t,
+                                   &Pickle::WriteUInt32,
+                                   &PickleIterator::ReadUInt32> {};
+
+template <>
+struct PickleTraits<int64_t>
+    : internal::ScalarPickleTraits<int64_t,
+                                   &Pickle::WriteInt64,
+                                   &PickleIterator::ReadInt64> {};
+
+template <>
+struct PickleTraits<uint64_t>
+    : internal::ScalarPickleTraits<uint64_t,
+                                   &Pickle::WriteUInt64,
+                                   &PickleIterator::ReadUInt64> {};
+
+template <>
+struct PickleTraits<float>
+    : internal::ScalarPickleTraits<float,
+                                   &Pickle::WriteFloat,
+                                   &PickleIterator::ReadFloat> {};
+
+template <>
+struct PickleTraits<double>
+    : internal::ScalarPickleTraits<double,
+                                   &Pickle::WriteDouble,
+                                   &PickleIterator::ReadDouble> {};
+
+template <>
+struct PickleTraits<std::string> {
+  static constexpr size_t kFixedSize = 0;
+
+  static size_t GetSize(const std::string& value) {
+    return sizeof(int) + bits::Align(value.size(), sizeof(uint32_t));
+  }
+  static void Write(Pickle* pickle, const std::string& value) {
+    pickle->WriteString(value);
+  }
+  static bool Read(PickleIterator* iter, std::string* value) {
+    return iter->ReadString(value);
+  }
+};
+
+template <>
+struct PickleTraits<string16> {
+  static constexpr size_t kFixedSize = 0;
+
+  static size_t GetSize(const string16& value) {
+    return sizeof(int) +
+           bits::Align(value.size() * sizeof(char16), sizeof(uint32_t));
+  }
+  static void Write(Pickle* pickle, const string16& value) {
+    pickle->WriteString16(value);
+  }
+  static bool Read(PickleIterator* iter, string16* value) {
+    return iter->ReadString16(value);
+  }
+};
+
+// Vectors are written as their length followed by their elements.
+template <typename T>
+struct PickleTraits<std::vector<T>> {
+  static constexpr size_t kFixedSize = 0;
+
+  static size_t GetSize(const std::vector<T>& value) {
+    if (PickleTraits<T>::kFixedSize)
+      return sizeof(int) + value.size() * PickleTraits<T>::kFixedSize;
+    size_t size = sizeof(int);
+    for (const T& element : value)
+      size += PickleTraits<T>::GetSize(element);
+    return size;
+  }
+
+  static void Write(Pickle* pickle, const std::vector<T>& value) {
+    pickle->WriteInt(static_cast<int>(value.size()));
+    for (const T& element : value)
+      PickleTraits<T>::Write(pickle, element);
+  }
+
+  static bool Read(PickleIterator* iter, std::vector<T>* value) {
+    int count;
+    if (!iter->ReadLength(&count))
+      return false;
+
+    if constexpr (PickleTraits<T>::kFixedSize != 0) {
+      if (iter->encoding() == PickleEncoding::kClassic) {
+        // Check the bounds of all the elements at once.
+        int size;
+        const char* data;
+        if (!CheckMul(count, PickleTraits<T>::kFixedSize)
+                 .AssignIfValid(&size) ||
+            !iter->ReadBytes(&data, size)) {
+          return false;
+        }
+        value->resize(count);
+        // Elements are read into a local, as std::vector<bool> has none to
+        // point to.
+        for (int i = 0; i < count; ++i) {
+          T element;
+          PickleTraits<T>::ReadFixed(data, &element);
+          (*value)[i] = std::move(element);
+          data += PickleTraits<T>::kFixedSize;
+        }
+        return true;
+      }
+    }
+
+    // Every element takes at least one byte; do not let a corrupt count make
+    // us allocate more than the payload could hold.
+    if (static_cast<size_t>(count) > iter->RemainingBytes())
+      return false;
+    value->resize(count);
+    for (int i = 0; i < count; ++i) {
+      T element;
+      if (!PickleTraits<T>::Read(iter, &element))
+        return false;
+      (*value)[i] = std::move(element);
+    }
+    return true;
+  }
+};
+
+// Structs that list their fields with WINBASE_PICKLE_FIELDS().
+template <typename T>
+struct PickleTraits<T, std::void_t<internal::PickleFieldsTuple<T>>>
+    : internal::StructPickleTraitsImpl<
+          T,
+          std::make_index_sequence<
+              std::tuple_size<internal::PickleFieldsTuple<T>>::value>> {};
+
+// Writes |value| to |pickle|, reserving the space it needs up front.
+template <typename T>
+void WriteToPickle(Pickle* pickle, const T& value) {
+  pickle->Reserve(PickleTraits<T>::GetSize(value));
+  PickleTraits<T>::Write(pickle, value);
+}
+
+// Reads a T written by WriteToPickle() or the equivalent WriteFoo() calls.
+template <typename T>
+bool ReadFromPickle(PickleIterator* iter, T* value) WARN_UNUSED_RESULT;
+
+template <typename T>
+bool ReadFromPickle(PickleIterator* iter, T* value) {
+  return PickleTraits<T>::Read(iter, value);
+}
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_PICKLE_TRAITS_H_
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\pickle_view.h"
+
+#include <string.h>
+
+#include "winbase\bits.h"
+#include "winbase\files\memory_mapped_file.h"
+
+namespace winbase {
+
+PickleView::PickleView() : data_(nullptr), header_size_(0), payload_size_(0) {}
+
+PickleView::PickleView(const void* data, size_t size, size_t header_size)
+    : data_(nullptr), header_size_(header_size), payload_size_(0) {
+  WINBASE_DCHECK_EQ(header_size, bits::Align(header_size, sizeof(uint32_t)));
+  WINBASE_DCHECK_GE(header_size, sizeof(Pickle::Header));
+
+  if (!data || size < header_size)
+    return;
+
+  // The buffer may come from a file and carry no alignment guarantee.
+  uint32_t payload_size;
+  memcpy(&payload_size, static_cast<const char*>(data), sizeof(payload_size));
+  if (payload_size > size - header_size)
+    return;
+
+  data_ = static_cast<const char*>(data);
+  payload_size_ = payload_size;
+}
+
+PickleView::PickleView(const Pickle& pickle)
+    : PickleView(pickle.data(),
+                 pickle.size(),
+                 pickle.size() - pickle.payload_size()) {}
+
+PickleViewReader::PickleViewReader(const void* data,
+                                   size_t size,
+                                   size_t header_size)
+    : data_(static_cast<const char*>(data)),
+      size_(data ? size : 0),
+      header_size_(header_size) {}
+
+PickleViewReader::PickleViewReader(const MemoryMappedFile& file,
+                                   size_t header_size)
+    : PickleViewReader(file.data(), file.length(), header_size) {}
+
+bool PickleViewReader::Next(PickleView* view) {
+  if (has_error_ || offset_ == size_)
+    return false;
+
+  PickleView next(data_ + offset_, size_ - offset_, header_size_);
+  if (!next.IsValid()) {
+    has_error_ = true;
+    return false;
+  }
+
+  offset_ += next.size();
+  *view = next;
+  return true;
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,133 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_PICKLE_VIEW_H_
+#define WINLIB_WINBASE_PICKLE_VIEW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+#include "winbase\pickle.h"
+
+namespace winbase {
+
+class MemoryMappedFile;
+
+// PickleView is a read-only view of a serialized Pickle living in memory that
+// the view does not own, e.g. a receive buffer or a MemoryMappedFile. Unlike
+// Pickle(const char*, int), the header size is given by the caller rather
+// than deduced from the buffer length, so the buffer may extend past the end
+// of the pickle, and sizes are not limited to int.
+//
+// The header is validated in place when the view is created. Nothing is
+// copied; read the payload with a PickleIterator and its ReadStringPiece() and
+// ReadData() methods to get views into the buffer. The buffer must outlive the
+// view and any iterator or StringPiece obtained from it.
+//
+// Example:
+//   winbase::PickleView view(buffer, buffer_size);
+//   if (!view.IsValid())
+//     return false;
+//   winbase::PickleIterator iter(view);
+//   winbase::StringPiece name;
+//   if (!iter.ReadStringPiece(&name))
+//     return false;
+class WINBASE_EXPORT PickleView {
+ public:
+  // Creates an invalid view.
+  PickleView();
+
+  // Validates the pickle at the start of [data, data + size). |header_size|
+  // must match the header size the pickle was written with.
+  PickleView(const void* data,
+             size_t size,
+             size_t header_size = sizeof(Pickle::Header));
+
+  // Views the contents of |pickle|, which must outlive the view.
+  explicit PickleView(const Pickle& pickle);
+
+  PickleView(const PickleView& other) = default;
+  PickleView& operator=(const PickleView& other) = default;
+
+  // Returns false if the buffer did not hold a complete pickle.
+  bool IsValid() const { return !!data_; }
+
+  // Returns the start of the pickle, header included, and its total size.
+  const char* data() const { return data_; }
+  size_t size() const { return header_size_ + payload_size_; }
+
+  size_t header_size() const { return header_size_; }
+  const char* payload() const { return data_ + header_size_; }
+  size_t payload_size() const { return payload_size_; }
+
+  // Returns the header, cast to a user-specified type T. The type T must be a
+  // subclass of Pickle::Header and its size must match header_size(). The
+  // header is only guaranteed to be 4-byte aligned.
+  template <class T>
+  const T* headerT() const {
+    WINBASE_DCHECK_EQ(header_size_, sizeof(T));
+    return reinterpret_cast<const T*>(data_);
+  }
+
+ private:
+  const char* data_;
+  size_t header_size_;
+  size_t payload_size_;
+};
+
+// PickleViewReader walks a buffer holding pickles written back to back, such
+// as a snapshot file made of Pickle::data() blocks, and returns a PickleView
+// for each of them without copying anything.
+//
+// Example:
+//   winbase::MemoryMappedFile file;
+//   if (!file.Initialize(path))
+//     return false;
+//   winbase::PickleViewReader reader(file);
+//   winbase::PickleView view;
+//   while (reader.Next(&view)) {
+//     winbase::PickleIterator iter(view);
+//     ...
+//   }
+//   if (reader.HasError())
+//     return false;  // Truncated or corrupt file.
+class WINBASE_EXPORT PickleViewReader {
+ public:
+  PickleViewReader(const void* data,
+                   size_t size,
+                   size_t header_size = sizeof(Pickle::Header));
+
+  // Reads the mapped contents of |file|, which must outlive the reader.
+  explicit PickleViewReader(const MemoryMappedFile& file,
+                            size_t header_size = sizeof(Pickle::Header));
+
+  PickleViewReader(const PickleViewReader&) = delete;
+  PickleViewReader& operator=(const PickleViewReader&) = delete;
+
+  // Stores the next pickle in |*view| and returns true. Returns false once the
+  // end of the buffer is reached, or if the remaining bytes do not hold a
+  // complete pickle; reading stops there in both cases.
+  bool Next(PickleView* view) WARN_UNUSED_RESULT;
+
+  // Returns true if reading stopped on a truncated or corrupt pickle rather
+  // than at the end of the buffer.
+  bool HasError() const { return has_error_; }
+
+  // Returns the offset of the next pickle from the start of the buffer.
+  size_t offset() const { return offset_; }
+
+ private:
+  const char* const data_;
+  const size_t size_;
+  const size_t header_size_;
+  size_t offset_ = 0;
+  bool has_error_ = false;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_PICKLE_VIEW_H_
\ No newline at end of file
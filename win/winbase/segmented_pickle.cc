@@ -0,0 +1,146 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\segmented_pickle.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "winbase\bits.h"
+#include "winbase\files\file.h"
+
+namespace winbase {
+
+namespace {
+
+// Size of the chunks holding copied values. Larger copies get a chunk of
+// their own.
+constexpr size_t kChunkSize = 4096;
+
+// Source of the padding that follows referenced blobs.
+const char kPadding[sizeof(uint32_t)] = {};
+
+}  // namespace
+
+SegmentedPickle::SegmentedPickle()
+    : SegmentedPickle(sizeof(Pickle::Header)) {}
+
+SegmentedPickle::SegmentedPickle(int header_size)
+    : header_size_(bits::Align(header_size, sizeof(uint32_t))) {
+  WINBASE_DCHECK_GE(static_cast<size_t>(header_size), sizeof(Pickle::Header));
+  NewChunk(header_size_);
+  header_ = write_;
+  memset(header_, 0, header_size_);
+  write_ += header_size_;
+  segments_.push_back({header_, header_size_});
+}
+
+SegmentedPickle::~SegmentedPickle() = default;
+
+void SegmentedPickle::WriteString(const StringPiece& value) {
+  WriteInt(static_cast<int>(value.size()));
+  WriteBytes(value.data(), static_cast<int>(value.size()));
+}
+
+void SegmentedPickle::WriteString16(const StringPiece16& value) {
+  WriteInt(static_cast<int>(value.size()));
+  WriteBytes(value.data(), static_cast<int>(value.size()) * sizeof(char16));
+}
+
+void SegmentedPickle::WriteData(const char* data, int length) {
+  WINBASE_DCHECK_GE(length, 0);
+  WriteInt(length);
+  WriteBytes(data, length);
+}
+
+void SegmentedPickle::WriteBytes(const void* data, int length) {
+  WINBASE_DCHECK_GE(length, 0);
+  memcpy(ClaimBytes(length), data, length);
+}
+
+void SegmentedPickle::WriteDataReference(const char* data, int length) {
+  WINBASE_DCHECK_GE(length, 0);
+  WriteInt(length);
+  WriteBytesReference(data, length);
+}
+
+void SegmentedPickle::WriteBytesReference(const void* data, size_t length) {
+  if (length < kMinReferenceSize) {
+    memcpy(ClaimBytes(length), data, length);
+    return;
+  }
+
+  size_t padding = bits::Align(length, sizeof(uint32_t)) - length;
+  WINBASE_CHECK_LE(length + padding,
+                   std::numeric_limits<uint32_t>::max() - payload_size_);
+  segments_.push_back({static_cast<const char*>(data), length});
+  if (padding)
+    segments_.push_back({kPadding, padding});
+  payload_size_ += length + padding;
+}
+
+const std::vector<SegmentedPickle::Segment>& SegmentedPickle::GetSegments() {
+  UpdateHeader();
+  return segments_;
+}
+
+bool SegmentedPickle::WriteToFile(File* file) {
+  for (const Segment& segment : GetSegments()) {
+    const char* data = segment.data;
+    size_t remaining = segment.size;
+    while (remaining) {
+      int length = static_cast<int>(
+          std::min<size_t>(remaining, std::numeric_limits<int>::max()));
+      int written = file->WriteAtCurrentPos(data, length);
+      if (written <= 0)
+        return false;
+      data += written;
+      remaining -= written;
+    }
+  }
+  return true;
+}
+
+void SegmentedPickle::CopyTo(void* buffer) {
+  char* out = static_cast<char*>(buffer);
+  for (const Segment& segment : GetSegments()) {
+    memcpy(out, segment.data, segment.size);
+    out += segment.size;
+  }
+}
+
+char* SegmentedPickle::ClaimBytes(size_t length) {
+  size_t data_len = bits::Align(length, sizeof(uint32_t));
+  WINBASE_CHECK_GE(data_len, length);
+  WINBASE_CHECK_LE(data_len,
+                   std::numeric_limits<uint32_t>::max() - payload_size_);
+  if (static_cast<size_t>(chunk_end_ - write_) < data_len)
+    NewChunk(data_len);
+
+  char* write = write_;
+  Segment& last = segments_.back();
+  if (last.data + last.size == write)
+    last.size += data_len;
+  else if (data_len)
+    segments_.push_back({write, data_len});
+
+  memset(write + length, 0, data_len - length);  // Always initialize padding
+  write_ += data_len;
+  payload_size_ += data_len;
+  return write;
+}
+
+void SegmentedPickle::NewChunk(size_t min_size) {
+  size_t size = std::max(kChunkSize, min_size);
+  chunks_.emplace_back(new char[size]);
+  write_ = chunks_.back().get();
+  chunk_end_ = write_ + size;
+}
+
+void SegmentedPickle::UpdateHeader() {
+  reinterpret_cast<Pickle::Header*>(header_)->payload_size =
+      static_cast<uint32_t>(payload_size_);
+}
+
+}  // namespace winbase
\ No newline at end of file
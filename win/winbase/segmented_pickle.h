@@ -0,0 +1,149 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_SEGMENTED_PICKLE_H_
+#define WINLIB_WINBASE_SEGMENTED_PICKLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
+#include "winbase\pickle.h"
+#include "winbase\strings\string16.h"
+#include "winbase\strings\string_piece.h"
+
+namespace winbase {
+
+class File;
+
+// SegmentedPickle builds the same bytes as a Pickle using the classic
+// encoding, but keeps them as a list of segments instead of one contiguous
+// buffer. Small values are copied into fixed-size chunks that never move, so
+// growing the pickle never copies what was already written, and large blobs
+// can be referenced where they live rather than copied at all. The result is
+// meant to be written out with a gather write, or copied once into its final
+// destination.
+//
+// Example:
+//   winbase::SegmentedPickle pickle;
+//   pickle.WriteString(name);
+//   pickle.WriteDataReference(blob.data(), blob.size());  // Not copied.
+//   if (!pickle.WriteToFile(&file))
+//     return false;
+//
+// The header is reserved in place at the start of the first chunk; its
+// payload_size field is filled in by GetSegments(), WriteToFile() and
+// CopyTo(). A SegmentedPickle is write-only: read it back with a Pickle or a
+// PickleView made from the bytes it produced.
+class WINBASE_EXPORT SegmentedPickle {
+ public:
+  // One contiguous piece of the pickle, laid out like an iovec.
+  struct Segment {
+    const char* data;
+    size_t size;
+  };
+
+  // Referenced blobs smaller than this are copied anyway, since an extra
+  // segment costs more to write out than copying a few hundred bytes.
+  static constexpr size_t kMinReferenceSize = 512;
+
+  // Initialize a SegmentedPickle using the default header size.
+  SegmentedPickle();
+
+  // Initialize a SegmentedPickle with the specified header size in bytes, as
+  // for Pickle(int).
+  explicit SegmentedPickle(int header_size);
+
+  SegmentedPickle(const SegmentedPickle&) = delete;
+  SegmentedPickle& operator=(const SegmentedPickle&) = delete;
+  ~SegmentedPickle();
+
+  // Returns the number of bytes written, including the header.
+  size_t size() const { return header_size_ + payload_size_; }
+  size_t payload_size() const { return payload_size_; }
+
+  // Methods for adding to the payload. They produce the same bytes as their
+  // Pickle counterparts and copy their arguments.
+  void WriteBool(bool value) { WriteInt(value ? 1 : 0); }
+  void WriteInt(int value) { WritePOD(value); }
+  void WriteLong(long value) {
+    // Always write long as a 64-bit value to ensure compatibility between
+    // 32-bit and 64-bit processes.
+    WritePOD(static_cast<int64_t>(value));
+  }
+  void WriteUInt16(uint16_t value) { WritePOD(value); }
+  void WriteUInt32(uint32_t value) { WritePOD(value); }
+  void WriteInt64(int64_t value) { WritePOD(value); }
+  void WriteUInt64(uint64_t value) { WritePOD(value); }
+  void WriteFloat(float value) { WritePOD(value); }
+  void WriteDouble(double value) { WritePOD(value); }
+  void WriteString(const StringPiece& value);
+  void WriteString16(const StringPiece16& value);
+  void WriteData(const char* data, int length);
+  void WriteBytes(const void* data, int length);
+
+  // Same as WriteData() and WriteBytes(), but |data| is referenced instead of
+  // copied, unless it is smaller than kMinReferenceSize. The memory must stay
+  // valid and unchanged until the pickle is destroyed or written out.
+  void WriteDataReference(const char* data, int length);
+  void WriteBytesReference(const void* data, size_t length);
+
+  // Returns the header, cast to a user-specified type T, which must be a
+  // subclass of Pickle::Header whose size matches the header size passed to
+  // the constructor. Fields other than payload_size are left to the caller.
+  template <class T>
+  T* headerT() {
+    WINBASE_DCHECK_EQ(header_size_, sizeof(T));
+    return reinterpret_cast<T*>(header_);
+  }
+
+  // Returns the segments making up the pickle, header included, in order.
+  // They are invalidated by the next write.
+  const std::vector<Segment>& GetSegments();
+
+  // Writes the whole pickle at the current position of |file|. Returns false
+  // if any write fails.
+  bool WriteToFile(File* file);
+
+  // Copies the whole pickle into |buffer|, which must hold size() bytes.
+  void CopyTo(void* buffer);
+
+ private:
+  // Writes a POD by copying its bytes.
+  template <typename T>
+  void WritePOD(const T& data) {
+    memcpy(ClaimBytes(sizeof(data)), &data, sizeof(data));
+  }
+
+  // Claims |length| bytes in the current chunk, plus the padding needed to
+  // keep the payload 4-byte aligned, and returns their address. The padding
+  // is zeroed.
+  char* ClaimBytes(size_t length);
+
+  // Adds a chunk with room for at least |min_size| bytes.
+  void NewChunk(size_t min_size);
+
+  void UpdateHeader();
+
+  const size_t header_size_;
+  size_t payload_size_ = 0;
+
+  // Memory for the header and the copied values. Chunks are never resized.
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* write_ = nullptr;
+  char* chunk_end_ = nullptr;
+
+  char* header_ = nullptr;
+  std::vector<Segment> segments_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_SEGMENTED_PICKLE_H_
\ No newline at end of file
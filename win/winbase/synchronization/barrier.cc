@@ -0,0 +1,70 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\synchronization\barrier.h"
+
+#include <windows.h>
+
+#include "winbase\logging.h"
+
+// WaitOnAddress() and WakeByAddressAll() live in the API set exported by
+// synchronization.lib.
+#pragma comment(lib, "synchronization.lib")
+
+namespace winbase {
+
+namespace {
+
+// Number of polls before a waiter goes to sleep.
+constexpr int kSpinCount = 128;
+
+}  // namespace
+
+Barrier::Barrier(int32_t count) : expected_(count), remaining_(count) {
+  WINBASE_DCHECK_GT(count, 0);
+}
+
+Barrier::~Barrier() = default;
+
+bool Barrier::ArriveAndWait() {
+  // The phase must be read before arriving: once the last participant
+  // arrives, |phase_| may move on at any time.
+  uint32_t phase = phase_.load(std::memory_order_acquire);
+  if (Arrive(phase))
+    return true;
+
+  uint32_t current = phase_.load(std::memory_order_acquire);
+  for (int i = 0; current == phase && i < kSpinCount; ++i) {
+    YieldProcessor();
+    current = phase_.load(std::memory_order_acquire);
+  }
+  while (current == phase) {
+    WaitOnAddress(&phase_, &phase, sizeof(phase), INFINITE);
+    current = phase_.load(std::memory_order_acquire);
+  }
+  return false;
+}
+
+void Barrier::ArriveAndDrop() {
+  int32_t previous = expected_.fetch_sub(1, std::memory_order_relaxed);
+  WINBASE_DCHECK_GT(previous, 0);
+  Arrive(phase_.load(std::memory_order_acquire));
+}
+
+bool Barrier::Arrive(uint32_t phase) {
+  int32_t previous = remaining_.fetch_sub(1, std::memory_order_acq_rel);
+  WINBASE_DCHECK_GT(previous, 0);
+  if (previous != 1)
+    return false;
+
+  // Last arrival: reset the count for the next phase before publishing it, so
+  // that threads released by the new phase decrement a fresh counter.
+  remaining_.store(expected_.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+  phase_.store(phase + 1, std::memory_order_release);
+  WakeByAddressAll(&phase_);
+  return true;
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,66 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_SYNCHRONIZATION_BARRIER_H_
+#define WINLIB_WINBASE_SYNCHRONIZATION_BARRIER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "winbase\base_export.h"
+
+namespace winbase {
+
+// A reusable rendezvous point for a fixed group of threads. Each call to
+// ArriveAndWait() blocks until |count| threads have arrived, then releases
+// them all and starts a new phase, so the same Barrier can separate any number
+// of rounds of work:
+//
+//   winbase::Barrier barrier(num_workers);
+//
+//   // On each worker.
+//   for (int round = 0; round < num_rounds; ++round) {
+//     ComputeSlice(round);
+//     barrier.ArriveAndWait();
+//   }
+//
+// Waiting threads spin briefly, then sleep with WaitOnAddress() on the phase
+// counter; only the last thread to arrive wakes the others.
+class WINBASE_EXPORT Barrier {
+ public:
+  explicit Barrier(int32_t count);
+  Barrier(const Barrier&) = delete;
+  Barrier& operator=(const Barrier&) = delete;
+
+  // No thread may be blocked in ArriveAndWait() when the barrier is destroyed.
+  ~Barrier();
+
+  // Blocks until every participant of the current phase has arrived. Returns
+  // true on exactly one thread per phase (the last one to arrive), which is
+  // convenient for running per-phase bookkeeping once.
+  bool ArriveAndWait();
+
+  // Arrives at the current phase without waiting and permanently removes the
+  // calling thread from the group for all following phases.
+  void ArriveAndDrop();
+
+ private:
+  // Decrements the number of threads the current phase is waiting for.
+  // Completes the phase and returns true if the caller was the last one.
+  bool Arrive(uint32_t phase);
+
+  // Number of participants for the next phase.
+  std::atomic<int32_t> expected_;
+
+  // Number of participants that still have to arrive in the current phase.
+  std::atomic<int32_t> remaining_;
+
+  // Incremented every time a phase completes. Waiters sleep on its address.
+  std::atomic<uint32_t> phase_{0};
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_SYNCHRONIZATION_BARRIER_H_
\ No newline at end of file
@@ -0,0 +1,62 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\synchronization\latch.h"
+
+#include <windows.h>
+
+#include "winbase\logging.h"
+
+// WaitOnAddress() and WakeByAddressAll() live in the API set exported by
+// synchronization.lib.
+#pragma comment(lib, "synchronization.lib")
+
+namespace winbase {
+
+namespace {
+
+// Number of polls before a waiter goes to sleep. Fan-out joins often complete
+// within a few hundred cycles of the waiter arriving.
+constexpr int kSpinCount = 128;
+
+}  // namespace
+
+Latch::Latch(int32_t count) : count_(count) {
+  WINBASE_DCHECK_GE(count, 0);
+}
+
+Latch::~Latch() = default;
+
+void Latch::CountDown(int32_t n) {
+  WINBASE_DCHECK_GE(n, 0);
+  int32_t previous = count_.fetch_sub(n, std::memory_order_acq_rel);
+  WINBASE_DCHECK_GE(previous, n);
+  if (previous == n)
+    WakeByAddressAll(&count_);
+}
+
+bool Latch::TryWait() const {
+  return count_.load(std::memory_order_acquire) == 0;
+}
+
+void Latch::Wait() const {
+  int32_t count = count_.load(std::memory_order_acquire);
+  for (int i = 0; count != 0 && i < kSpinCount; ++i) {
+    YieldProcessor();
+    count = count_.load(std::memory_order_acquire);
+  }
+  while (count != 0) {
+    // Returns immediately if |count_| no longer holds |count|; spurious
+    // wake-ups are handled by the reload.
+    WaitOnAddress(&count_, &count, sizeof(count), INFINITE);
+    count = count_.load(std::memory_order_acquire);
+  }
+}
+
+void Latch::ArriveAndWait(int32_t n) {
+  CountDown(n);
+  Wait();
+}
+
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,56 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_SYNCHRONIZATION_LATCH_H_
+#define WINLIB_WINBASE_SYNCHRONIZATION_LATCH_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "winbase\base_export.h"
+
+namespace winbase {
+
+// A single-use countdown: threads block in Wait() until CountDown() has been
+// called enough times to bring the counter to zero. Typical use is joining a
+// fan-out of sub-tasks without a Lock and a ConditionVariable:
+//
+//   winbase::Latch done(num_requests);
+//   for (Request& request : requests)
+//     PostTask(BindOnce(&Process, &request, Unretained(&done)));
+//   done.Wait();
+//
+// The counter is a single atomic. Waiters spin briefly, then sleep on the
+// counter's address with WaitOnAddress() (the Windows equivalent of a futex),
+// so a CountDown() that does not reach zero never enters the kernel.
+class WINBASE_EXPORT Latch {
+ public:
+  explicit Latch(int32_t count);
+  Latch(const Latch&) = delete;
+  Latch& operator=(const Latch&) = delete;
+
+  // No thread may be blocked in Wait() when the latch is destroyed.
+  ~Latch();
+
+  // Decrements the counter by |n|. Wakes up all waiters if it reaches zero.
+  // The counter must not go below zero.
+  void CountDown(int32_t n = 1);
+
+  // Returns true if the counter has reached zero. Never blocks.
+  bool TryWait() const;
+
+  // Blocks until the counter reaches zero.
+  void Wait() const;
+
+  // Equivalent to CountDown(n) followed by Wait().
+  void ArriveAndWait(int32_t n = 1);
+
+ private:
+  mutable std::atomic<int32_t> count_;
+};
+
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_SYNCHRONIZATION_LATCH_H_
\ No newline at end of file
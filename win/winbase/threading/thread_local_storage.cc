@@ -10,6 +10,8 @@
 #include "winlib\build_config.h"
 
 using winbase::internal::PlatformThreadLocalStorage;
+using winbase::internal::kThreadLocalStorageSize;
+using winbase::internal::TlsVectorEntry;
 
 // Chrome Thread Local Storage (TLS)
 //
@@ -56,6 +58,25 @@ using winbase::internal::PlatformThreadLocalStorage;
 // managing any necessary lifetime of the data in their slots. The only
 // convenience provided is automatic destruction when a thread ends. If a client
 // frees a slot, that client is responsible for destroying the data in the slot.
+//
+// Fast path:
+//   Reading the OS TLS slot costs a TlsGetValue() call on every Slot::Get().
+//   In static builds the pointer to the Chrome TLS array is mirrored in a
+//   compiler thread_local (g_thread_tls_vector), which the inline
+//   Slot::Get()/Set() read directly. The OS slot remains the source of truth
+//   for the uninitialized/destroyed states and is still what the thread
+//   termination callback inspects, so destructor ordering is unchanged.
+//   SetTlsVector() below keeps both in sync.
+
+namespace winbase {
+namespace internal {
+
+#if defined(WINBASE_TLS_INLINE_FAST_PATH)
+thread_local TlsVectorEntry* g_thread_tls_vector = nullptr;
+#endif
+
+}  // namespace internal
+}  // namespace winbase
 
 namespace {
 // In order to make TLS destructors work, we need to keep around a function
@@ -108,9 +129,6 @@ void* const kUninitialized = nullptr;
 // A sentinel value to indicate that the TLS system has been destroyed.
 void* const kDestroyed = reinterpret_cast<void*>(1);
 
-// The maximum number of slots in our thread local storage stack.
-constexpr int kThreadLocalStorageSize = 256;
-
 enum TlsStatus {
   FREE,
   IN_USE,
@@ -122,11 +140,6 @@ struct TlsMetadata {
   uint32_t version;
 };
 
-struct TlsVectorEntry {
-  void* data;
-  uint32_t version;
-};
-
 // This lock isn't needed until after we've constructed the per-thread TLS
 // vector, so it's safe to use.
 winbase::Lock* GetTLSMetadataLock() {
@@ -140,6 +153,18 @@ size_t g_last_assigned_slot = 0;
 // Use pthread naming convention for clarity.
 constexpr int kMaxDestructorIterations = kThreadLocalStorageSize;
 
+// Stores |value| (a TLS array, kUninitialized or kDestroyed) in the OS TLS
+// slot and mirrors it in the thread_local used by the inline fast path.
+void SetTlsVector(PlatformThreadLocalStorage::TLSKey key, void* value) {
+  PlatformThreadLocalStorage::SetTLSValue(key, value);
+#if defined(WINBASE_TLS_INLINE_FAST_PATH)
+  winbase::internal::g_thread_tls_vector =
+      (value == kUninitialized || value == kDestroyed)
+          ? nullptr
+          : static_cast<TlsVectorEntry*>(value);
+#endif
+}
+
 // This function is called to initialize our entire Chromium TLS system.
 // It may be called very early, and we need to complete most all of the setup
 // (initialization) before calling *any* memory allocator functions, which may
@@ -191,12 +216,12 @@ TlsVectorEntry* ConstructTlsVector() {
   TlsVectorEntry stack_allocated_tls_data[kThreadLocalStorageSize];
   memset(stack_allocated_tls_data, 0, sizeof(stack_allocated_tls_data));
   // Ensure that any rentrant calls change the temp version.
-  PlatformThreadLocalStorage::SetTLSValue(key, stack_allocated_tls_data);
+  SetTlsVector(key, stack_allocated_tls_data);
 
   // Allocate an array to store our data.
   TlsVectorEntry* tls_data = new TlsVectorEntry[kThreadLocalStorageSize];
   memcpy(tls_data, stack_allocated_tls_data, sizeof(stack_allocated_tls_data));
-  PlatformThreadLocalStorage::SetTLSValue(key, tls_data);
+  SetTlsVector(key, tls_data);
   return tls_data;
 }
 
@@ -207,7 +232,7 @@ void OnThreadExitInternal(TlsVectorEntry* tls_data) {
   if (tls_data == kDestroyed) {
     PlatformThreadLocalStorage::TLSKey key =
         winbase::subtle::NoBarrier_Load(&g_native_tls_key);
-    PlatformThreadLocalStorage::SetTLSValue(key, kUninitialized);
+    SetTlsVector(key, kUninitialized);
     return;
   }
 
@@ -226,7 +251,7 @@ void OnThreadExitInternal(TlsVectorEntry* tls_data) {
   // Ensure that any re-entrant calls change the temp version.
   PlatformThreadLocalStorage::TLSKey key =
       winbase::subtle::NoBarrier_Load(&g_native_tls_key);
-  PlatformThreadLocalStorage::SetTLSValue(key, stack_allocated_tls_data);
+  SetTlsVector(key, stack_allocated_tls_data);
   delete[] tls_data;  // Our last dependence on an allocator.
 
   // Snapshot the TLS Metadata so we don't have to lock on every access.
@@ -270,7 +295,7 @@ void OnThreadExitInternal(TlsVectorEntry* tls_data) {
   }
 
   // Remove our stack allocated vector.
-  PlatformThreadLocalStorage::SetTLSValue(key, kDestroyed);
+  SetTlsVector(key, kDestroyed);
 }
 
 }  // namespace
@@ -352,7 +377,7 @@ void ThreadLocalStorage::Slot::Free() {
   slot_ = kInvalidSlotValue;
 }
 
-void* ThreadLocalStorage::Slot::Get() const {
+void* ThreadLocalStorage::Slot::GetSlow() const {
   TlsVectorEntry* tls_data = static_cast<TlsVectorEntry*>(
       PlatformThreadLocalStorage::GetTLSValue(
           winbase::subtle::NoBarrier_Load(&g_native_tls_key)));
@@ -367,7 +392,7 @@ void* ThreadLocalStorage::Slot::Get() const {
   return tls_data[slot_].data;
 }
 
-void ThreadLocalStorage::Slot::Set(void* value) {
+void ThreadLocalStorage::Slot::SetSlow(void* value) {
   TlsVectorEntry* tls_data = static_cast<TlsVectorEntry*>(
       PlatformThreadLocalStorage::GetTLSValue(
           winbase::subtle::NoBarrier_Load(&g_native_tls_key)));
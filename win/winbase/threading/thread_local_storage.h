@@ -9,6 +9,8 @@
 
 #include "winbase\atomic\atomicops.h"
 #include "winbase\base_export.h"
+#include "winbase\compiler_specific.h"
+#include "winbase\logging.h"
 #include "winbase\macros.h"
 #include "winbase\win\windows_types.h"
 #include "winlib\build_config.h"
@@ -37,6 +39,28 @@ namespace internal {
 
 class ThreadLocalStorageTestInternal;
 
+// The maximum number of slots in our thread local storage stack.
+constexpr int kThreadLocalStorageSize = 256;
+
+// One entry of the per-thread Chrome TLS array. See thread_local_storage.cc.
+struct TlsVectorEntry {
+  void* data;
+  uint32_t version;
+};
+
+// Variables with thread storage duration cannot be exported from a DLL, so the
+// inline fast path of Slot::Get()/Set() is only available in static builds.
+#if !defined(WINLIB_COMPONENT_BUILD)
+#define WINBASE_TLS_INLINE_FAST_PATH 1
+
+// Mirror of the per-thread TLS array pointer stored in the OS TLS slot, kept in
+// a compiler-managed thread_local so that Slot::Get()/Set() avoid the
+// TlsGetValue() call. It is null whenever the OS slot does not hold a usable
+// array (uninitialized or destroyed); callers then take the slow path, which
+// consults the OS slot.
+extern thread_local TlsVectorEntry* g_thread_tls_vector;
+#endif  // !defined(WINLIB_COMPONENT_BUILD)
+
 // WARNING: You should *NOT* use this class directly.
 // PlatformThreadLocalStorage is a low-level abstraction of the OS's TLS
 // interface. Instead, you should use one of the following:
@@ -117,16 +141,46 @@ class WINBASE_EXPORT ThreadLocalStorage {
 
     // Get the thread-local value stored in slot 'slot'.
     // Values are guaranteed to initially be zero.
-    void* Get() const;
+    ALWAYS_INLINE void* Get() const {
+      WINBASE_DCHECK_NE(slot_, kInvalidSlotValue);
+      WINBASE_DCHECK_LT(slot_, internal::kThreadLocalStorageSize);
+#if defined(WINBASE_TLS_INLINE_FAST_PATH)
+      internal::TlsVectorEntry* tls_data = internal::g_thread_tls_vector;
+      if (LIKELY(tls_data)) {
+        // Version mismatches means this slot was previously freed.
+        return tls_data[slot_].version == version_ ? tls_data[slot_].data
+                                                   : nullptr;
+      }
+#endif
+      return GetSlow();
+    }
 
     // Set the thread-local value stored in slot 'slot' to
     // value 'value'.
-    void Set(void* value);
+    ALWAYS_INLINE void Set(void* value) {
+      WINBASE_DCHECK_NE(slot_, kInvalidSlotValue);
+      WINBASE_DCHECK_LT(slot_, internal::kThreadLocalStorageSize);
+#if defined(WINBASE_TLS_INLINE_FAST_PATH)
+      internal::TlsVectorEntry* tls_data = internal::g_thread_tls_vector;
+      if (LIKELY(tls_data)) {
+        tls_data[slot_].data = value;
+        tls_data[slot_].version = version_;
+        return;
+      }
+#endif
+      SetSlow(value);
+    }
 
    private:
     void Initialize(TLSDestructorFunc destructor);
     void Free();
 
+    // Go through the OS TLS slot. Used before the per-thread array exists, in
+    // component builds, and to diagnose use after the TLS system was torn
+    // down on this thread.
+    void* GetSlow() const;
+    void SetSlow(void* value);
+
     static constexpr int kInvalidSlotValue = -1;
     int slot_ = kInvalidSlotValue;
     uint32_t version_ = 0;
@@ -0,0 +1,34 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "winbase\win\handle_attachment.h"
+
+#include <utility>
+
+namespace winbase {
+namespace win {
+
+HandleAttachment::HandleAttachment(ScopedHandle handle)
+    : handle_(std::move(handle)) {}
+
+HandleAttachment::~HandleAttachment() = default;
+
+// static
+HandleAttachment* HandleAttachment::FromAttachment(
+    Pickle::Attachment* attachment) {
+  if (!attachment || attachment->GetType() != Type::kHandle)
+    return nullptr;
+  return static_cast<HandleAttachment*>(attachment);
+}
+
+Pickle::Attachment::Type HandleAttachment::GetType() const {
+  return Type::kHandle;
+}
+
+ScopedHandle HandleAttachment::TakeHandle() {
+  return std::move(handle_);
+}
+
+}  // namespace win
+}  // namespace winbase
\ No newline at end of file
@@ -0,0 +1,46 @@
+// Copyright 2018 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef WINLIB_WINBASE_WIN_HANDLE_ATTACHMENT_H_
+#define WINLIB_WINBASE_WIN_HANDLE_ATTACHMENT_H_
+
+#include "winbase\base_export.h"
+#include "winbase\pickle.h"
+#include "winbase\win\scoped_handle.h"
+#include "winbase\win\windows_types.h"
+
+namespace winbase {
+namespace win {
+
+// Carries a Win32 handle in a Pickle that supports attachments. The channel
+// sending the pickle duplicates the handle into the receiving process, where
+// the pickle gets a HandleAttachment owning the duplicate.
+class WINBASE_EXPORT HandleAttachment : public Pickle::Attachment {
+ public:
+  explicit HandleAttachment(ScopedHandle handle);
+  HandleAttachment(const HandleAttachment&) = delete;
+  HandleAttachment& operator=(const HandleAttachment&) = delete;
+
+  // Returns |attachment| as a HandleAttachment, or null if it is of another
+  // type.
+  static HandleAttachment* FromAttachment(Pickle::Attachment* attachment);
+
+  // Pickle::Attachment:
+  Type GetType() const override;
+
+  HANDLE handle() const { return handle_.Get(); }
+
+  // Transfers ownership of the handle to the caller.
+  ScopedHandle TakeHandle();
+
+ private:
+  ~HandleAttachment() override;
+
+  ScopedHandle handle_;
+};
+
+}  // namespace win
+}  // namespace winbase
+
+#endif  // WINLIB_WINBASE_WIN_HANDLE_ATTACHMENT_H_
\ No newline at end of file